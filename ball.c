@@ -14,6 +14,9 @@
  * associated header file.
  * @note For information pertaining to the structure of the transmitted and
  * received data, see README.md
+ * @note The ball's position and velocity are in Q8.8 fixed point, and only
+ * shifts, additions and comparisons are used to update them, so that no
+ * floating point or division is needed.
  */
 
 #include "ball.h"
@@ -21,8 +24,12 @@
 #include "board.h"
 #include "display.h"
 #include "game.h"
-#include "ir_uart.h"
+#include "ghost.h"
+#include "lifetime.h"
 #include "puck.h"
+#include "ring.h"
+#include "stats.h"
+#include "warm.h"
 
 bool have_ball = false;
 
@@ -34,86 +41,44 @@ bool have_ball = false;
 static Ball ball;
 
 /**
- * @brief Transmits to the other board that this board has lost the game. Also
- * tells the custom task scheduler to stop the execution of the game. This is
- * kept inside this module because it hijacks the existing receiving scheme.
+ * @brief Transmits to every other board that this board has lost the game.
+ * Also tells the custom task scheduler to stop the execution of the game. This
+ * is kept inside this module because it hijacks the existing receiving scheme.
  *
  */
 static void lost_transmit(void)
 {
+    uint8_t payload = I_HAVE_LOST;
+
     lost_game = true;
     continue_game = false;
-    ir_uart_putc(I_HAVE_LOST);
+    ring_broadcast(&payload, 1);
 }
 
 /**
- * @brief Transmits the ball's current attributes to the other board.
+ * @brief Transmits the ball's current attributes to the next board in the ring,
+ * along with this board's puck if it has moved.
  *
  */
 static void ball_transmit(void)
 {
-    int8_t ball_values = (ball.new_row << NEW_ROW_SHIFT) |
-                         ((ball.velocity - 1) << VELOCITY_SHIFT) |
-                         ball.direction;
-    ir_uart_putc(ball_values);
-    have_ball = false;
-}
-
-/**
- * @brief Gets the direction of the ball from the received transmission.
- *
- * @param received_data The received transmission
- * @return uint8_t The received direction
- */
-static int8_t get_direction(uint8_t received_data)
-{
-    int8_t direction = received_data;
-    // wipes the unneeded bits
-    for (int8_t i = DIRECTION_BIT_LENGTH; i < 8; i++) {
-        direction &= WIPE_BIT(i);
-    }
-    return direction;
-}
+    uint8_t message[RING_PAYLOAD_MAX];
+    // the puck is sent along with the ball, if it has moved
+    uint8_t length = ghost_merge(message);
 
-/**
- * @brief Gets the velocity of the ball from the received transmission.
- *
- * @param received_data The received transmission
- * @return uint8_t The received velocity
- */
-static int8_t get_velocity(uint8_t received_data)
-{
-    int8_t velocity = received_data >> VELOCITY_SHIFT;
-    // wipes the unneeded bits
-    for (int8_t i = VELOCITY_BIT_LENGTH; i < 8; i++) {
-        velocity &= WIPE_BIT(i);
-    }
-    // increase the velocity of the ball so that it resides within the 1 to 4
-    // range
-    velocity++;
-    return velocity;
-}
-
-/**
- * @brief Gets the new_row of the ball from the received transmission, and
- * returns the correct row for the receiving board - the boards have different
- * orientations.
- *
- * @param received_data The received transmission
- * @return uint8_t The received new_row
- */
-static int8_t get_new_row(uint8_t received_data)
-{
-    return LAST_ROW - (received_data >> NEW_ROW_SHIFT);
+    ball_pack(&ball, message + length);
+    warm_handoff(message, length + BALL_PACKET_LENGTH);
+    ring_send(ring_next(), message, length + BALL_PACKET_LENGTH);
+    have_ball = false;
 }
 
 /**
  * @brief Checks to see if the game should continue.
  *
- * @param received_data The data received from the other board
- * @return true The other board has indicated that it has lost the game, thus
+ * @param received_data The data received from another board
+ * @return true Another board has indicated that it has lost the game, thus
  * the game should not continue.
- * @return false The other board has transmitted information about the ball, and
+ * @return false Another board has transmitted information about the ball, and
  * thus the game can continue.
  */
 static bool check_won(uint8_t received_data)
@@ -126,65 +91,34 @@ static bool check_won(uint8_t received_data)
 }
 
 /**
- * @brief Applies the received ball values so that they're correct for this
- * board.
- *
- * @param new_row The received new_row
- * @param velocity The received velocity
- * @param direction The received direction
+ * @brief Receives data from the other boards. This is either data about the
+ * ball's attributes, which may follow the other board's puck, or that another
+ * board has lost the game. The other board's puck can also be sent on its own,
+ * as can a rejoin byte from a board which has restarted. Messages for other
+ * boards are forwarded by ring_receive, and any other message, such as a late
+ * rematch byte, is ignored. The ball is corrected before it is decoded.
  *
- * @note The received direction is for the old board. Since this board has a
- * different orientation to the board which transmitted the direction, the
- * direction and the new_row need to be updated.
  */
-static void set_received_ball_values(int8_t new_row, int8_t velocity,
-                                     int8_t direction)
+static void ball_receive(void)
 {
-    ball.old_column = STARTING_OLD;
-    ball.old_row = STARTING_OLD;
-    ball.new_column = BALL_RECEIVED_START;
-    ball.new_row = new_row;
-
-    // figures out the direction and new_row for this board
-    switch (direction) {
-        case EAST:
-            ball.direction = WEST;
-            break;
-        case SOUTH_EAST:
-            ball.new_row--;
-            ball.direction = NORTH_WEST;
-            break;
-        case NORTH_EAST:
-            ball.new_row++;
-            ball.direction = SOUTH_WEST;
-            break;
-        default:
-            break;
+    uint8_t payload[RING_PAYLOAD_MAX];
+    uint8_t* data = payload;
+    uint8_t source;
+    uint8_t length = ring_receive(payload, &source);
+
+    // the other board's puck can come before its ball, in the same message
+    if (length > 0 && ghost_receive(data[0])) {
+        data++;
+        length--;
     }
 
-    ball.velocity = velocity;
-}
-
-/**
- * @brief Receives data from the other board. This is either data about the
- * ball's attributes, or that the other board has lost the game.
- *
- */
-static void ball_receive(void)
-{
-    if (ir_uart_read_ready_p()) {
-        // setting received_data to an unsigned integer avoids a nasty bug in
-        // get_new_row(). To see the old get_new_row go to
-        // https://eng-git.canterbury.ac.nz/ence260-2018/group436/blob/b97516ce8a9072bec1e871a162c68e9ba6eb2a64/ball.c#L100
-        uint8_t received_data = ir_uart_getc();
-
-        if (!check_won(received_data)) {
-            int8_t new_row = get_new_row(received_data);
-            int8_t velocity = get_velocity(received_data);
-            int8_t direction = get_direction(received_data);
-            set_received_ball_values(new_row, velocity, direction);
-            have_ball = true;
-        }
+    if (length > 0 && !check_won(data[0]) &&
+        !warm_receive(data[0], source) &&
+        (data[0] & BALL_PACKET_MASK) == BALL_PACKET) {
+        ball_correct(data);
+        ball_unpack(&ball, data);
+        have_ball = true;
+        warm_caught();
     }
 }
 
@@ -195,7 +129,7 @@ static void ball_update_display(void)
 {
     display_pixel_set(ball.old_column, ball.old_row, false);
     if (have_ball) {
-        display_pixel_set(ball.new_column, ball.new_row, true);
+        display_pixel_set(TO_CELL(ball.column), TO_CELL(ball.row), true);
     }
 }
 
@@ -206,212 +140,140 @@ static void ball_update_display(void)
  */
 static void handle_ball_transmission(void)
 {
-    if (have_ball && ball.new_column == TRANSMIT_COLUMN) {
+    if (have_ball && TO_CELL(ball.column) == TRANSMIT_COLUMN) {
         ball_transmit();
     }
 }
 
-/**
- * @brief Gets the impact point between the puck and the ball, when the ball is
- * travelling west Assumes that pucks are three points long.
- *
- * @return ImpactPoint The impact point
- */
-static ImpactPoint get_impact_point(void)
+void ball_wall_collision(Ball* ball)
 {
-    if (ball.direction == WEST) {
-        if (ball.new_row == puck.new_bottom) {
-            return IMPACT_BOTTOM;
-        } else if (ball.new_row == puck.new_top) {
-            return IMPACT_TOP;
-        } else if (puck.new_bottom < ball.new_row &&
-                   ball.new_row < puck.new_top) {
-            return IMPACT_MIDDLE;
-        }
-    } else if (ball.direction == SOUTH_WEST || ball.direction == NORTH_WEST) {
-        if (ball.old_row == puck.new_top) {
-            return IMPACT_TOP;
-        } else if (ball.old_row == puck.new_bottom) {
-            return IMPACT_BOTTOM;
-        } else if (puck.new_bottom <= ball.new_row &&
-                   ball.new_row <= puck.new_top) {
-            return IMPACT_MIDDLE;
-        }
+    if (ball->row < TO_FIXED(BOTTOM_ROW)) {
+        ball->row = 2 * TO_FIXED(BOTTOM_ROW) - ball->row;
+        ball->row_step = -ball->row_step;
+    } else if (ball->row > TO_FIXED(TOP_ROW)) {
+        ball->row = 2 * TO_FIXED(TOP_ROW) - ball->row;
+        ball->row_step = -ball->row_step;
     }
-    return NO_IMPACT;
 }
 
-/**
- * @brief Handles collisions where the ball's direction is WEST.
- *
- */
-static void handle_ball_puck_collision_west(void)
+void ball_puck_impact(Ball* ball, fixed_t impact_row, int8_t puck_bottom,
+                      int8_t puck_top)
 {
-    if (ball.new_column == PUCK_COL && puck.new_bottom <= ball.new_row &&
-        ball.new_row <= puck.new_top) {
-        ImpactPoint impact = get_impact_point();
-        ball.new_column = ball.old_column - 1;
-        if (impact == IMPACT_MIDDLE) {
-            ball.direction = EAST;
-        } else if (impact == IMPACT_TOP) {
-            ball.direction = NORTH_EAST;
-            ball.new_row++;
-        } else if (impact == IMPACT_BOTTOM) {
-            ball.direction = SOUTH_EAST;
-            ball.new_row--;
-        } else if (impact == NO_IMPACT) {
-            ball.new_row = STARTING_ROW;
-            ball.new_column = STARTING_COLUMN;
-            ball.direction = WEST;
-        }
+    fixed_t offset =
+        PUCK_DEFLECT(impact_row - (TO_FIXED(puck_bottom + puck_top) >> 1));
+
+    if ((offset >= FIXED_HALF || offset <= -FIXED_HALF) &&
+        ball->row_step != 0) {
+        // per the model, a hit which adds to the ball's angle increases the
+        // velocity by 2, and one which takes from it increases it by 1
+        ball->velocity += ((offset ^ ball->row_step) >= 0) ? 2 : 1;
     }
-}
 
-/**
- * @brief Handles collisions where the ball's direction is SOUTH_WEST.
- *
- */
-static void handle_ball_puck_collision_south_west(void)
-{
-    if (ball.new_column == PUCK_COL) {
-        ImpactPoint impact = get_impact_point();
-        ball.new_column = ball.old_column - 1;
-        if (impact == IMPACT_TOP) {
-            ball.direction = SOUTH_EAST;
-            ball.velocity++;
-        } else if (impact == IMPACT_MIDDLE) {
-            ball.direction = EAST;
-            ball.new_row = ball.old_row;
-        } else if (impact == IMPACT_BOTTOM) {
-            ball.direction = SOUTH_EAST;
-            // per the model, this particular collision increases the velocity
-            // by 2
-            ball.velocity += 2;
-        } else if (impact == NO_IMPACT) {
-            ball.new_row = ball.old_row - 1;
-            ball.new_column = LAST_COLUMN;
-            ball.direction = WEST;
+    ball->row_step += offset;
+    if (ball->row_step > MAX_ROW_STEP) {
+        ball->row_step = MAX_ROW_STEP;
+    } else if (ball->row_step < -MAX_ROW_STEP) {
+        ball->row_step = -MAX_ROW_STEP;
+    }
+    ball->column_step = -ball->column_step;
+
+    // once the ball is too fast to update more often, it moves across more
+    // columns each update
+    if (ball->velocity > MAX_VELOCITY) {
+        if (ball->stride < MAX_STRIDE) {
+            ball->stride <<= 1;
+            ball->velocity = (ball->velocity + 1) >> 1;
+        } else {
+            ball->velocity = MAX_VELOCITY;
         }
     }
 }
 
 /**
- * @brief Handles collisions where the ball's direction is SOUTH_WEST.
+ * @brief Handles the ball moving into the puck's column. If the ball hits the
+ * puck, the update is replayed from where the ball was, with its velocity
+ * reflected off the puck.
  *
+ * @param from_row The row which the ball was in before this update
+ * @param from_column The column which the ball was in before this update
+ * @return true The ball hit the puck
+ * @return false The ball did not reach the puck, or missed it
  */
-static void handle_ball_puck_collision_north_west(void)
+static bool handle_ball_puck_collision(fixed_t from_row, fixed_t from_column)
 {
-    if (ball.new_column == PUCK_COL) {
-        ImpactPoint impact = get_impact_point();
-        ball.new_column = ball.old_column - 1;
-        if (impact == IMPACT_TOP) {
-            ball.direction = NORTH_EAST;
-            // per the model, this particular collision increases the velocity
-            // by 2
-            ball.velocity += 2;
-        } else if (impact == IMPACT_MIDDLE) {
-            ball.direction = EAST;
-            ball.new_row = ball.old_row;
-        } else if (impact == IMPACT_BOTTOM) {
-            ball.direction = NORTH_EAST;
-            ball.velocity++;
-        } else if (impact == NO_IMPACT) {
-            ball.new_row = ball.old_row + 1;
-            ball.new_column = LAST_COLUMN;
-            ball.direction = WEST;
-        }
+    if (ball.column_step <= 0 || TO_CELL(ball.column) != PUCK_COL) {
+        return false;
     }
-}
 
-/**
- * @brief Checks to see if the proposed location for the ball is currently
- * occupied by the puck.
- *
- * @return true The ball is in the puck
- * @return false The ball is not in the puck
- */
-static void handle_ball_puck_collision(void)
-{
-    if (ball.direction == WEST) {
-        handle_ball_puck_collision_west();
-    } else if (ball.direction == SOUTH_WEST) {
-        handle_ball_puck_collision_south_west();
-    } else if (ball.direction == NORTH_WEST) {
-        handle_ball_puck_collision_north_west();
+    // the row at which the ball crosses into the puck's column, halfway
+    // through the update
+    fixed_t impact_row = ball.row - (ball.row_step >> 1);
+    int8_t impact_cell = TO_CELL(impact_row);
+    if (impact_cell < puck.new_bottom || puck.new_top < impact_cell) {
+        return false;
     }
+
+    ball_puck_impact(&ball, impact_row, puck.new_bottom, puck.new_top);
+    ball.row = from_row + ball.row_step;
+    ball.column = from_column + ball.column_step;
+    return true;
 }
 
 /**
- * @brief Updates the ball with the new column.
+ * @brief Moves the ball across a single column, and resolves its collisions
+ * with the walls and the puck, and its crossing of the TRANSMIT_COLUMN.
  *
+ * @return true The ball is still on this board
+ * @return false The ball has been transmitted, or the player has lost
  */
-static void set_ball_column_movement(void)
+static bool ball_step(void)
 {
-    if (NORTH_EAST <= ball.direction && ball.direction <= SOUTH_EAST) {
-        // based on the direction compass. This includes NE, E, SE
-        ball.new_column--;
-    } else if (SOUTH_WEST <= ball.direction && ball.direction <= NORTH_WEST) {
-        // This includes NW, W, SW
-        ball.new_column++;
+    fixed_t from_row = ball.row;
+    fixed_t from_column = ball.column;
+
+    ball.row += ball.row_step;
+    ball.column += ball.column_step;
+
+    // the ball is reflected off the walls first, so that the row at which it
+    // reaches the puck is within the display
+    ball_wall_collision(&ball);
+    if (handle_ball_puck_collision(from_row, from_column)) {
+        lifetime_hit(ball.velocity * ball.stride);
     }
-}
 
-/**
- * @brief If the ball collides with the wall, its row and direction are updated.
- *
- */
-static void handle_ball_wall_collision(void)
-{
-    if (ball.new_row < BOTTOM_ROW) {
-        ball.new_row = BOTTOM_ROW + 1;
-        if (ball.direction == SOUTH_WEST) {
-            ball.direction = NORTH_WEST;
-        } else if (ball.direction == SOUTH_EAST) {
-            ball.direction = NORTH_EAST;
-        }
-    } else if (ball.new_row > TOP_ROW) {
-        ball.new_row = TOP_ROW - 1;
-        if (ball.direction == NORTH_WEST) {
-            ball.direction = SOUTH_WEST;
-        } else if (ball.direction == NORTH_EAST) {
-            ball.direction = SOUTH_EAST;
-        }
+    // The ball should never reside in the LAST_COLUMN after it has collided
+    // with the puck. If the ball is in LAST_COLUMN at this point, the player
+    // has lost this game.
+    if (TO_CELL(ball.column) == LAST_COLUMN) {
+        lost_transmit();
+        return false;
     }
+
+    // the puck may have sent the ball back into a wall
+    ball_wall_collision(&ball);
+    handle_ball_transmission();
+    return have_ball;
 }
 
 /**
  * @brief Updates the ball's location, based on its attributes and location
- * within the board.
+ * within the board. The ball is swept across each column of its stride in
+ * turn, so that it cannot pass through the puck, a wall or the
+ * TRANSMIT_COLUMN when it moves across several columns at once.
  *
  */
 static void ball_update_value(void)
 {
-    ball.old_column = ball.new_column;
-    ball.old_row = ball.new_row;
+    uint8_t steps = ball.stride;
 
-    set_ball_column_movement();
+    ball.old_column = TO_CELL(ball.column);
+    ball.old_row = TO_CELL(ball.row);
 
-    if (ball.direction == NORTH_WEST || ball.direction == NORTH_EAST) {
-        ball.new_row++;
-    } else if (ball.direction == SOUTH_WEST || ball.direction == SOUTH_EAST) {
-        ball.new_row--;
+    while (steps > 0 && ball_step()) {
+        steps--;
     }
 
-    handle_ball_puck_collision();
-
-    // The ball should never reside in the LAST_COLUMN after it has collided
-    // with the puck. If the ball is in LAST_COLUMN at this point, the player
-    // has lost this game.
-    if (ball.new_column == LAST_COLUMN) {
-        lost_transmit();
-    } else {
-        handle_ball_wall_collision();
-        handle_ball_transmission();
-
-        if (ball.velocity > MAX_VELOCITY) {
-            ball.velocity = MAX_VELOCITY;
-        }
-
+    if (continue_game) {
         ball_update_display();
     }
 }
@@ -441,35 +303,121 @@ static bool can_update(uint8_t time_to_check)
     return false;
 }
 
+void ball_pack(const Ball* ball, uint8_t* packet)
+{
+    uint8_t row = (ball->row + (1 << (PACKET_SHIFT - 1))) >> PACKET_SHIFT;
+    int8_t row_step =
+        (ball->row_step + (1 << (PACKET_SHIFT - 1))) >> PACKET_SHIFT;
+
+    packet[0] = BALL_PACKET | ((ball->stride - 1) << STRIDE_SHIFT) |
+                ((ball->velocity - 1) << VELOCITY_SHIFT) |
+                (row >> PACKET_FRACTION_BITS);
+    packet[1] = (row << (8 - PACKET_FRACTION_BITS)) |
+                ((uint8_t) row_step & ROW_STEP_MASK);
+#ifdef BALL_FEC
+    packet[FEC_DATA_LENGTH] = fec_check(packet);
+#endif
+}
+
+uint8_t ball_correct(uint8_t* packet)
+{
+#ifdef BALL_FEC
+    uint8_t result = fec_correct(packet);
+
+    if (result == FEC_CORRECTED) {
+        stats.fec_corrected++;
+    } else if (result == FEC_DETECTED) {
+        // the ball is mirrored when it is decoded, so it is sent from the row
+        // which is mirrored onto STARTING_ROW
+        const Ball restart = {.row = TO_FIXED(LAST_ROW - STARTING_ROW),
+                              .row_step = 0,
+                              .velocity = STARTING_VELOCITY,
+                              .stride = 1};
+
+        stats.fec_detected++;
+        ball_pack(&restart, packet);
+    }
+    return result;
+#else
+    (void) packet;
+    return FEC_CLEAN;
+#endif
+}
+
+void ball_unpack(Ball* ball, const uint8_t* packet)
+{
+    fixed_t row = (((packet[0] & ROW_MASK) << PACKET_FRACTION_BITS) |
+                   (packet[1] >> (8 - PACKET_FRACTION_BITS)))
+                  << PACKET_SHIFT;
+    int8_t row_step =
+        (int8_t) ((packet[1] & ROW_STEP_MASK) << ROW_STEP_SHIFT) >>
+        ROW_STEP_SHIFT;
+
+    ball->old_column = STARTING_OLD;
+    ball->old_row = STARTING_OLD;
+    ball->row_step = -row_step * (1 << PACKET_SHIFT);
+    ball->column_step = FIXED_ONE;
+    ball->row = TO_FIXED(LAST_ROW) - row - ball->row_step;
+    ball->column = TO_FIXED(BALL_RECEIVED_START);
+    ball->velocity = ((packet[0] >> VELOCITY_SHIFT) & VELOCITY_MASK) + 1;
+    ball->stride = ((packet[0] >> STRIDE_SHIFT) & STRIDE_MASK) + 1;
+}
+
 void ball_init(void)
 {
     if (have_ball) {
         ball = (Ball){.old_row = STARTING_OLD,
                       .old_column = STARTING_OLD,
-                      .new_row = STARTING_ROW,
-                      .new_column = STARTING_COLUMN,
+                      .row = TO_FIXED(STARTING_ROW),
+                      .column = TO_FIXED(STARTING_COLUMN),
+                      .row_step = 0,
+                      .column_step = FIXED_ONE,
                       .velocity = STARTING_VELOCITY,
-                      .direction = STARTING_DIRECTION};
+                      .stride = 1};
         ball_update_display();
     } else {
         ball = (Ball){.old_row = STARTING_OLD,
                       .old_column = STARTING_OLD,
-                      .new_row = BALL_RECEIVED_START,
-                      .new_column = BALL_RECEIVED_START,
+                      .row = TO_FIXED(BALL_RECEIVED_START),
+                      .column = TO_FIXED(BALL_RECEIVED_START),
+                      .row_step = 0,
+                      .column_step = FIXED_ONE,
                       .velocity = MAX_VELOCITY,
-                      .direction = STARTING_OLD};
+                      .stride = 1};
     }
 }
 
+void ball_resume(const Ball* resumed)
+{
+    ball = *resumed;
+    ball.old_row = STARTING_OLD;
+    ball.old_column = STARTING_OLD;
+    ball_update_display();
+}
+
+bool ball_in_cell(int8_t column, int8_t row)
+{
+    return have_ball && TO_CELL(ball.column) == column &&
+           TO_CELL(ball.row) == row;
+}
+
+bool ball_towards_puck(void)
+{
+    return have_ball && ball.column_step > 0;
+}
+
+const Ball* ball_get(void)
+{
+    return &ball;
+}
+
 void ball_task(__unused__ void* data)
 {
     uint8_t time_to_check = FIRST_VALUE_FOR_UPDATE;
     uint8_t variable_period = VARIABLE_PERIOD_NUMERATOR / ball.velocity;
     for (uint8_t i = 0; i < ball.velocity; i++) {
         if (can_update(time_to_check)) {
-            if (!have_ball) {
-                ball_receive();
-            } else {
+            if (have_ball) {
                 ball_update_value();
             }
             counter++;
@@ -480,3 +428,13 @@ void ball_task(__unused__ void* data)
     counter++;
     return;
 }
+
+void ball_receive_task(__unused__ void* data)
+{
+    if (!have_ball) {
+        ball_receive();
+    } else {
+        // the board with the ball still sends the ghost puck
+        ring_flush();
+    }
+}
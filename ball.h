@@ -15,58 +15,172 @@
 #ifndef BALL_H
 #define BALL_H
 
+#include "fec.h"
+#include "field.h"
 #include "ledmat.h"
 #include "system.h"
 
 /**
- * @brief Wipes bit X when used with a bitwise and.
+ * @brief The number of fractional bits in the ball's fixed-point (Q8.8)
+ * position and velocity.
  *
  */
-#define WIPE_BIT(X) ~(1 << X)
+#define FIXED_SHIFT 8
 
 /**
- * @brief The shift for which new_row has to be shifted into the transmitted
- * integer.
+ * @brief One cell of the display, in fixed point.
  *
  */
-#define NEW_ROW_SHIFT 5
+#define FIXED_ONE (1 << FIXED_SHIFT)
 
 /**
- * @brief The shift for which the velocity has to be shifted into the
- * transmitted integer.
+ * @brief Half a cell of the display, in fixed point.
+ *
+ */
+#define FIXED_HALF (FIXED_ONE >> 1)
+
+/**
+ * @brief Converts the row or column of a cell to the fixed-point position of
+ * the cell's centre.
+ *
+ */
+#define TO_FIXED(cell) ((fixed_t) (cell) * FIXED_ONE)
+
+/**
+ * @brief Converts a fixed-point position to the row or column of the cell
+ * which contains it.
+ *
+ */
+#define TO_CELL(value) ((int8_t) (((value) + FIXED_HALF) >> FIXED_SHIFT))
+
+/**
+ * @brief The largest distance that the ball can move along a column, for each
+ * column that it moves across. This keeps the ball within 45 degrees of the
+ * rows.
+ *
+ */
+#define MAX_ROW_STEP FIXED_ONE
+
+/**
+ * @brief The change to the ball's row step for each cell from the puck's
+ * centre that the ball hits it, so that a hit on either end of the puck turns
+ * the ball by MAX_ROW_STEP, whatever the puck's length.
+ *
+ */
+#if PUCK_LENGTH > 1
+#define PUCK_DEFLECTION (2 * MAX_ROW_STEP / (PUCK_LENGTH - 1))
+#else
+#define PUCK_DEFLECTION (2 * MAX_ROW_STEP)
+#endif
+
+/**
+ * @brief Converts the fixed-point distance from the puck's centre at which the
+ * ball hits it to the change to the ball's row step. For a puck of three rows,
+ * this is the distance itself.
+ *
+ */
+#define PUCK_DEFLECT(offset)                                                   \
+    ((fixed_t) (((int32_t) (offset) * PUCK_DEFLECTION) >> FIXED_SHIFT))
+
+/**
+ * @brief The marker in the top two bits of the first byte of a transmitted
+ * ball. Every other byte which is sent between the boards has these bits
+ * clear.
+ *
+ */
+#define BALL_PACKET 0x40
+
+/**
+ * @brief The number of bytes in a transmitted ball. When built with BALL_FEC,
+ * the two bytes of the ball are followed by a check byte, so that a single
+ * broken bit can be corrected by the board which receives it.
+ *
+ */
+#ifdef BALL_FEC
+#define BALL_PACKET_LENGTH FEC_CODEWORD_LENGTH
+#else
+#define BALL_PACKET_LENGTH 2
+#endif
+
+/**
+ * @brief The mask for the marker in the first byte of a transmitted ball.
+ *
+ */
+#define BALL_PACKET_MASK 0xC0
+
+/**
+ * @brief The shift for which the velocity has to be shifted into the first
+ * transmitted byte.
  *
  */
 #define VELOCITY_SHIFT 3
 
 /**
- * @brief The length of velocity inside the transmitted integer.
+ * @brief The mask for the velocity, once it has been shifted out of the first
+ * transmitted byte.
  *
  */
-#define VELOCITY_BIT_LENGTH 2
+#define VELOCITY_MASK 0x03
 
 /**
- * @brief The length of direction inside the transmitted integer.
+ * @brief The shift for which the stride has to be shifted into the first
+ * transmitted byte.
  *
  */
-#define DIRECTION_BIT_LENGTH 2
+#define STRIDE_SHIFT 5
 
 /**
- * @brief Starting row for the ball.
+ * @brief The mask for the stride, once it has been shifted out of the first
+ * transmitted byte.
  *
  */
-#define STARTING_ROW 3
+#define STRIDE_MASK 0x01
 
 /**
- * @brief Starting column for the ball.
+ * @brief The mask for the whole part of the row, inside the first transmitted
+ * byte.
  *
  */
-#define STARTING_COLUMN 0
+#define ROW_MASK 0x07
+
+/**
+ * @brief The number of fractional bits in the row and row step, when they are
+ * transmitted.
+ *
+ */
+#define PACKET_FRACTION_BITS 3
+
+/**
+ * @brief The shift between the fixed-point row and row step, and their
+ * transmitted values.
+ *
+ */
+#define PACKET_SHIFT (FIXED_SHIFT - PACKET_FRACTION_BITS)
+
+/**
+ * @brief The mask for the row step inside the second transmitted byte.
+ *
+ */
+#define ROW_STEP_MASK 0x1F
 
 /**
- * @brief Starting direction for the ball.
+ * @brief The number of bits above the row step inside the second transmitted
+ * byte. The row step is shifted up by this, and back down, to extend its sign.
  *
  */
-#define STARTING_DIRECTION WEST
+#define ROW_STEP_SHIFT 3
+
+/**
+ * @brief Starting row for the ball, in the middle of the field.
+ *
+ */
+#define STARTING_ROW (FIELD_ROWS / 2)
+
+/**
+ * @brief Starting column for the ball.
+ *
+ */
+#define STARTING_COLUMN 0
 
 /**
  * @brief Starting velocity for the ball.
@@ -96,7 +210,7 @@
 
 /**
  * @brief Sent by the board which has just lost the game. This value was chosen
- * because the enum Direction has a maximum value of 5.
+ * because it does not have the BALL_PACKET marker.
  *
  */
 #define I_HAVE_LOST 7
@@ -113,13 +227,13 @@
  * @brief The number of the last column in the board (per zero-based indexing).
  *
  */
-#define LAST_COLUMN LEDMAT_COLS_NUM - 1
+#define LAST_COLUMN FIELD_LAST_COLUMN
 
 /**
  * @brief The number of the last row in the board (per zero-based indexing).
  *
  */
-#define LAST_ROW LEDMAT_ROWS_NUM - 1
+#define LAST_ROW FIELD_LAST_ROW
 
 /**
  * @brief The column at which data is transmitted to the other board
@@ -127,53 +241,52 @@
  */
 #define TRANSMIT_COLUMN -1
 /**
- * @brief The maximum velocity of the ball.
+ * @brief The maximum velocity of the ball. This is limited by the counter
+ * which determines how often the ball updates.
  *
  */
 #define MAX_VELOCITY 4
 
 /**
- * @brief Specifies the values for the various directions.
+ * @brief The maximum number of columns that the ball moves across each time it
+ * updates. Once the velocity passes MAX_VELOCITY, the stride is doubled and the
+ * velocity is halved, which allows the ball to travel at up to MAX_VELOCITY *
+ * MAX_STRIDE columns per second. Must be a power of two.
+ *
+ */
+#define MAX_STRIDE 2
+
+/**
+ * @brief A fixed-point (Q8.8) number, in cells of the display.
  *
  */
-typedef enum direction_e {
-    NORTH_EAST = 0,
-    EAST = 1,
-    SOUTH_EAST = 2,
-    SOUTH_WEST = 3,
-    WEST = 4,
-    NORTH_WEST = 5,
-} Direction;
+typedef int16_t fixed_t;
 
 /**
- * @brief Definition for the Ball type. The old values are kept in order to wipe
- * them from the display, so that the new position can be written without
+ * @brief Definition for the Ball type. The position is in fixed point, and is
+ * only converted to a cell of the display when the ball is drawn. The old
+ * values are the cell in which the ball was last drawn, and are kept in order
+ * to wipe it from the display, so that the new position can be written without
  * retaining the old position.
  *
+ * The row_step and column_step are the ball's velocity vector, as the distance
+ * that it moves for each column that it moves across. The velocity is how
+ * often the ball updates, and the stride is how many columns the ball moves
+ * across each time it updates.
+ *
  */
 typedef struct ball_s
 {
     int8_t old_row;
     int8_t old_column;
-    int8_t new_row;
-    int8_t new_column;
+    fixed_t row;
+    fixed_t column;
+    fixed_t row_step;
+    fixed_t column_step;
     int8_t velocity;
-    Direction direction;
-
+    uint8_t stride;
 } Ball;
 
-/**
- * @brief Definition for the ImpactPoint type. It indicates where on the puck
- * the ball impacted.
- *
- */
-typedef enum impact_point_e {
-    IMPACT_BOTTOM = 0,
-    IMPACT_MIDDLE = 1,
-    IMPACT_TOP = 2,
-    NO_IMPACT = -1
-} ImpactPoint;
-
 /**
  * @brief Indicates whether this board has the ball.
  *
@@ -187,6 +300,98 @@ bool have_ball;
  */
 void ball_init(void);
 
+/**
+ * @brief Puts a ball which this board had before a reset back on the board.
+ * CAN ONLY BE USED AFTER board_init().
+ *
+ * @param resumed The ball
+ */
+void ball_resume(const Ball* resumed);
+
+/**
+ * @brief Encodes a ball into the bytes which are transmitted to the next
+ * board. The row and row step are rounded to PACKET_FRACTION_BITS fractional
+ * bits, so that the ball fits within two bytes. When built with BALL_FEC, the
+ * check byte is added after them.
+ *
+ * @param ball The ball
+ * @param packet Set to the BALL_PACKET_LENGTH bytes to transmit
+ */
+void ball_pack(const Ball* ball, uint8_t* packet);
+
+/**
+ * @brief Decodes a ball which has been received from another board, so that it
+ * is correct for the board which received it.
+ *
+ * @param ball Set to the ball
+ * @param packet The BALL_PACKET_LENGTH bytes which were received
+ *
+ * @note Since the receiving board has a different orientation to the board
+ * which transmitted the ball, the row and row step are mirrored. The ball is
+ * placed one update before the edge of the display, so that it is first drawn
+ * in the row in which it left the other board.
+ */
+void ball_unpack(Ball* ball, const uint8_t* packet);
+
+/**
+ * @brief Corrects a ball which has been received, before it is decoded. When
+ * built without BALL_FEC, the ball is left as it is. If the ball is too broken
+ * to be corrected, it is replaced with a ball which starts in STARTING_ROW at
+ * the starting velocity, so that the game carries on.
+ *
+ * @param packet The BALL_PACKET_LENGTH bytes which were received, which are
+ * corrected in place
+ * @return uint8_t FEC_CLEAN, FEC_CORRECTED or FEC_DETECTED
+ */
+uint8_t ball_correct(uint8_t* packet);
+
+/**
+ * @brief If a ball collides with the wall, it is reflected off the wall. The
+ * walls are at the centres of the bottom and top rows. This is shared by every
+ * module which moves a ball, so that they all move it the same way.
+ *
+ * @param ball The ball
+ */
+void ball_wall_collision(Ball* ball);
+
+/**
+ * @brief Bounces a ball which has hit a puck back off it. The further from the
+ * puck's centre that the ball hits, the more its row step is changed, and an
+ * off-centre hit speeds the ball up. Once the ball is faster than
+ * MAX_VELOCITY, its stride is doubled instead.
+ *
+ * @param ball The ball
+ * @param impact_row The row at which the ball crosses into the puck's column
+ * @param puck_bottom The puck's bottom row
+ * @param puck_top The puck's top row
+ */
+void ball_puck_impact(Ball* ball, fixed_t impact_row, int8_t puck_bottom,
+                      int8_t puck_top);
+
+/**
+ * @brief Checks whether the ball is shown in a cell of the display.
+ *
+ * @param column The cell's column
+ * @param row The cell's row
+ * @return true This board has the ball, and it is in the cell
+ */
+bool ball_in_cell(int8_t column, int8_t row);
+
+/**
+ * @brief Checks whether this board has the ball, and it is heading towards the
+ * puck, away from the TRANSMIT_COLUMN.
+ *
+ * @return true The ball is heading towards this board's puck
+ */
+bool ball_towards_puck(void);
+
+/**
+ * @brief Gets the ball, so that it can be inspected without being changed.
+ *
+ * @return const Ball* The ball
+ */
+const Ball* ball_get(void);
+
 /**
  * @brief Updates the ball when it should.
  * If the velocity is 1, it updates when value is 99.
@@ -198,4 +403,14 @@ void ball_init(void);
  */
 void ball_task(__unused__ void* data);
 
+/**
+ * @brief Receives the ball, and the other boards' messages, while this board
+ * does not have the ball. It is kept apart from ball_task, which counts its
+ * runs to time the ball, so that it can also be woken as soon as a byte is
+ * received over IR.
+ *
+ * @param void
+ */
+void ball_receive_task(__unused__ void* data);
+
 #endif
\ No newline at end of file
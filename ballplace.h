@@ -0,0 +1,59 @@
+/**
+ * @file ballplace.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief The places which the ball is put in before each of its functions is
+ * benchmarked, so that bench.c and benchhost.c time the same work.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note This file sets the ball in ball.c, so it must be included after
+ * ball.c and puck.c.
+ */
+
+#ifndef BALLPLACE_H
+#define BALLPLACE_H
+
+/**
+ * @brief Places the ball in the middle of the field, heading towards the puck
+ * at an angle.
+ *
+ */
+static void ball_place(void)
+{
+    have_ball = true;
+    continue_game = true;
+    ball = (Ball){.old_row = STARTING_OLD,
+                  .old_column = STARTING_OLD,
+                  .row = TO_FIXED(STARTING_ROW) + FIXED_HALF / 2,
+                  .column = TO_FIXED(1),
+                  .row_step = FIXED_HALF,
+                  .column_step = FIXED_ONE,
+                  .velocity = STARTING_VELOCITY,
+                  .stride = MAX_STRIDE};
+}
+
+/**
+ * @brief Places the ball inside the puck's column, off the centre of the puck.
+ *
+ */
+static void ball_place_in_puck(void)
+{
+    ball_place();
+    ball.column = TO_FIXED(PUCK_COL);
+    ball.row = TO_FIXED(puck.new_top);
+}
+
+/**
+ * @brief Places the ball past the top wall.
+ *
+ */
+static void ball_place_past_wall(void)
+{
+    ball_place();
+    ball.row = TO_FIXED(TOP_ROW) + FIXED_HALF;
+}
+
+#endif
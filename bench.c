@@ -0,0 +1,685 @@
+/**
+ * @file bench.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Benchmarks the game's tasks and the custom task scheduler on the
+ * ATmega32u2, inside the simavr simulator. It is built with the same flags as
+ * the game, and prints its results as CSV to simavr's console.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Timer 1 is run without a prescaler while benchmarking, so that each of
+ * its ticks is a single cycle. The stack is measured last, with the timer's
+ * prescaler, so that the tasks run as often as in the game.
+ * @note The ball, puck and scheduler modules are included, rather than linked,
+ * so that their static hot-path functions can be benchmarked one at a time.
+ */
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "avr/avr_mcu_section.h"
+#include "ball.c"
+#include "board.h"
+#include "cpu.h"
+#include "customtaskschedule.c"
+#include "game.h"
+#include "ir_uart.h"
+#include "puck.c"
+#include "ring.h"
+#include "system.h"
+
+// the game is included for its tasks and the arrays that main() schedules them
+// from, and its main() is renamed, as the benchmark has its own
+#define main game_main
+#include "game.c"
+#undef main
+
+// sets the ball in ball.c, so it follows ball.c and puck.c
+#include "ballplace.h"
+
+AVR_MCU(F_CPU, "atmega32u2");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+/**
+ * @brief The number of rallies which the tasks are benchmarked over.
+ *
+ */
+#define BENCH_RALLIES 20
+
+/**
+ * @brief The most runs of the tasks in each single-board game.
+ *
+ */
+#define BENCH_SOLO_RUNS 4000
+
+/**
+ * @brief The number of tasks which the custom task scheduler dispatches while
+ * it is benchmarked.
+ *
+ */
+#define BENCH_DISPATCHES 2000
+
+/**
+ * @brief The number of cycles which each of the scheduler's benchmark tasks
+ * busies itself for.
+ *
+ */
+#define BENCH_TASK_CYCLES 150
+
+/**
+ * @brief The number of timer ticks for which each part of the game is scheduled
+ * while the stack is measured, unless it finishes first.
+ *
+ */
+#define BENCH_STACK_TICKS (TIMER_RATE * 3 / 2)
+
+/**
+ * @brief The number of single-board games, and their rematches, which are
+ * scheduled while the stack is measured.
+ *
+ */
+#define BENCH_STACK_GAMES 3
+
+/**
+ * @brief The number of untimed calls which are made before a function is
+ * benchmarked, so that it is benchmarked from a steady state.
+ *
+ */
+#define BENCH_WARM_UP 4
+
+/**
+ * @brief The number of timed calls which each function is benchmarked over.
+ *
+ */
+#define BENCH_REPETITIONS 64
+
+/**
+ * @brief Definition for the Bench type, which holds the cycles taken by a
+ * single function. The median and 99th percentile are only kept for the
+ * functions which are benchmarked with repeated calls.
+ *
+ */
+typedef struct bench_s
+{
+    const char* name;
+    uint16_t calls;
+    uint32_t total_cycles;
+    uint16_t median_cycles;
+    uint16_t p99_cycles;
+    uint16_t worst_cycles;
+} Bench;
+
+/**
+ * @brief The index of each function inside benches.
+ *
+ */
+typedef enum bench_index_e {
+    BENCH_BALL_TASK = 0,
+    BENCH_PUCK_TASK = 1,
+    BENCH_BOARD_TASK = 2,
+    BENCH_SCHEDULE = 3,
+    BENCH_BALL_UPDATE_VALUE = 4,
+    BENCH_PUCK_COLLISION = 5,
+    BENCH_WALL_COLLISION = 6,
+    BENCH_BALL_ENCODE = 7,
+    BENCH_BALL_DECODE = 8,
+    BENCH_PUCK_UPDATE_VALUE = 9,
+    BENCH_TASK_SELECT = 10,
+    BENCH_CPU_TASK = 11,
+    BENCH_BALL_CORRECT = 12
+} BenchIndex;
+
+/**
+ * @brief The functions which are benchmarked. The scheduler's cycles are from
+ * a task returning to the next, already due, task being called.
+ *
+ */
+static Bench benches[] = {{.name = "ball_task"},
+                          {.name = "puck_task"},
+                          {.name = "board_task"},
+                          {.name = "custom_task_schedule"},
+                          {.name = "ball_update_value"},
+                          {.name = "handle_ball_puck_collision"},
+                          {.name = "ball_wall_collision"},
+                          {.name = "ball_pack"},
+                          {.name = "ball_unpack"},
+                          {.name = "puck_update_value"},
+                          {.name = "task_select"},
+                          {.name = "cpu_task"},
+                          {.name = "ball_correct"}};
+
+/**
+ * @brief The cycles taken by each repetition of the function which is
+ * currently being benchmarked, in ascending order.
+ *
+ */
+static uint16_t samples[BENCH_REPETITIONS];
+
+/**
+ * @brief The number of cycles which timing an empty statement takes. This is
+ * taken off every measurement.
+ *
+ */
+static uint16_t timing_cycles;
+
+/**
+ * @brief The cycle at which the last of the scheduler's benchmark tasks
+ * returned.
+ *
+ */
+static uint16_t task_return_cycle;
+
+/**
+ * @brief The number of tasks which the scheduler has dispatched.
+ *
+ */
+static uint16_t dispatches;
+
+/**
+ * @brief The first byte after the static variables, which is where the stack
+ * may grow down to. Defined by the linker.
+ *
+ */
+extern uint8_t __heap_start;
+
+/**
+ * @brief Records how many cycles a function took.
+ *
+ * @param index The function which was timed
+ * @param cycles The number of cycles it took, including timing it
+ */
+static void bench_record(BenchIndex index, uint16_t cycles)
+{
+    Bench* bench = benches + index;
+
+    cycles -= timing_cycles;
+    bench->calls++;
+    bench->total_cycles += cycles;
+    if (cycles > bench->worst_cycles) {
+        bench->worst_cycles = cycles;
+    }
+}
+
+/**
+ * @brief Times a single call, and records it against the function at index.
+ *
+ */
+#define BENCH_CALL(index, call)                                                \
+    do {                                                                       \
+        uint16_t start = TCNT1;                                                \
+        call;                                                                  \
+        bench_record(index, TCNT1 - start);                                    \
+    } while (0)
+
+/**
+ * @brief Adds a repetition's cycles to samples, keeping them in ascending
+ * order, and records it against the function at index.
+ *
+ * @param index The function which was timed
+ * @param repetition The number of repetitions before this one
+ * @param cycles The number of cycles it took, including timing it
+ */
+static void bench_sample(BenchIndex index, uint8_t repetition, uint16_t cycles)
+{
+    uint8_t i = repetition;
+
+    bench_record(index, cycles);
+    cycles -= timing_cycles;
+    while (i > 0 && samples[i - 1] > cycles) {
+        samples[i] = samples[i - 1];
+        i--;
+    }
+    samples[i] = cycles;
+}
+
+/**
+ * @brief Benchmarks a single call, by warming it up and then timing it
+ * BENCH_REPETITIONS times. The setup is run before every call, and is not
+ * timed.
+ *
+ */
+#define BENCH_REPEAT(index, setup, call)                                       \
+    do {                                                                       \
+        for (uint8_t i = 0; i < BENCH_WARM_UP; i++) {                          \
+            setup;                                                             \
+            call;                                                              \
+        }                                                                      \
+        for (uint8_t i = 0; i < BENCH_REPETITIONS; i++) {                      \
+            uint16_t start;                                                    \
+            setup;                                                             \
+            start = TCNT1;                                                     \
+            call;                                                              \
+            bench_sample(index, i, TCNT1 - start);                             \
+        }                                                                      \
+        benches[index].median_cycles = samples[BENCH_REPETITIONS / 2];         \
+        benches[index].p99_cycles =                                            \
+            samples[(BENCH_REPETITIONS * 99 + 99) / 100 - 1];                  \
+    } while (0)
+
+/**
+ * @brief Writes a character to simavr's console. The console prints a line
+ * once it receives a carriage return.
+ *
+ */
+static int console_putc(char c, __unused__ FILE* stream)
+{
+    GPIOR0 = (c == '\n') ? '\r' : c;
+    return 0;
+}
+
+/**
+ * @brief The stream which printf writes to.
+ *
+ */
+static FILE console = FDEV_SETUP_STREAM(console_putc, NULL, _FDEV_SETUP_WRITE);
+
+/**
+ * @brief Runs timer 1 without a prescaler, so that it counts cycles.
+ *
+ */
+static void cycle_counter_init(void)
+{
+    TCCR1A = 0x00;
+    TCCR1B = BIT(CS10);
+    TCCR1C = 0x00;
+}
+
+/**
+ * @brief Finds the most stack that has been used, from the bytes which are
+ * still painted and the deepest that the tasks have used it, as the stack is
+ * painted again after each task.
+ *
+ * @return uint16_t The number of bytes of stack used
+ */
+static uint16_t stack_high_water(void)
+{
+    uint8_t* byte = &__heap_start;
+
+    while (*byte == STATS_STACK_PAINT) {
+        byte++;
+    }
+    if (stats.stack_free_min != STATS_STACK_UNMEASURED &&
+        byte > &__heap_start + stats.stack_free_min) {
+        byte = &__heap_start + stats.stack_free_min;
+    }
+    return RAMEND + 1 - (uint16_t) byte;
+}
+
+/**
+ * @brief Plays rallies against a puck which is moved to a different position
+ * for each rally, so that the ball hits each part of the puck, and misses it.
+ * The tasks are called in the order that the scheduler would call them.
+ *
+ */
+static void bench_rallies(void)
+{
+    board_init();
+    puck_init();
+
+    for (uint8_t rally = 0; rally < BENCH_RALLIES; rally++) {
+        puck.new_bottom = rally % PUCK_POSITIONS;
+        puck.new_top = puck.new_bottom + PUCK_LENGTH - 1;
+        have_ball = true;
+        continue_game = true;
+        ball_init();
+
+        while (have_ball && continue_game) {
+            BENCH_CALL(BENCH_BOARD_TASK, board_task(NULL));
+            BENCH_CALL(BENCH_PUCK_TASK, puck_task(NULL));
+            BENCH_CALL(BENCH_BALL_TASK, ball_task(NULL));
+        }
+    }
+}
+
+/**
+ * @brief Plays single-board games against the CPU opponent, with this board's
+ * puck moved to a different position for each game, so that the CPU opponent
+ * decodes, aims at and returns the ball.
+ *
+ */
+static void bench_solo_rallies(void)
+{
+    ring_solo();
+
+    for (uint8_t rally = 0; rally < BENCH_RALLIES; rally++) {
+        puck.new_bottom = rally % PUCK_POSITIONS;
+        puck.new_top = puck.new_bottom + PUCK_LENGTH - 1;
+        have_ball = true;
+        continue_game = true;
+        ball_init();
+        cpu_init();
+
+        for (uint16_t run = 0; run < BENCH_SOLO_RUNS && continue_game; run++) {
+            board_task(NULL);
+            puck_task(NULL);
+            ball_task(NULL);
+            ball_receive_task(NULL);
+            BENCH_CALL(BENCH_CPU_TASK, cpu_task(NULL));
+        }
+    }
+    ring_init();
+}
+
+/**
+ * @brief Benchmarks the hot-path functions of the ball and the puck, one at a
+ * time.
+ *
+ */
+static void bench_functions(void)
+{
+    uint8_t packet[BALL_PACKET_LENGTH];
+    NavMovement change = PUCK_MOVE_NORTH;
+
+    board_init();
+    puck_init();
+
+    BENCH_REPEAT(BENCH_BALL_UPDATE_VALUE, ball_place(), ball_update_value());
+    BENCH_REPEAT(BENCH_PUCK_COLLISION, ball_place_in_puck(),
+                 handle_ball_puck_collision(TO_FIXED(puck.new_top),
+                                            TO_FIXED(PUCK_COL - 1)));
+    BENCH_REPEAT(BENCH_WALL_COLLISION, ball_place_past_wall(),
+                 ball_wall_collision(&ball));
+    BENCH_REPEAT(BENCH_BALL_ENCODE, ball_place(), ball_pack(&ball, packet));
+    BENCH_REPEAT(BENCH_BALL_DECODE, ball_pack(&ball, packet),
+                 ball_unpack(&ball, packet));
+    // a single broken bit, which is the most work for ball_correct
+    BENCH_REPEAT(BENCH_BALL_CORRECT,
+                 (ball_pack(&ball, packet), packet[1] ^= BIT(2)),
+                 ball_correct(packet));
+    BENCH_REPEAT(BENCH_PUCK_UPDATE_VALUE, change = -change,
+                 puck_update_value(change));
+}
+
+/**
+ * @brief Benchmarks the scheduler's search for the next task, when none of the
+ * tasks are due, so that every task is searched.
+ *
+ */
+static void bench_task_select(void)
+{
+    task_t tasks[] = {
+        {.func = board_task, .period = 1, .reschedule = 300},
+        {.func = puck_task, .period = 1, .reschedule = 200},
+        {.func = ball_task, .period = 1, .reschedule = 100}};
+    task_t* next_task = tasks;
+
+    BENCH_REPEAT(BENCH_TASK_SELECT, ,
+                 next_task = task_select(tasks, ARRAY_SIZE(tasks), 0));
+    // keeps the search from being optimised away
+    if (next_task != tasks + 2) {
+        benches[BENCH_TASK_SELECT].worst_cycles = UINT16_MAX;
+    }
+}
+
+/**
+ * @brief A task for the scheduler's benchmark. It records the scheduler's
+ * cycles whenever it was already due when the last task returned, so that no
+ * time spent waiting is counted.
+ *
+ * @param data The task itself
+ */
+static void bench_schedule_task(void* data)
+{
+    task_t* task = data;
+    uint16_t now = TCNT1;
+
+    if (dispatches == 0) {
+        // the scheduler has just set up timer 1 with its prescaler
+        cycle_counter_init();
+    } else if ((int16_t) (task_return_cycle - task->reschedule) >= 0) {
+        bench_record(BENCH_SCHEDULE, now - task_return_cycle);
+    }
+
+    dispatches++;
+    if (dispatches == BENCH_DISPATCHES) {
+        continue_game = false;
+    }
+
+    while ((uint16_t) (TCNT1 - now) < BENCH_TASK_CYCLES) {
+        continue;
+    }
+    task_return_cycle = TCNT1;
+}
+
+/**
+ * @brief Benchmarks the scheduler, with three tasks whose periods leave them
+ * overdue as often as they are not.
+ *
+ */
+static void bench_schedule(void)
+{
+    task_t tasks[] = {{.func = bench_schedule_task, .period = 300},
+                      {.func = bench_schedule_task, .period = 500},
+                      {.func = bench_schedule_task, .period = 700}};
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(tasks); i++) {
+        tasks[i].data = tasks + i;
+    }
+    continue_game = true;
+    custom_task_schedule(tasks, ARRAY_SIZE(tasks));
+}
+
+/**
+ * @brief The names of the tasks whose stack is listed.
+ *
+ */
+static const struct
+{
+    task_func_t func;
+    const char* name;
+} task_names[] = {{board_task, "board_task"},
+                  {puck_task, "puck_task"},
+                  {ball_task, "ball_task"},
+                  {ball_receive_task, "ball_receive_task"},
+                  {ghost_task, "ghost_task"},
+                  {warm_task, "warm_task"},
+                  {link_task, "link_task"},
+#ifdef TELEMETRY
+                  {telemetry_task, "telemetry_task"},
+#endif
+                  {cpu_task, "cpu_task"},
+                  {text_task, "text_task"},
+                  {negotiate_task, "negotiate_task"},
+                  {rematch_task, "rematch_task"},
+                  {lifetime_task, "lifetime_task"},
+                  {spectator_task, "spectator_task"},
+                  {bench_schedule_task, "custom_task_schedule"}};
+
+/**
+ * @brief The fewest bytes of stack which were left free while each of the
+ * tasks in task_names ran. There are more tasks than stats.h keeps, so they
+ * are taken from stats.h after each part of the game.
+ *
+ */
+static uint16_t task_stack_free[ARRAY_SIZE(task_names)];
+
+/**
+ * @brief Takes the fewest bytes of stack which were left free while each task
+ * ran from stats.h, and then clears the tasks' stats, so that stats.h has
+ * room for the tasks of the next part of the game.
+ *
+ */
+static void bench_stack_collect(void)
+{
+    for (uint8_t i = 0; i < STATS_TASKS_NUM; i++) {
+        for (uint8_t j = 0; j < ARRAY_SIZE(task_names); j++) {
+            if (stats.tasks[i].func == task_names[j].func &&
+                stats.tasks[i].stack_free_min < task_stack_free[j]) {
+                task_stack_free[j] = stats.tasks[i].stack_free_min;
+            }
+        }
+    }
+    memset(stats.tasks, 0, sizeof(stats.tasks));
+}
+
+/**
+ * @brief Paints the free stack again, so that the stack which was used by the
+ * benchmarks before is not taken for the stack of the next task to be
+ * measured.
+ *
+ */
+static void bench_stack_paint(void)
+{
+    cli();
+    for (uint8_t* byte = &__heap_start; byte < (uint8_t*) SP; byte++) {
+        *byte = STATS_STACK_PAINT;
+    }
+    sei();
+}
+
+/**
+ * @brief Stops the part of the game which is being scheduled once its time is
+ * up.
+ *
+ */
+ISR(TIMER1_COMPA_vect)
+{
+    TIMSK1 &= ~BIT(OCIE1A);
+    continue_game = false;
+}
+
+/**
+ * @brief Lets the next part of the game be scheduled for BENCH_STACK_TICKS, or
+ * until it finishes.
+ *
+ */
+static void bench_stack_limit(void)
+{
+    continue_game = true;
+    OCR1A = TCNT1 + BENCH_STACK_TICKS;
+    TIFR1 = BIT(OCF1A);
+    TIMSK1 |= BIT(OCIE1A);
+}
+
+/**
+ * @brief Measures the stack of every task, as the game schedules them: the
+ * text, single-board games against the CPU opponent and their rematches, and
+ * the spectator. The tasks are scheduled from arrays of the same size as
+ * main()'s, so the stack above the scheduler is at least as deep as in the
+ * game. No navswitch is pushed, so the text and the rematches run until their
+ * time is up.
+ *
+ */
+static void bench_stack(void)
+{
+    task_t text_tasks[] = TEXT_TASKS;
+    task_t rematch_tasks[] = REMATCH_TASKS;
+    task_t game_tasks[] = GAME_TASKS;
+    task_t spectator_tasks[] = SPECTATOR_TASKS;
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(task_names); i++) {
+        task_stack_free[i] = STATS_STACK_UNMEASURED;
+    }
+    bench_stack_collect();
+
+    // the tasks run as often as in the game, and the stack is measured from
+    // here on
+    timer_init();
+    bench_stack_paint();
+
+    lifetime_init();
+#ifdef TELEMETRY
+    telemetry_init();
+#endif
+    text_init();
+    board_init();
+    show_initial_text();
+    negotiate_init();
+    ring_solo();
+    bench_stack_limit();
+    custom_task_schedule(text_tasks, ARRAY_SIZE(text_tasks));
+    bench_stack_collect();
+
+    have_ball = true;
+    for (uint8_t game = 0; game < BENCH_STACK_GAMES; game++) {
+        board_init();
+        puck_init();
+        ball_init();
+        ghost_init();
+        cpu_init();
+        warm_start();
+        bench_stack_limit();
+        custom_task_schedule(game_tasks, ARRAY_SIZE(game_tasks));
+        warm_end();
+        bench_stack_collect();
+
+        lifetime_end(lost_game);
+        notify();
+        rematch_init();
+        bench_stack_limit();
+        custom_task_schedule(rematch_tasks, ARRAY_SIZE(rematch_tasks));
+        lifetime_flush();
+        bench_stack_collect();
+        have_ball = lost_game;
+    }
+
+    ring_init();
+    board_init();
+    spectator_init();
+    bench_stack_limit();
+    custom_task_schedule(spectator_tasks, ARRAY_SIZE(spectator_tasks));
+    bench_stack_collect();
+}
+
+/**
+ * @brief Runs every benchmark, and prints the results.
+ *
+ * @return int
+ */
+int main(void)
+{
+    uint16_t start;
+
+    system_init();
+    ir_uart_init();
+    stats_boot();
+    stdout = &console;
+
+    cycle_counter_init();
+    start = TCNT1;
+    timing_cycles = TCNT1 - start;
+
+    bench_rallies();
+    bench_solo_rallies();
+    bench_schedule();
+    bench_functions();
+    bench_task_select();
+    bench_stack();
+
+    printf("csv:function,calls,mean_cycles,median_cycles,p99_cycles,"
+           "worst_cycles\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(benches); i++) {
+        Bench* bench = benches + i;
+        printf("csv:%s,%u,%lu,", bench->name, bench->calls,
+               bench->total_cycles / bench->calls);
+        if (bench->median_cycles != 0) {
+            printf("%u,%u,", bench->median_cycles, bench->p99_cycles);
+        } else {
+            printf(",,");
+        }
+        printf("%u\n", bench->worst_cycles);
+    }
+    printf("csv:stack_bytes,1,%u,,,%u\n", stack_high_water(),
+           stack_high_water());
+
+    // the fewest bytes left between the stack and the static variables, in
+    // all and while each task ran
+    printf("stack:task,free_bytes\n");
+    printf("stack:all,%u\n",
+           RAMEND + 1 - (uint16_t) &__heap_start - stack_high_water());
+    for (uint8_t i = 0; i < ARRAY_SIZE(task_names); i++) {
+        if (task_stack_free[i] != STATS_STACK_UNMEASURED) {
+            printf("stack:%s,%u\n", task_names[i].name, task_stack_free[i]);
+        }
+    }
+
+    // simavr stops once the processor sleeps with interrupts disabled
+    cli();
+    sleep_mode();
+    return 0;
+}
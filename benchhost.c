@@ -0,0 +1,335 @@
+/**
+ * @file benchhost.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Benchmarks the hot-path functions of the ball and the puck on the
+ * host, so that they can be checked for regressions without simavr. Each
+ * function is warmed up and then timed over repeated calls, and its mean,
+ * median, 99th percentile and worst time are printed as CSV, and can also be
+ * written as JSON.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The ball, puck and scheduler modules are included, rather than linked,
+ * so that their static functions can be benchmarked one at a time, as bench.c
+ * does on the ATmega32u2. The times are in nanoseconds on the host, so they
+ * are only comparable with a baseline from the same machine.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host/ballstub.c"
+#ifdef BALL_FEC
+#include "fec.c"
+#endif
+#include "ballplace.h"
+#include "customtaskschedule.c"
+
+// the scheduler's search is benchmarked on its own, so no task is ever timed
+void stats_task(__unused__ task_func_t func, __unused__ timer_tick_t ticks)
+{
+}
+
+void stats_stack(__unused__ task_func_t func)
+{
+}
+
+void stats_wakeup(__unused__ task_func_t func, __unused__ timer_tick_t ticks)
+{
+}
+
+/**
+ * @brief The number of untimed calls which are made before a function is
+ * benchmarked, so that it is benchmarked from a steady state. Can be set at
+ * build time.
+ *
+ */
+#ifndef BENCHHOST_WARM_UP
+#define BENCHHOST_WARM_UP 1000
+#endif
+
+/**
+ * @brief The number of timed samples which each function is benchmarked over.
+ * Can be set at build time.
+ *
+ */
+#ifndef BENCHHOST_REPETITIONS
+#define BENCHHOST_REPETITIONS 2000
+#endif
+
+/**
+ * @brief The number of times that every function is benchmarked. Can be set
+ * at build time.
+ *
+ */
+#ifndef BENCHHOST_ROUNDS
+#define BENCHHOST_ROUNDS 5
+#endif
+
+/**
+ * @brief The number of calls in each timed sample, as a single call is too
+ * short for the host's clock.
+ *
+ */
+#define BENCHHOST_BATCH 256
+
+/**
+ * @brief Definition for the Bench type, which holds the times taken by a
+ * single function, in nanoseconds for each call.
+ *
+ */
+typedef struct bench_s
+{
+    const char* name;
+    unsigned long calls;
+    double total_ns;
+    double median_ns;
+    double p99_ns;
+    double worst_ns;
+} Bench;
+
+/**
+ * @brief The index of each function inside benches.
+ *
+ */
+typedef enum bench_index_e {
+    BENCH_BALL_UPDATE_VALUE = 0,
+    BENCH_PUCK_COLLISION = 1,
+    BENCH_WALL_COLLISION = 2,
+    BENCH_BALL_ENCODE = 3,
+    BENCH_BALL_DECODE = 4,
+    BENCH_BALL_CORRECT = 5,
+    BENCH_PUCK_UPDATE_VALUE = 6,
+    BENCH_TASK_SELECT = 7
+} BenchIndex;
+
+/**
+ * @brief The functions which are benchmarked, named as in bench.c.
+ *
+ */
+static Bench benches[] = {{.name = "ball_update_value"},
+                          {.name = "handle_ball_puck_collision"},
+                          {.name = "ball_wall_collision"},
+                          {.name = "ball_pack"},
+                          {.name = "ball_unpack"},
+                          {.name = "ball_correct"},
+                          {.name = "puck_update_value"},
+                          {.name = "task_select"}};
+
+/**
+ * @brief The time taken by each sample of the function which is currently
+ * being benchmarked, in nanoseconds for each call.
+ *
+ */
+static double samples[BENCHHOST_REPETITIONS];
+
+/**
+ * @brief The time which a sample of the setup alone takes, in nanoseconds for
+ * each call. This is taken off the samples of the function which is currently
+ * being benchmarked.
+ *
+ */
+static double setup_ns;
+
+/**
+ * @brief Reads the host's monotonic clock.
+ *
+ * @return double The time, in nanoseconds
+ */
+static double bench_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/**
+ * @brief Orders two samples, for qsort.
+ *
+ */
+static int sample_compare(const void* a, const void* b)
+{
+    double difference = *(const double*) a - *(const double*) b;
+
+    return (difference > 0) - (difference < 0);
+}
+
+/**
+ * @brief Sorts the samples, and records them against the function at index.
+ * The median, 99th percentile and worst time are kept from the round with the
+ * lowest median, as the host's other work only ever slows a round down.
+ *
+ * @param index The function which was timed
+ */
+static void bench_summarise(BenchIndex index)
+{
+    Bench* bench = benches + index;
+    bool first = (bench->calls == 0);
+
+    qsort(samples, BENCHHOST_REPETITIONS, sizeof(samples[0]), sample_compare);
+    for (unsigned long i = 0; i < BENCHHOST_REPETITIONS; i++) {
+        bench->total_ns += samples[i] * BENCHHOST_BATCH;
+    }
+    bench->calls += (unsigned long) BENCHHOST_REPETITIONS * BENCHHOST_BATCH;
+    if (!first && samples[BENCHHOST_REPETITIONS / 2] >= bench->median_ns) {
+        return;
+    }
+    bench->median_ns = samples[BENCHHOST_REPETITIONS / 2];
+    bench->p99_ns = samples[(BENCHHOST_REPETITIONS * 99UL + 99) / 100 - 1];
+    bench->worst_ns = samples[BENCHHOST_REPETITIONS - 1];
+}
+
+/**
+ * @brief Times BENCHHOST_REPETITIONS samples of BENCHHOST_BATCH calls, with
+ * the setup run before every call, and stores the time of each call in
+ * samples. The setup's own time is taken off.
+ *
+ */
+#define BENCH_SAMPLES(setup, call)                                             \
+    do {                                                                       \
+        for (unsigned long i = 0; i < BENCHHOST_REPETITIONS; i++) {            \
+            double start = bench_now();                                        \
+            for (uint16_t j = 0; j < BENCHHOST_BATCH; j++) {                   \
+                setup;                                                         \
+                call;                                                          \
+            }                                                                  \
+            samples[i] = (bench_now() - start) / BENCHHOST_BATCH - setup_ns;   \
+            if (samples[i] < 0) {                                              \
+                samples[i] = 0;                                                \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Benchmarks a single call, by warming it up, timing the setup alone,
+ * and then timing the setup and the call together.
+ *
+ */
+#define BENCH_REPEAT(index, setup, call)                                       \
+    do {                                                                       \
+        for (unsigned long i = 0; i < BENCHHOST_WARM_UP; i++) {                \
+            setup;                                                             \
+            call;                                                              \
+        }                                                                      \
+        setup_ns = 0;                                                          \
+        BENCH_SAMPLES(setup, );                                                \
+        qsort(samples, BENCHHOST_REPETITIONS, sizeof(samples[0]),              \
+              sample_compare);                                                 \
+        setup_ns = samples[BENCHHOST_REPETITIONS / 2];                         \
+        BENCH_SAMPLES(setup, call);                                            \
+        bench_summarise(index);                                                \
+    } while (0)
+
+/**
+ * @brief Benchmarks the hot-path functions of the ball and the puck, one at a
+ * time, with the same setup as bench.c.
+ *
+ */
+static void bench_functions(void)
+{
+    uint8_t packet[BALL_PACKET_LENGTH];
+    NavMovement change = PUCK_MOVE_NORTH;
+
+    puck_init();
+
+    BENCH_REPEAT(BENCH_BALL_UPDATE_VALUE, ball_place(), ball_update_value());
+    BENCH_REPEAT(BENCH_PUCK_COLLISION, ball_place_in_puck(),
+                 handle_ball_puck_collision(TO_FIXED(puck.new_top),
+                                            TO_FIXED(PUCK_COL - 1)));
+    BENCH_REPEAT(BENCH_WALL_COLLISION, ball_place_past_wall(),
+                 ball_wall_collision(&ball));
+    BENCH_REPEAT(BENCH_BALL_ENCODE, ball_place(), ball_pack(&ball, packet));
+    BENCH_REPEAT(BENCH_BALL_DECODE, ball_pack(&ball, packet),
+                 ball_unpack(&ball, packet));
+    // a single broken bit, which is the most work for ball_correct
+    BENCH_REPEAT(BENCH_BALL_CORRECT,
+                 (ball_pack(&ball, packet), packet[1] ^= BIT(2)),
+                 ball_correct(packet));
+    BENCH_REPEAT(BENCH_PUCK_UPDATE_VALUE, change = -change,
+                 puck_update_value(change));
+}
+
+/**
+ * @brief Benchmarks the scheduler's search for the next task, when none of the
+ * tasks are due, so that every task is searched, as bench.c does.
+ *
+ */
+static void bench_task_select(void)
+{
+    task_t tasks[] = {{.func = puck_task, .period = 1, .reschedule = 300},
+                      {.func = puck_task, .period = 1, .reschedule = 200},
+                      {.func = ball_task, .period = 1, .reschedule = 100}};
+    task_t* next_task = tasks;
+    // read on every call, so that the search is not hoisted out of the loop
+    volatile timer_tick_t now = 0;
+
+    BENCH_REPEAT(BENCH_TASK_SELECT, ,
+                 next_task = task_select(tasks, ARRAY_SIZE(tasks), now));
+    if (next_task != tasks + 2) {
+        fprintf(stderr, "task_select chose the wrong task\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Runs every benchmark, and prints the results as CSV. When run with
+ * -j, the results are also written as JSON to the given file. The CSV has the
+ * same columns as bench.c's, so the same baseline check can be run on it.
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    FILE* json = NULL;
+
+    if (argc == 3 && strcmp(argv[1], "-j") == 0) {
+        if (!(json = fopen(argv[2], "w"))) {
+            perror(argv[2]);
+            return EXIT_FAILURE;
+        }
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [-j json_file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (uint8_t round = 0; round < BENCHHOST_ROUNDS; round++) {
+        bench_functions();
+        bench_task_select();
+    }
+
+    printf("function,calls,mean_ns,median_ns,p99_ns,worst_ns\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(benches); i++) {
+        Bench* bench = benches + i;
+
+        printf("%s,%lu,%.1f,%.1f,%.1f,%.1f\n", bench->name, bench->calls,
+               bench->total_ns / bench->calls, bench->median_ns,
+               bench->p99_ns, bench->worst_ns);
+    }
+
+    if (json) {
+        fprintf(json, "[\n");
+        for (uint8_t i = 0; i < ARRAY_SIZE(benches); i++) {
+            Bench* bench = benches + i;
+
+            fprintf(json,
+                    "  {\"function\": \"%s\", \"calls\": %lu, "
+                    "\"mean_ns\": %.1f, \"median_ns\": %.1f, "
+                    "\"p99_ns\": %.1f, \"worst_ns\": %.1f}%s\n",
+                    bench->name, bench->calls,
+                    bench->total_ns / bench->calls, bench->median_ns,
+                    bench->p99_ns, bench->worst_ns,
+                    (i < ARRAY_SIZE(benches) - 1) ? "," : "");
+        }
+        fprintf(json, "]\n");
+        fclose(json);
+    }
+    return EXIT_SUCCESS;
+}
@@ -17,7 +17,9 @@
 
 #include "ball.h"
 #include "display.h"
+#include "game.h"
 #include "ir_uart.h"
+#include "stats.h"
 
 void board_init(void)
 {
@@ -29,4 +31,5 @@ void board_init(void)
 void board_task(__unused__ void* data)
 {
     display_update();
+    stats_frame();
 }
\ No newline at end of file
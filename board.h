@@ -14,19 +14,30 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include "field.h"
 #include "system.h"
 
 /**
- * @brief Sent by the board which is "claiming" the role of player 1.
+ * @brief Sent by the board which lost the last game, once its user has asked
+ * for a rematch.
  *
  */
-#define I_AM_PLAYER_ONE 1
+#define LOSER_WANTS_REMATCH 3
 
 /**
- * @brief Sent by the board which is "claiming" the role of player 2.
+ * @brief Sent by the board which won the last game, once its user has asked
+ * for a rematch.
  *
  */
-#define I_AM_PLAYER_TWO 2
+#define WINNER_WANTS_REMATCH 4
+
+/**
+ * @brief Added to a rematch request by a board whose IR link broke too many
+ * bytes during the last game, so that the boards agree on the IR rate again
+ * before the rematch. Otherwise, the rate which they agreed on is kept.
+ *
+ */
+#define REMATCH_DEGRADED 0x08
 
 /**
  * @brief The bottom row of the display
@@ -36,7 +47,7 @@
 /**
  * @brief The top row of the display.
  */
-#define TOP_ROW LEDMAT_ROWS_NUM - 1
+#define TOP_ROW FIELD_LAST_ROW
 
 /**
  * @brief Initialises the display/board for a new game.
@@ -0,0 +1,290 @@
+/**
+ * @file cpu.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the CPU opponent.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note The CPU opponent's board is never shown, so its ball is moved and
+ * bounced in the same way as in ball.c, but without drawing it. Its puck is
+ * sent along with the ball, so it is shown as the ghost.
+ */
+
+#include "cpu.h"
+
+#include "ball.h"
+#include "board.h"
+#include "game.h"
+#include "ghost.h"
+#include "puck.h"
+#include "ring.h"
+#include "timer.h"
+
+/**
+ * @brief The number of runs of cpu_task between each row that the puck moves.
+ *
+ */
+#define CPU_PUCK_PERIOD (CPU_TASK_RATE / CPU_PUCK_RATE)
+
+/**
+ * @brief The number of runs of cpu_task before the puck starts to move, once
+ * the ball has been received.
+ *
+ */
+#define CPU_REACTION_RUNS (CPU_REACTION_MS * CPU_TASK_RATE / 1000)
+
+/**
+ * @brief The CPU opponent's ball, as its board would see it, and whether it
+ * has the ball.
+ *
+ */
+static Ball cpu_ball;
+static bool cpu_has_ball = false;
+
+/**
+ * @brief The last message which this board sent, which is yet to be dealt
+ * with, and the message which is yet to be sent back.
+ *
+ */
+static uint8_t inbox[RING_PAYLOAD_MAX];
+static uint8_t inbox_length = 0;
+static uint8_t outbox[RING_PAYLOAD_MAX];
+static uint8_t outbox_length = 0;
+
+/**
+ * @brief The bottom of the puck, and the bottom which it is moving towards.
+ *
+ */
+static int8_t puck_bottom = STARTING_BOTTOM;
+static int8_t aim_bottom = STARTING_BOTTOM;
+
+/**
+ * @brief The runs of cpu_task which are left before the puck starts to move,
+ * and the runs since the puck and the ball last moved.
+ *
+ */
+static uint8_t reaction_runs = 0;
+static uint8_t puck_runs = 0;
+static uint8_t update_runs = 0;
+
+/**
+ * @brief The state of the pseudo-random numbers which decide where the puck
+ * hits the ball, and when it misses on purpose.
+ *
+ */
+static uint16_t random_state = 1;
+
+/**
+ * @brief Gets the next pseudo-random number, with a 16-bit xorshift.
+ *
+ * @return uint16_t The number
+ */
+static uint16_t cpu_random(void)
+{
+    random_state ^= random_state << 7;
+    random_state ^= random_state >> 9;
+    random_state ^= random_state << 8;
+    return random_state;
+}
+
+/**
+ * @brief Queues a single-byte message to be sent back.
+ *
+ * @param data The message
+ */
+static void cpu_send(uint8_t data)
+{
+    outbox[0] = data;
+    outbox_length = 1;
+}
+
+/**
+ * @brief Works out the row in which the ball will reach the puck's column, and
+ * picks where the puck should be. The puck is placed so that the ball hits a
+ * random part of it, or, (10 - CPU_SKILL) times in every 10, so that the ball
+ * misses it. The ball crosses at most FIELD_COLUMNS + 1 columns.
+ *
+ */
+static void cpu_aim(void)
+{
+    Ball path = cpu_ball;
+    int8_t impact;
+
+    do {
+        path.row += path.row_step;
+        path.column += path.column_step;
+        ball_wall_collision(&path);
+    } while (TO_CELL(path.column) < PUCK_COL);
+    impact = TO_CELL(path.row - (path.row_step >> 1));
+
+    aim_bottom = impact - cpu_random() % PUCK_LENGTH;
+    if (cpu_random() % 10 >= CPU_SKILL) {
+        aim_bottom += impact < FIELD_ROWS / 2 ? PUCK_LENGTH : -PUCK_LENGTH;
+    }
+    if (aim_bottom < BOTTOM_ROW) {
+        aim_bottom = BOTTOM_ROW;
+    } else if (aim_bottom > FIELD_ROWS - PUCK_LENGTH) {
+        aim_bottom = FIELD_ROWS - PUCK_LENGTH;
+    }
+}
+
+/**
+ * @brief Deals with a message which this board sent. A ball is taken, and a
+ * request for a rematch is agreed to straight away. Anything else, such as
+ * this board's puck or its loss, needs nothing from the CPU opponent.
+ *
+ * @param message The message
+ */
+static void cpu_handle(const uint8_t* message)
+{
+    // this board's puck can come before its ball, in the same message
+    if ((message[0] & GHOST_PACKET_MASK) == GHOST_PACKET) {
+        if (!(message[0] & GHOST_WITH_BALL)) {
+            return;
+        }
+        message++;
+    }
+
+    if ((message[0] & BALL_PACKET_MASK) == BALL_PACKET) {
+        ball_unpack(&cpu_ball, message);
+        cpu_has_ball = true;
+        reaction_runs = CPU_REACTION_RUNS;
+        puck_runs = 0;
+        update_runs = 0;
+        cpu_aim();
+    } else if (message[0] == LOSER_WANTS_REMATCH) {
+        cpu_send(WINNER_WANTS_REMATCH);
+    } else if (message[0] == WINNER_WANTS_REMATCH) {
+        cpu_send(LOSER_WANTS_REMATCH);
+    }
+}
+
+/**
+ * @brief Moves the puck a row towards where it is aiming.
+ *
+ */
+static void cpu_puck_move(void)
+{
+    if (puck_bottom < aim_bottom) {
+        puck_bottom++;
+    } else if (puck_bottom > aim_bottom) {
+        puck_bottom--;
+    }
+}
+
+/**
+ * @brief Moves the ball across a single column. The ball is sent back once it
+ * reaches the TRANSMIT_COLUMN, and the CPU opponent loses if it misses the
+ * ball.
+ *
+ */
+static void cpu_ball_step(void)
+{
+    fixed_t from_row = cpu_ball.row;
+    fixed_t from_column = cpu_ball.column;
+
+    cpu_ball.row += cpu_ball.row_step;
+    cpu_ball.column += cpu_ball.column_step;
+    ball_wall_collision(&cpu_ball);
+
+    if (cpu_ball.column_step > 0 && TO_CELL(cpu_ball.column) == PUCK_COL) {
+        fixed_t impact_row = cpu_ball.row - (cpu_ball.row_step >> 1);
+        int8_t impact_cell = TO_CELL(impact_row);
+
+        if (impact_cell < puck_bottom ||
+            impact_cell >= puck_bottom + PUCK_LENGTH) {
+            cpu_send(I_HAVE_LOST);
+            cpu_has_ball = false;
+            return;
+        }
+        ball_puck_impact(&cpu_ball, impact_row, puck_bottom,
+                         puck_bottom + PUCK_LENGTH - 1);
+        cpu_ball.row = from_row + cpu_ball.row_step;
+        cpu_ball.column = from_column + cpu_ball.column_step;
+        ball_wall_collision(&cpu_ball);
+    }
+
+    if (TO_CELL(cpu_ball.column) == TRANSMIT_COLUMN) {
+        outbox[0] = GHOST_PACKET | GHOST_WITH_BALL | puck_bottom;
+        ball_pack(&cpu_ball, outbox + 1);
+        outbox_length = 1 + BALL_PACKET_LENGTH;
+        cpu_has_ball = false;
+    }
+}
+
+void cpu_init(void)
+{
+    inbox_length = 0;
+    outbox_length = 0;
+    puck_bottom = STARTING_BOTTOM;
+    aim_bottom = STARTING_BOTTOM;
+    random_state = (random_state ^ timer_get()) | 1;
+
+    // the CPU opponent serves when this board does not
+    cpu_has_ball = ring.solo && !have_ball;
+    if (cpu_has_ball) {
+        cpu_ball = (Ball){.old_row = STARTING_OLD,
+                          .old_column = STARTING_OLD,
+                          .row = TO_FIXED(STARTING_ROW),
+                          .column = TO_FIXED(STARTING_COLUMN),
+                          .row_step = 0,
+                          .column_step = FIXED_ONE,
+                          .velocity = STARTING_VELOCITY,
+                          .stride = 1};
+        reaction_runs = 0;
+        puck_runs = 0;
+        update_runs = 0;
+        cpu_aim();
+    }
+}
+
+void cpu_receive(const uint8_t* payload, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++) {
+        inbox[i] = payload[i];
+    }
+    inbox_length = length;
+}
+
+uint8_t cpu_transmit(uint8_t* payload)
+{
+    uint8_t length = outbox_length;
+
+    for (uint8_t i = 0; i < length; i++) {
+        payload[i] = outbox[i];
+    }
+    outbox_length = 0;
+    return length;
+}
+
+void cpu_task(__unused__ void* data)
+{
+    if (inbox_length > 0) {
+        cpu_handle(inbox);
+        inbox_length = 0;
+        return;
+    }
+    if (!cpu_has_ball) {
+        return;
+    }
+
+    if (reaction_runs > 0) {
+        reaction_runs--;
+    } else if (++puck_runs >= CPU_PUCK_PERIOD) {
+        puck_runs = 0;
+        cpu_puck_move();
+    }
+
+    // the ball moves as often as it would on a real board
+    if (++update_runs >= VARIABLE_PERIOD_NUMERATOR / cpu_ball.velocity) {
+        update_runs = 0;
+        for (uint8_t i = 0; i < cpu_ball.stride && cpu_has_ball; i++) {
+            cpu_ball_step();
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file cpu.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the CPU opponent's function declarations and macro
+ * definitions which are to be shared with other files. In a single-board game,
+ * the CPU opponent takes the place of the other board: the ring hands it every
+ * message which would have been sent over IR, and it plays the ball on a board
+ * of its own, which is never shown, before sending it back.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "system.h"
+
+/**
+ * @brief How well the CPU opponent plays, from 1 to 10. It misses on purpose
+ * (10 - CPU_SKILL) times in every 10. Can be set at build time.
+ *
+ */
+#ifndef CPU_SKILL
+#define CPU_SKILL 7
+#endif
+
+/**
+ * @brief The number of milliseconds after the ball reaches the CPU opponent
+ * before its puck starts to move. Can be set at build time.
+ *
+ */
+#ifndef CPU_REACTION_MS
+#define CPU_REACTION_MS 300
+#endif
+
+/**
+ * @brief The number of rows which the CPU opponent's puck moves each second.
+ *
+ */
+#define CPU_PUCK_RATE 10
+
+/**
+ * @brief Puts the CPU opponent's puck in the middle. In a single-board game,
+ * the CPU opponent serves if this board does not have the ball. Should be
+ * called after ball_init().
+ *
+ */
+void cpu_init(void);
+
+/**
+ * @brief Hands the CPU opponent a message which this board has sent. It is
+ * only stored, so that it costs as little as possible in the task which sent
+ * it, and is dealt with by cpu_task.
+ *
+ * @param payload The message
+ * @param length The number of bytes in the message
+ */
+void cpu_receive(const uint8_t* payload, uint8_t length);
+
+/**
+ * @brief Takes the message which the CPU opponent has to send to this board,
+ * if there is one.
+ *
+ * @param payload Set to the message, which is at most RING_PAYLOAD_MAX bytes
+ * @return uint8_t The number of bytes in the message, or 0 if there is none
+ */
+uint8_t cpu_transmit(uint8_t* payload);
+
+/**
+ * @brief Plays the CPU opponent. Each run does a bounded amount of work: it
+ * either decodes a received ball and aims the puck, or moves the puck by at
+ * most a row and the ball by at most MAX_STRIDE columns. Runs at
+ * CPU_TASK_RATE.
+ *
+ * @param void
+ */
+void cpu_task(__unused__ void* data);
+
+#endif
@@ -4,78 +4,373 @@
     @brief  Simple task scheduler.
 
     @note task_schedule was modified in order to allow the game to end,
-   depending on the Boolean `continue_game`, which is defined in ball.h, rather
+   depending on the Boolean `continue_game`, which is defined in game.h, rather
    than running in an infinite loop.
 
    We (Isaac Daly <idd17@uclive.ac.nz> and Divyean Sivarman <dsi3@uclive.ac.nz>)
    do not claim any ownership over this module or the accompanying header file.
-   Only two lines of source code have been modified:
-   - #include "ball.h" was added
+   The following changes have been made to the source code:
+   - #include "game.h" was added
    - while (1) { was changed to while (continue_game) {
+   - every task is rescheduled to the current time when scheduling starts, as
+     the scheduler is started once for the text and once for each game
+   - each task is timed, and its time is recorded in stats.h
+   - the deepest that each task uses the stack is recorded in stats.h
+   - the search for the next task was moved into task_select, so that it can be
+     benchmarked
+   - when built with TELEMETRY, the telemetry is sent while waiting for the
+     next task, as described in telemetry.h
+   - tasks can be woken by events which are raised from ISRs, as well as
+     periodically, and the time from each event to its task is recorded in
+     stats.h. Events which were raised while no task listened for them are
+     dropped when scheduling starts.
+   - while a protected task keeps starting late, the tasks which can be
+     shed run less often
+   - the watchdog is reset before each task is run
+   - the timer is no longer initialised when scheduling starts, as main()
+     initialises it once, so that times taken before one schedule, such as
+     the time since the reset, are still good during the next
 */
 #include "customtaskschedule.h"
 
-#include "ball.h"
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+
+#include "game.h"
+#include "stats.h"
 #include "system.h"
 #include "task.h"
 #include "timer.h"
 
+#ifdef TELEMETRY
+#include "telemetry.h"
+#endif
+
 /** With 16-bit times the maximum value is 32768.  */
 #define TASK_OVERRUN_MAX 32767
 
+/** The tasks which can be woken, and the event which wakes each.  */
+static task_func_t wake_funcs[TASK_WAKEABLE_MAX];
+static uint8_t wake_events[TASK_WAKEABLE_MAX];
+static uint8_t wake_num;
+
+/** The function which enables each event's interrupt again.  */
+static void (*arms[TASK_EVENTS_NUM])(void);
+
+/** The tasks whose deadlines are protected, and the tasks which can be
+    shed.  */
+static task_func_t protected_funcs[TASK_PROTECTED_MAX];
+static uint8_t protected_num;
+static task_func_t shed_funcs[TASK_SHEDDABLE_MAX];
+static uint8_t shed_num;
+
+/** Whether work is being shed, the number of runs of a protected task
+    since it was shed, and the protected tasks' average lateness.  */
+static bool shedding;
+static uint8_t shed_runs;
+static timer_tick_t lateness;
+
+/** The events which have been raised, with a bit for each, and the time
+    at which each was first raised.  */
+static volatile uint8_t raised;
+static volatile timer_tick_t raised_times[TASK_EVENTS_NUM];
+
+void custom_task_wake_on(uint8_t event, task_func_t func)
+{
+    if (wake_num < TASK_WAKEABLE_MAX) {
+        wake_funcs[wake_num] = func;
+        wake_events[wake_num] = event;
+        wake_num++;
+    }
+}
+
+void custom_task_rearm(uint8_t event, void (*arm)(void))
+{
+    arms[event] = arm;
+}
+
+void custom_task_protect(task_func_t func)
+{
+    if (protected_num < TASK_PROTECTED_MAX) {
+        protected_funcs[protected_num++] = func;
+    }
+}
+
+void custom_task_shed(task_func_t func)
+{
+    if (shed_num < TASK_SHEDDABLE_MAX) {
+        shed_funcs[shed_num++] = func;
+    }
+}
+
+void custom_task_raise(uint8_t event)
+{
+    if (!(raised & BIT(event))) {
+        raised_times[event] = timer_get();
+        raised |= BIT(event);
+    }
+}
+
+/** Find the events which wake a task.
+    @param func the task's function
+    @return the events, with a bit for each  */
+static uint8_t task_wake_mask(task_func_t func)
+{
+    uint8_t i;
+    uint8_t mask = 0;
+
+    for (i = 0; i < wake_num; i++) {
+        if (wake_funcs[i] == func) {
+            mask |= BIT(wake_events[i]);
+        }
+    }
+    return mask;
+}
+
+/** Take the events which wake any of the tasks, and make each task
+    that they wake ready to run now.  A task which is already due keeps
+    its reschedule time, so that it does not lose its place.
+    @param tasks pointer to array of tasks
+    @param num_tasks number of tasks to schedule
+    @param mask the events which wake any of the tasks
+    @param now the current time
+    @param times set to the time at which each taken event was raised
+    @return the events which were taken  */
+static uint8_t task_wake(task_t* tasks, uint8_t num_tasks, uint8_t mask,
+                         timer_tick_t now, timer_tick_t* times)
+{
+    uint8_t i;
+    uint8_t events;
+
+    cli();
+    events = raised & mask;
+    raised &= ~events;
+    for (i = 0; i < TASK_EVENTS_NUM; i++) {
+        if (events & BIT(i)) {
+            times[i] = raised_times[i];
+        }
+    }
+    sei();
+
+    for (i = 0; i < num_tasks; i++) {
+        task_t* task = tasks + i;
+
+        if ((task_wake_mask(task->func) & events) &&
+            (timer_tick_t) (now - task->reschedule) >= TASK_OVERRUN_MAX) {
+            task->reschedule = now;
+        }
+    }
+    return events;
+}
+
+/** Record the time from each event which woke a task to the task
+    running, and enable the events' interrupts again.
+    @param func the task's function
+    @param woken the events which are yet to be handled
+    @param times the time at which each event was raised
+    @param start the time at which the task started
+    @return the events which are still yet to be handled  */
+static uint8_t task_woken(task_func_t func, uint8_t woken,
+                          const timer_tick_t* times, timer_tick_t start)
+{
+    uint8_t i;
+    uint8_t events = task_wake_mask(func) & woken;
+
+    for (i = 0; i < TASK_EVENTS_NUM; i++) {
+        if (events & BIT(i)) {
+            stats_wakeup(func, start - times[i]);
+            if (arms[i]) {
+                arms[i]();
+            }
+        }
+    }
+    return woken & ~events;
+}
+
+/** Check whether a task is in a list of tasks.
+    @param funcs the functions of the tasks in the list
+    @param num the number of tasks in the list
+    @param func the task's function
+    @return true if the task is in the list  */
+static bool task_listed_p(const task_func_t* funcs, uint8_t num,
+                          task_func_t func)
+{
+    uint8_t i;
+
+    for (i = 0; i < num; i++) {
+        if (funcs[i] == func) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Shed work once a protected task's average lateness is too high, and
+    restore it once the lateness has come back down.
+    @param task the task which is about to run
+    @param start the time at which the task starts  */
+static void task_govern(const task_t* task, timer_tick_t start)
+{
+    timer_tick_t late = start - task->reschedule;
+
+    if (!task_listed_p(protected_funcs, protected_num, task->func)) {
+        return;
+    }
+
+    lateness += (late >> TASK_LATENESS_SHIFT) -
+                (lateness >> TASK_LATENESS_SHIFT);
+    if (!shedding) {
+        if (lateness >= task->period / 2) {
+            shedding = true;
+            shed_runs = 0;
+            stats.tasks_shed++;
+        }
+    } else if (shed_runs < TASK_SHED_RUNS) {
+        shed_runs++;
+    } else if (lateness < task->period / 8) {
+        shedding = false;
+        stats.tasks_restored++;
+    }
+}
+
+/** Select the next task to schedule
+    @param tasks pointer to array of tasks (the highest priority
+                 task comes first)
+    @param num_tasks number of tasks to schedule
+    @param now the current time
+    @return the first (highest priority) task that needs to run,
+            otherwise the task which is ready first.
+*/
+static task_t* task_select(task_t* tasks, uint8_t num_tasks, timer_tick_t now)
+{
+    uint8_t i;
+    timer_tick_t sleep_min;
+    task_t* next_task = tasks;
+
+    sleep_min = ~0;
+
+    /* Search array of tasks.  Schedule the first task (highest priority)
+       that needs to run otherwise wait until first task ready.  */
+    for (i = 0; i < num_tasks; i++) {
+        task_t* task = tasks + i;
+        timer_tick_t overrun;
+
+        overrun = now - task->reschedule;
+        if (overrun < TASK_OVERRUN_MAX) {
+            /* Have found a task that can run immediately.  */
+            return task;
+        } else {
+            timer_tick_t sleep;
+
+            sleep = -overrun;
+            if (sleep < sleep_min) {
+                sleep_min = sleep;
+                next_task = task;
+            }
+        }
+    }
+    return next_task;
+}
+
 /** Schedule tasks
     @param tasks pointer to array of tasks (the highest priority
                  task comes first)
     @param num_tasks number of tasks to schedule
-    @return this never returns.
+    @return this returns once continue_game is false.
 */
 void custom_task_schedule(task_t* tasks, uint8_t num_tasks)
 {
     uint8_t i;
+    uint8_t mask = 0;
+    uint8_t woken = 0;
+    uint8_t stale;
+    timer_tick_t times[TASK_EVENTS_NUM];
     timer_tick_t now;
+    timer_tick_t start;
     task_t* next_task;
 
-    timer_init();
     now = timer_get();
 
+    /* Tasks may have been scheduled before, so start them all from now,
+       with nothing shed.  */
+    shedding = false;
+    lateness = 0;
+    for (i = 0; i < num_tasks; i++) {
+        tasks[i].reschedule = now;
+        mask |= task_wake_mask(tasks[i].func);
+    }
+
+    /* An event which was raised while no task listened for it, such as a
+       navswitch press during the text, is dropped, so that it does not wake
+       a task with its old time, and its interrupt is enabled again.  */
+    cli();
+    stale = raised & ~mask;
+    raised &= mask;
+    sei();
+    for (i = 0; i < TASK_EVENTS_NUM; i++) {
+        if ((stale & BIT(i)) && arms[i]) {
+            arms[i]();
+        }
+    }
+
     /* Start by scheduling the first task.  */
     next_task = tasks;
 
     while (continue_game) {
-        timer_tick_t sleep_min;
+        /* Wait until the next task is ready to run, or an event wakes
+           one of the tasks.  */
+        while (!(raised & mask) &&
+               (timer_tick_t) (timer_get() - next_task->reschedule) >=
+                   TASK_OVERRUN_MAX) {
+#ifdef TELEMETRY
+            /* Send telemetry while waiting.  */
+            telemetry_idle();
+#endif
+        }
 
-        /* Wait until the next task is ready to run.  */
-        timer_wait_until(next_task->reschedule);
+        /* Make the woken tasks ready, and select again, so that the
+           priority order is kept.  */
+        if (raised & mask) {
+            now = timer_get();
+            woken |= task_wake(tasks, num_tasks, mask, now, times);
+            next_task = task_select(tasks, num_tasks, now);
+            if ((timer_tick_t) (now - next_task->reschedule) >=
+                TASK_OVERRUN_MAX) {
+                continue;
+            }
+        }
 
-        /* Schedule the task.  */
+        /* Schedule the task, and time how long it takes and how much
+           stack it uses.  A task which never returns leaves the watchdog
+           to reset the board.  */
+        wdt_reset();
+        start = timer_get();
+        task_govern(next_task, start);
         next_task->func(next_task->data);
+        stats_task(next_task->func, timer_get() - start);
+        stats_stack(next_task->func);
+        if (woken) {
+            woken = task_woken(next_task->func, woken, times, start);
+        }
 
-        /* Update the reschedule time.  */
-        next_task->reschedule += next_task->period;
+        /* Update the reschedule time.  A task which is being shed skips
+           the runs which it has missed.  */
+        if (shedding &&
+            task_listed_p(shed_funcs, shed_num, next_task->func)) {
+            next_task->reschedule =
+                start + next_task->period * TASK_SHED_FACTOR;
+        } else {
+            next_task->reschedule += next_task->period;
+        }
 
-        sleep_min = ~0;
         now = timer_get();
+        next_task = task_select(tasks, num_tasks, now);
+    }
 
-        /* Search array of tasks.  Schedule the first task (highest priority)
-           that needs to run otherwise wait until first task ready.  */
-        for (i = 0; i < num_tasks; i++) {
-            task_t* task = tasks + i;
-            timer_tick_t overrun;
-
-            overrun = now - task->reschedule;
-            if (overrun < TASK_OVERRUN_MAX) {
-                /* Have found a task that can run immediately.  */
-                next_task = task;
-                break;
-            } else {
-                timer_tick_t sleep;
-
-                sleep = -overrun;
-                if (sleep < sleep_min) {
-                    sleep_min = sleep;
-                    next_task = task;
-                }
-            }
+    /* Enable the interrupts of any events whose tasks did not get to run.  */
+    for (i = 0; i < TASK_EVENTS_NUM; i++) {
+        if ((woken & BIT(i)) && arms[i]) {
+            arms[i]();
         }
     }
 }
\ No newline at end of file
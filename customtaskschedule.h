@@ -4,7 +4,7 @@
     @brief  Simple task scheduler.
 
     @note task_schedule was modified in order to allow the game to end,
-   depending on the Boolean `continue_game`, which is defined in ball.h, rather
+   depending on the Boolean `continue_game`, which is defined in game.h, rather
    than running in an infinite loop.
 
    We (Isaac Daly <idd17@uclive.ac.nz> and Divyean Sivarman <dsi3@uclive.ac.nz>)
@@ -16,12 +16,78 @@
 
 #include "system.h"
 #include "task.h"
+#include "timer.h"
+
+/** The event raised once a byte has been received over IR.  */
+#define TASK_EVENT_IR 0
+
+/** The event raised once a navswitch press has been queued.  */
+#define TASK_EVENT_NAVSWITCH 1
+
+/** The number of different events.  */
+#define TASK_EVENTS_NUM 2
+
+/** The most tasks which can be woken by events.  */
+#define TASK_WAKEABLE_MAX 6
+
+/** The most tasks which can be protected, and which can be shed.  */
+#define TASK_PROTECTED_MAX 2
+#define TASK_SHEDDABLE_MAX 2
+
+/** The weight of each run in a protected task's average lateness, as a
+    shift: each run counts for an eighth.  */
+#define TASK_LATENESS_SHIFT 3
+
+/** The fewest runs of a protected task for which work is shed.  */
+#define TASK_SHED_RUNS 100
+
+/** The factor by which the periods of the tasks which can be shed are
+    stretched while work is shed.  */
+#define TASK_SHED_FACTOR 2
+
+/** Wake a task when an event is raised, as well as periodically.  A
+    woken task runs at the next dispatch, in priority order with the
+    other tasks that are due, and its next periodic run is a period
+    later.  The time from the event to the task running is recorded
+    in stats.h.  Should be called before scheduling.
+    @param event the event
+    @param func the task's function  */
+void custom_task_wake_on(uint8_t event, task_func_t func);
+
+/** Set the function which is called once a task woken by an event has
+    run, so that the event's interrupt can be enabled again.
+    @param event the event
+    @param arm the function, or NULL  */
+void custom_task_rearm(uint8_t event, void (*arm)(void));
+
+/** Raise an event.  Should only be called from an ISR.  An event which
+    is raised again before a task has been woken by it keeps the time
+    that it was first raised.
+    @param event the event  */
+void custom_task_raise(uint8_t event);
+
+/** Protect a task's deadline.  Once the task's average lateness, from
+    when it was due to when it started, reaches half of its period, the
+    tasks which can be shed run TASK_SHED_FACTOR times less often.  They
+    are restored once they have been shed for at least TASK_SHED_RUNS
+    runs of the task, and its average lateness is below an eighth of its
+    period.  The times that work is shed and restored are counted in
+    stats.h.  Should be called before scheduling.
+    @param func the task's function  */
+void custom_task_protect(task_func_t func);
+
+/** Let a task run less often while a protected task is late.  Its runs
+    which are missed while work is shed are dropped, rather than caught
+    up.  A task which is woken by an event is still woken.  Should be
+    called before scheduling.
+    @param func the task's function  */
+void custom_task_shed(task_func_t func);
 
 /** Schedule tasks
     @param tasks pointer to array of tasks (the highest priority
                  task comes first)
     @param num_tasks number of tasks to schedule
-    @return this never returns.
+    @return this returns once continue_game is false.
 */
 void custom_task_schedule(task_t* tasks, uint8_t num_tasks);
 
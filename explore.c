@@ -0,0 +1,483 @@
+/**
+ * @file explore.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Explores every game state which the ball and the puck can reach, on
+ * the host. Starting from every serve and every ball which the other board can
+ * send, it runs the real ball_update_value and puck_update_value transitions
+ * breadth first, and reports stuck states and states from which the ball can
+ * never be returned.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The ball and puck modules are included, rather than linked, so that
+ * their static functions can be driven directly. They keep their state in
+ * file-scope variables, so each level of the search is split between worker
+ * processes rather than threads. The workers share the visited set, and the
+ * parent waits for all of them at the end of each level.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host/ballstub.c"
+
+/**
+ * @brief The number of cells that the puck can be moved between two updates
+ * of the ball. Can be set at build time.
+ *
+ */
+#ifndef EXPLORE_PUCK_REACH
+#define EXPLORE_PUCK_REACH 1
+#endif
+
+/**
+ * @brief The most states which can be held by a single worker for a level, and
+ * by the search as a whole.
+ *
+ */
+#define EXPLORE_WORKER_STATES (1UL << 22)
+#define EXPLORE_STATES (1UL << 24)
+
+/**
+ * @brief The most examples of each kind of state which are printed.
+ *
+ */
+#define EXPLORE_EXAMPLES 10
+
+/**
+ * @brief The range of each part of a state. The row can be outside the
+ * display, for a ball which has just been received.
+ *
+ */
+#define ROW_MIN (-2 * FIXED_ONE)
+#define ROWS (TO_FIXED(LAST_ROW) + 4 * FIXED_ONE + 1)
+#define ROW_STEPS (2 * MAX_ROW_STEP + 1)
+#define COLUMNS (FIELD_COLUMNS + 1)
+#define STATES                                                                 \
+    ((uint64_t) ROWS * ROW_STEPS * COLUMNS * 2 * MAX_VELOCITY * MAX_STRIDE *   \
+     PUCK_POSITIONS)
+
+/**
+ * @brief The result of updating the ball once.
+ *
+ */
+typedef enum outcome_e {
+    OUTCOME_MOVED = 0,
+    OUTCOME_RETURNED = 1,
+    OUTCOME_LOST = 2
+} Outcome;
+
+/**
+ * @brief Definition for the WorkerResult type, which a worker process uses to
+ * hand its level's results back to the parent.
+ *
+ */
+typedef struct worker_result_s
+{
+    uint32_t found;
+    uint32_t stuck;
+    uint32_t returned;
+    uint32_t lost;
+    bool overflowed;
+} WorkerResult;
+
+/**
+ * @brief The set of states which have been visited, one bit per state. It is
+ * shared between the worker processes.
+ *
+ */
+static uint8_t* visited;
+
+/**
+ * @brief The states which each worker found during the current level, and
+ * their results. Shared between the worker processes.
+ *
+ */
+static uint32_t* found;
+static WorkerResult* results;
+
+/**
+ * @brief Every state which has been visited, in the order that they were
+ * found. Each level is a contiguous run of states.
+ *
+ */
+static uint32_t* states;
+static uint32_t states_num;
+
+/**
+ * @brief The number of states which the search started from.
+ *
+ */
+static uint32_t entry_states_num;
+
+/**
+ * @brief Encodes the current ball and puck into a state.
+ *
+ * @return uint32_t The state
+ */
+static uint32_t state_encode(void)
+{
+    uint32_t state = puck.new_bottom;
+
+    if (ball.column % FIXED_ONE != 0 || ball.row < ROW_MIN ||
+        ball.row >= ROW_MIN + ROWS) {
+        fprintf(stderr, "explore: ball outside of the explored states\n");
+        exit(EXIT_FAILURE);
+    }
+    state = state * MAX_STRIDE + (ball.stride - 1);
+    state = state * MAX_VELOCITY + (ball.velocity - 1);
+    state = state * 2 + (ball.column_step > 0);
+    state = state * COLUMNS + (TO_CELL(ball.column) - TRANSMIT_COLUMN);
+    state = state * ROW_STEPS + (ball.row_step + MAX_ROW_STEP);
+    return state * ROWS + (ball.row - ROW_MIN);
+}
+
+/**
+ * @brief Sets the ball and puck from a state.
+ *
+ * @param state The state
+ */
+static void state_decode(uint32_t state)
+{
+    ball.row = state % ROWS + ROW_MIN;
+    state /= ROWS;
+    ball.row_step = (fixed_t) (state % ROW_STEPS) - MAX_ROW_STEP;
+    state /= ROW_STEPS;
+    ball.column = TO_FIXED((int8_t) (state % COLUMNS) + TRANSMIT_COLUMN);
+    state /= COLUMNS;
+    ball.column_step = (state % 2) ? FIXED_ONE : -FIXED_ONE;
+    state /= 2;
+    ball.velocity = state % MAX_VELOCITY + 1;
+    state /= MAX_VELOCITY;
+    ball.stride = state % MAX_STRIDE + 1;
+    state /= MAX_STRIDE;
+    puck.new_bottom = state;
+    puck.new_top = state + PUCK_LENGTH - 1;
+}
+
+/**
+ * @brief Prints a state in a readable form.
+ *
+ * @param state The state
+ */
+static void state_print(uint32_t state)
+{
+    state_decode(state);
+    printf("  row %d.%03d column %d row_step %d/%d %s velocity %d stride %d "
+           "puck %d-%d\n",
+           ball.row / FIXED_ONE, (ball.row % FIXED_ONE) * 1000 / FIXED_ONE,
+           TO_CELL(ball.column), ball.row_step, FIXED_ONE,
+           ball.column_step > 0 ? "west" : "east", ball.velocity, ball.stride,
+           puck.new_bottom, puck.new_top);
+}
+
+/**
+ * @brief Marks a state as visited.
+ *
+ * @param set The set of states
+ * @param state The state
+ * @return true The state had not been visited before
+ */
+static bool state_visit(uint8_t* set, uint32_t state)
+{
+    uint8_t bit = 1 << (state % 8);
+    return !(__atomic_fetch_or(set + state / 8, bit, __ATOMIC_RELAXED) & bit);
+}
+
+/**
+ * @brief Checks whether a state has been visited.
+ *
+ * @param set The set of states
+ * @param state The state
+ * @return true The state has been visited
+ */
+static bool state_visited(const uint8_t* set, uint32_t state)
+{
+    return set[state / 8] & (1 << (state % 8));
+}
+
+/**
+ * @brief Moves the puck from a state to a new position, with the real puck
+ * transitions, and then updates the ball once.
+ *
+ * @param state The state to start from
+ * @param puck_bottom The position to move the puck to
+ * @param next Set to the next state, if the ball is still on this board
+ * @return Outcome Whether the ball is still on this board
+ */
+static Outcome state_next(uint32_t state, int8_t puck_bottom, uint32_t* next)
+{
+    state_decode(state);
+    have_ball = true;
+    continue_game = true;
+
+    while (puck.new_bottom < puck_bottom) {
+        puck_update_value(PUCK_MOVE_NORTH);
+    }
+    while (puck.new_bottom > puck_bottom) {
+        puck_update_value(PUCK_MOVE_SOUTH);
+    }
+
+    ball_update_value();
+    if (!continue_game) {
+        return OUTCOME_LOST;
+    } else if (!have_ball) {
+        return OUTCOME_RETURNED;
+    }
+    *next = state_encode();
+    return OUTCOME_MOVED;
+}
+
+/**
+ * @brief Adds a state which the search starts from.
+ *
+ */
+static void entry_add(void)
+{
+    for (int8_t bottom = 0; bottom < PUCK_POSITIONS; bottom++) {
+        uint32_t state;
+
+        puck.new_bottom = bottom;
+        puck.new_top = bottom + PUCK_LENGTH - 1;
+        state = state_encode();
+        if (state_visit(visited, state)) {
+            states[states_num++] = state;
+        }
+    }
+}
+
+/**
+ * @brief Adds every serve, and every ball which the other board can send, as
+ * the states which the search starts from. The received balls go through the
+ * real encoding and decoding.
+ *
+ */
+static void entries_add(void)
+{
+    const int8_t eighth = 1 << PACKET_SHIFT;
+
+    have_ball = true;
+    ball_init();
+    entry_add();
+
+    for (fixed_t row = 0; row <= TO_FIXED(LAST_ROW); row += eighth) {
+        for (fixed_t step = -MAX_ROW_STEP; step <= MAX_ROW_STEP;
+             step += eighth) {
+            for (int8_t velocity = 1; velocity <= MAX_VELOCITY; velocity++) {
+                for (uint8_t stride = 1; stride <= MAX_STRIDE; stride <<= 1) {
+                    uint8_t packet[BALL_PACKET_LENGTH];
+
+                    ball.row = row;
+                    ball.row_step = step;
+                    ball.velocity = velocity;
+                    ball.stride = stride;
+                    ball_pack(&ball, packet);
+                    ball_unpack(&ball, packet);
+                    entry_add();
+                }
+            }
+        }
+    }
+    entry_states_num = states_num;
+}
+
+/**
+ * @brief Explores part of a level, in a worker process.
+ *
+ * @param worker The worker's index
+ * @param first The first state of the worker's part of the level
+ * @param last One past the last state of the worker's part of the level
+ */
+static void worker_explore(long worker, uint32_t first, uint32_t last)
+{
+    WorkerResult* result = results + worker;
+    uint32_t* worker_found = found + worker * EXPLORE_WORKER_STATES;
+
+    *result = (WorkerResult){0};
+    for (uint32_t i = first; i < last; i++) {
+        uint32_t state = states[i];
+        state_decode(state);
+        int8_t bottom = puck.new_bottom;
+
+        for (int8_t target = bottom - EXPLORE_PUCK_REACH;
+             target <= bottom + EXPLORE_PUCK_REACH; target++) {
+            uint32_t next;
+            if (target < 0 || target >= PUCK_POSITIONS) {
+                continue;
+            }
+
+            Outcome outcome = state_next(state, target, &next);
+            if (outcome == OUTCOME_LOST) {
+                result->lost++;
+            } else if (outcome == OUTCOME_RETURNED) {
+                result->returned++;
+            } else if (next == state) {
+                result->stuck++;
+            } else if (state_visit(visited, next)) {
+                if (result->found == EXPLORE_WORKER_STATES) {
+                    result->overflowed = true;
+                    return;
+                }
+                worker_found[result->found++] = next;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Maps memory which is shared with the worker processes.
+ *
+ * @param size The number of bytes
+ * @return void* The memory, which is zeroed
+ */
+static void* shared_map(size_t size)
+{
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("explore: mmap");
+        exit(EXIT_FAILURE);
+    }
+    return memory;
+}
+
+/**
+ * @brief Finds every state from which the ball can never be returned, however
+ * the puck is moved. A state can be returned from if any of its moves returns
+ * the ball, or leads to a state which can be returned from, so this is
+ * repeated until nothing changes.
+ *
+ * @return uint8_t* The set of states which can be returned from
+ */
+static uint8_t* returnable_find(void)
+{
+    uint8_t* returnable = calloc(STATES / 8 + 1, 1);
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        for (uint32_t i = states_num; i-- > 0;) {
+            uint32_t state = states[i];
+            if (state_visited(returnable, state)) {
+                continue;
+            }
+
+            state_decode(state);
+            int8_t bottom = puck.new_bottom;
+            for (int8_t target = bottom - EXPLORE_PUCK_REACH;
+                 target <= bottom + EXPLORE_PUCK_REACH; target++) {
+                uint32_t next;
+                if (target < 0 || target >= PUCK_POSITIONS) {
+                    continue;
+                }
+
+                Outcome outcome = state_next(state, target, &next);
+                if (outcome == OUTCOME_RETURNED ||
+                    (outcome == OUTCOME_MOVED &&
+                     state_visited(returnable, next))) {
+                    state_visit(returnable, state);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    return returnable;
+}
+
+/**
+ * @brief Runs the search, and prints what it found.
+ *
+ * @return int EXIT_FAILURE if any stuck states were found
+ */
+int main(void)
+{
+    long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t level_start = 0;
+    uint32_t stuck = 0;
+    uint32_t returned = 0;
+    uint32_t lost = 0;
+
+    visited = shared_map(STATES / 8 + 1);
+    found = shared_map(workers * EXPLORE_WORKER_STATES * sizeof(uint32_t));
+    results = shared_map(workers * sizeof(WorkerResult));
+    states = malloc(EXPLORE_STATES * sizeof(uint32_t));
+
+    entries_add();
+    printf("level,states\n");
+    for (uint32_t level = 0; level_start < states_num; level++) {
+        uint32_t level_end = states_num;
+        uint32_t chunk = (level_end - level_start + workers - 1) / workers;
+
+        printf("%u,%u\n", level, level_end - level_start);
+        fflush(stdout);
+
+        for (long worker = 0; worker < workers; worker++) {
+            uint32_t first = level_start + worker * chunk;
+            uint32_t last = first + chunk;
+            if (first > level_end) {
+                first = level_end;
+            }
+            if (last > level_end) {
+                last = level_end;
+            }
+
+            if (fork() == 0) {
+                worker_explore(worker, first, last);
+                exit(EXIT_SUCCESS);
+            }
+        }
+
+        // the barrier at the end of each level
+        while (wait(NULL) > 0) {
+            continue;
+        }
+
+        for (long worker = 0; worker < workers; worker++) {
+            WorkerResult* result = results + worker;
+            if (result->overflowed ||
+                states_num + result->found > EXPLORE_STATES) {
+                fprintf(stderr, "explore: too many states\n");
+                return EXIT_FAILURE;
+            }
+            for (uint32_t i = 0; i < result->found; i++) {
+                states[states_num++] =
+                    found[worker * EXPLORE_WORKER_STATES + i];
+            }
+            stuck += result->stuck;
+            returned += result->returned;
+            lost += result->lost;
+        }
+        level_start = level_end;
+    }
+
+    uint8_t* returnable = returnable_find();
+    uint32_t never_returnable = 0;
+    uint32_t never_returnable_entries = 0;
+    for (uint32_t i = 0; i < states_num; i++) {
+        if (!state_visited(returnable, states[i])) {
+            never_returnable++;
+            if (i < entry_states_num) {
+                if (never_returnable_entries < EXPLORE_EXAMPLES) {
+                    state_print(states[i]);
+                }
+                never_returnable_entries++;
+            }
+        }
+    }
+
+    printf("states: %u (%u entry states)\n", states_num, entry_states_num);
+    printf("moves returning the ball: %u\n", returned);
+    printf("moves losing the ball: %u\n", lost);
+    printf("stuck states: %u\n", stuck);
+    printf("states which can never be returned: %u (%u entry states, listed "
+           "above)\n",
+           never_returnable, never_returnable_entries);
+    return stuck ? EXIT_FAILURE : EXIT_SUCCESS;
+}
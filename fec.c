@@ -0,0 +1,128 @@
+/**
+ * @file fec.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the forward error correction.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note Each of the 24 bits of a codeword has a 5-bit column: the 16 data bits
+ * have distinct columns with at least two bits set, and check bits 0 to 4 have
+ * the columns 1, 2, 4, 8 and 16. The check bits are chosen so that the columns
+ * of the set bits cancel out, and check bit 5 so that the number of set bits
+ * is even. The syndrome, the columns of the received bits added together,
+ * along with their parity, then gives the column of a single broken bit, while
+ * two broken bits leave the parity even but the syndrome set. Bits 6 and 7 of
+ * the check byte are always clear, so they are given unused columns, which
+ * lets them be corrected too.
+ * @note The columns are added together a nibble at a time, with a table for
+ * each nibble of the codeword, so that decoding takes six lookups rather than
+ * a loop over every bit. The tables are kept in flash.
+ */
+
+#include "fec.h"
+
+#include <avr/pgmspace.h>
+
+/**
+ * @brief Marks a syndrome which is not the column of any bit.
+ *
+ */
+#define FEC_NONE 0xFF
+
+/**
+ * @brief The number of nibbles in a codeword.
+ *
+ */
+#define FEC_NIBBLES (2 * FEC_CODEWORD_LENGTH)
+
+/**
+ * @brief The syndrome of each value of each nibble of the codeword, least
+ * significant nibble of the first data byte first. Bits 0 to 4 hold the
+ * columns of the set bits added together, and bit 5 holds their parity.
+ *
+ */
+static const uint8_t nibble_syndromes[FEC_NIBBLES][16] PROGMEM = {
+    {0x00, 0x23, 0x25, 0x06, 0x26, 0x05, 0x03, 0x20, 0x27, 0x04, 0x02, 0x21,
+     0x01, 0x22, 0x24, 0x07},
+    {0x00, 0x29, 0x2A, 0x03, 0x2B, 0x02, 0x01, 0x28, 0x2C, 0x05, 0x06, 0x2F,
+     0x07, 0x2E, 0x2D, 0x04},
+    {0x00, 0x2D, 0x2E, 0x03, 0x2F, 0x02, 0x01, 0x2C, 0x31, 0x1C, 0x1F, 0x32,
+     0x1E, 0x33, 0x30, 0x1D},
+    {0x00, 0x32, 0x33, 0x01, 0x34, 0x06, 0x07, 0x35, 0x35, 0x07, 0x06, 0x34,
+     0x01, 0x33, 0x32, 0x00},
+    {0x00, 0x21, 0x22, 0x03, 0x24, 0x05, 0x06, 0x27, 0x28, 0x09, 0x0A, 0x2B,
+     0x0C, 0x2D, 0x2E, 0x0F},
+    {0x00, 0x30, 0x20, 0x10, 0x36, 0x06, 0x16, 0x26, 0x37, 0x07, 0x17, 0x27,
+     0x01, 0x31, 0x21, 0x11}};
+
+/**
+ * @brief The bit of the codeword which has each column, counted from bit 0 of
+ * the first data byte, or FEC_NONE.
+ *
+ */
+static const uint8_t column_bits[32] PROGMEM = {
+    21,       16,       17,       0,        18,       1,        2,
+    3,        19,       4,        5,        6,        7,        8,
+    9,        10,       20,       11,       12,       13,       14,
+    15,       22,       23,       FEC_NONE, FEC_NONE, FEC_NONE, FEC_NONE,
+    FEC_NONE, FEC_NONE, FEC_NONE, FEC_NONE};
+
+/**
+ * @brief Adds together the syndromes of the nibbles of some bytes of a
+ * codeword.
+ *
+ * @param bytes The bytes
+ * @param first The index of the first byte within the codeword
+ * @param length The number of bytes
+ * @return uint8_t The syndrome, with its parity in bit 5
+ */
+static uint8_t fec_syndrome(const uint8_t* bytes, uint8_t first,
+                            uint8_t length)
+{
+    uint8_t syndrome = 0;
+
+    for (uint8_t i = 0; i < length; i++) {
+        uint8_t nibble = 2 * (first + i);
+
+        syndrome ^= pgm_read_byte(&nibble_syndromes[nibble][bytes[i] & 0x0F]);
+        syndrome ^= pgm_read_byte(&nibble_syndromes[nibble + 1][bytes[i] >> 4]);
+    }
+    return syndrome;
+}
+
+uint8_t fec_check(const uint8_t* data)
+{
+    uint8_t syndrome = fec_syndrome(data, 0, FEC_DATA_LENGTH);
+    uint8_t check = syndrome & 0x1F;
+
+    // check bits 0 to 4 cancel out the data's columns, and check bit 5 makes
+    // the parity of the whole codeword even
+    syndrome ^= fec_syndrome(&check, FEC_DATA_LENGTH, 1);
+    return check | (syndrome & 0x20);
+}
+
+uint8_t fec_correct(uint8_t* codeword)
+{
+    uint8_t syndrome = fec_syndrome(codeword, 0, FEC_CODEWORD_LENGTH);
+    uint8_t bit;
+
+    if (syndrome == 0) {
+        return FEC_CLEAN;
+    }
+    // an even number of broken bits leaves the parity even
+    if (!(syndrome & 0x20)) {
+        return FEC_DETECTED;
+    }
+
+    bit = pgm_read_byte(&column_bits[syndrome & 0x1F]);
+    if (bit == FEC_NONE) {
+        return FEC_DETECTED;
+    }
+    codeword[bit >> 3] ^= BIT(bit & 0x07);
+    return FEC_CORRECTED;
+}
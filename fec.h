@@ -0,0 +1,59 @@
+/**
+ * @file fec.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the forward error correction's function declarations and
+ * macro definitions which are to be shared with other files. Two data bytes
+ * are protected by a check byte, which together form an extended Hamming
+ * codeword: any single broken bit in the three bytes is corrected, and any two
+ * broken bits are detected.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note For information pertaining to the structure of the transmitted and
+ * received data, see README.md
+ */
+
+#ifndef FEC_H
+#define FEC_H
+
+#include "system.h"
+
+/**
+ * @brief The number of data bytes in a codeword, and the number of bytes in a
+ * codeword with its check byte.
+ *
+ */
+#define FEC_DATA_LENGTH 2
+#define FEC_CODEWORD_LENGTH (FEC_DATA_LENGTH + 1)
+
+/**
+ * @brief What fec_correct found in a codeword: no broken bits, a single broken
+ * bit, which has been corrected, or more broken bits than can be corrected.
+ *
+ */
+#define FEC_CLEAN 0
+#define FEC_CORRECTED 1
+#define FEC_DETECTED 2
+
+/**
+ * @brief Gets the check byte for two data bytes. Bits 6 and 7 of the check
+ * byte are always clear, so that it is never taken for the start of a message.
+ *
+ * @param data The FEC_DATA_LENGTH data bytes
+ * @return uint8_t The check byte
+ */
+uint8_t fec_check(const uint8_t* data);
+
+/**
+ * @brief Corrects a codeword which has been received, in place.
+ *
+ * @param codeword The FEC_DATA_LENGTH data bytes, followed by the check byte
+ * @return uint8_t FEC_CLEAN, FEC_CORRECTED or FEC_DETECTED. The data bytes
+ * should not be used after FEC_DETECTED.
+ */
+uint8_t fec_correct(uint8_t* codeword);
+
+#endif
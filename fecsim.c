@@ -0,0 +1,328 @@
+/**
+ * @file fecsim.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Sends balls over a simulated noisy IR link on the host, with and
+ * without the ball's check byte, and prints what the receiving board would
+ * make of them as CSV. It first checks every ball which can be sent: each
+ * single broken bit must be corrected, each pair of broken bits must be
+ * detected, and a ball which is too broken must be restarted in STARTING_ROW.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The ball and forward error correction modules are included, rather
+ * than linked, so that the ball is packed, corrected and unpacked by the real
+ * code. It is always built with BALL_FEC; the balls without the check byte
+ * just leave it off.
+ * @note Each bit of the ball is broken on its own, with the same chance. The
+ * marker in the top two bits of the first byte is read by the ring before the
+ * ball is corrected, so a ball with a broken marker is never corrected: it is
+ * taken for another message, or, with bit 7 set, for the start of one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "display.h"
+
+// the display is not needed to send the ball
+#define display_pixel_set(column, row, value)
+
+#include "ball.c"
+#include "fec.c"
+
+bool lost_game = false;
+
+bool continue_game = true;
+
+// the lifetime statistics are not needed to send the ball
+void lifetime_hit(__unused__ uint8_t velocity)
+{
+}
+
+// the other board's puck is not needed to send the ball
+uint8_t ghost_merge(__unused__ uint8_t* message)
+{
+    return 0;
+}
+
+bool ghost_receive(__unused__ uint8_t data)
+{
+    return false;
+}
+
+// the simulated boards are never reset
+void warm_handoff(__unused__ const uint8_t* message, __unused__ uint8_t length)
+{
+}
+
+void warm_caught(void)
+{
+}
+
+bool warm_receive(__unused__ uint8_t data, __unused__ uint8_t source)
+{
+    return false;
+}
+
+// the ball is sent over the simulated link instead of the ring
+uint8_t ring_next(void)
+{
+    return 0;
+}
+
+void ring_send(__unused__ uint8_t destination,
+               __unused__ const uint8_t* payload, __unused__ uint8_t length)
+{
+}
+
+void ring_broadcast(__unused__ const uint8_t* payload,
+                    __unused__ uint8_t length)
+{
+}
+
+uint8_t ring_receive(__unused__ uint8_t* payload, __unused__ uint8_t* source)
+{
+    return 0;
+}
+
+void ring_flush(void)
+{
+}
+
+/**
+ * @brief The number of balls which are sent at each bit error rate, with and
+ * without the check byte.
+ *
+ */
+#define FECSIM_BALLS 200000UL
+
+/**
+ * @brief The number of bits in a ball, with and without the check byte.
+ *
+ */
+#define FECSIM_CODED_BITS (8 * BALL_PACKET_LENGTH)
+#define FECSIM_PLAIN_BITS (8 * FEC_DATA_LENGTH)
+
+/**
+ * @brief The chances that each bit is broken which are simulated.
+ *
+ */
+static const double bit_error_rates[] = {1e-4, 1e-3, 1e-2, 5e-2};
+
+/**
+ * @brief Definition for the Tally type, which counts what the receiving board
+ * made of the balls which were sent at a bit error rate.
+ *
+ */
+typedef struct tally_s
+{
+    // the balls which arrived whole, and those which arrived whole after a
+    // broken bit was corrected
+    unsigned long exact;
+    unsigned long corrected;
+    // the balls which were too broken to be corrected, and were restarted
+    unsigned long restarted;
+    // the balls whose marker was broken, so that they were not taken for a
+    // ball, and those which were taken for I_HAVE_LOST
+    unsigned long unframed;
+    unsigned long false_lost;
+    // the balls which were taken for a different ball
+    unsigned long wrong;
+} Tally;
+
+/**
+ * @brief Gets a random ball, which could have been sent by a board.
+ *
+ * @param ball Set to the ball
+ */
+static void fecsim_random_ball(Ball* ball)
+{
+    ball->row = rand() % (TO_FIXED(LAST_ROW) + 1);
+    ball->row_step = rand() % (2 * MAX_ROW_STEP + 1) - MAX_ROW_STEP;
+    ball->velocity = rand() % MAX_VELOCITY + 1;
+    ball->stride = rand() % MAX_STRIDE + 1;
+}
+
+/**
+ * @brief Breaks each bit of a packet with the same chance.
+ *
+ * @param packet The packet
+ * @param bits The number of bits in the packet
+ * @param rate The chance that each bit is broken
+ */
+static void fecsim_channel(uint8_t* packet, uint8_t bits, double rate)
+{
+    for (uint8_t bit = 0; bit < bits; bit++) {
+        if (rand() < rate * ((double) RAND_MAX + 1)) {
+            packet[bit >> 3] ^= BIT(bit & 0x07);
+        }
+    }
+}
+
+/**
+ * @brief Sends a ball over the simulated link, and counts what the receiving
+ * board made of it.
+ *
+ * @param tally The counts for the bit error rate
+ * @param rate The chance that each bit is broken
+ * @param coded Whether the check byte is sent with the ball
+ */
+static void fecsim_send(Tally* tally, double rate, bool coded)
+{
+    Ball sent;
+    uint8_t packet[BALL_PACKET_LENGTH];
+    uint8_t received[BALL_PACKET_LENGTH];
+    uint8_t result = FEC_CLEAN;
+
+    fecsim_random_ball(&sent);
+    ball_pack(&sent, packet);
+    for (uint8_t i = 0; i < BALL_PACKET_LENGTH; i++) {
+        received[i] = packet[i];
+    }
+    fecsim_channel(received, coded ? FECSIM_CODED_BITS : FECSIM_PLAIN_BITS,
+                   rate);
+
+    // as in ball_receive, the marker is checked before the ball is corrected
+    if (received[0] == I_HAVE_LOST) {
+        tally->false_lost++;
+        return;
+    }
+    if ((received[0] & BALL_PACKET_MASK) != BALL_PACKET) {
+        tally->unframed++;
+        return;
+    }
+
+    if (coded) {
+        result = ball_correct(received);
+    }
+    if (result == FEC_DETECTED) {
+        tally->restarted++;
+    } else if (received[0] != packet[0] || received[1] != packet[1]) {
+        tally->wrong++;
+    } else if (result == FEC_CORRECTED) {
+        tally->corrected++;
+    } else {
+        tally->exact++;
+    }
+}
+
+/**
+ * @brief Checks that every ball which can be sent has each single broken bit
+ * corrected, and each pair of broken bits detected.
+ *
+ * @return true Every ball was corrected or detected
+ */
+static bool fecsim_check_codewords(void)
+{
+    uint8_t codeword[FEC_CODEWORD_LENGTH];
+
+    for (uint16_t data = 0; data < BIT(14); data++) {
+        uint8_t packet[FEC_CODEWORD_LENGTH] = {BALL_PACKET | (data >> 8),
+                                               data & 0xFF};
+
+        packet[FEC_DATA_LENGTH] = fec_check(packet);
+        if (packet[FEC_DATA_LENGTH] & BALL_PACKET_MASK) {
+            fprintf(stderr, "fecsim: the check byte of %02x %02x is %02x\n",
+                    packet[0], packet[1], packet[FEC_DATA_LENGTH]);
+            return false;
+        }
+
+        for (uint8_t first = 0; first < FECSIM_CODED_BITS; first++) {
+            for (uint8_t second = first; second < FECSIM_CODED_BITS;
+                 second++) {
+                uint8_t expected =
+                    first == second ? FEC_CORRECTED : FEC_DETECTED;
+                uint8_t result;
+
+                for (uint8_t i = 0; i < FEC_CODEWORD_LENGTH; i++) {
+                    codeword[i] = packet[i];
+                }
+                codeword[first >> 3] ^= BIT(first & 0x07);
+                if (first != second) {
+                    codeword[second >> 3] ^= BIT(second & 0x07);
+                }
+
+                result = fec_correct(codeword);
+                if (result != expected ||
+                    (result == FEC_CORRECTED &&
+                     (codeword[0] != packet[0] || codeword[1] != packet[1] ||
+                      codeword[2] != packet[2]))) {
+                    fprintf(stderr,
+                            "fecsim: %02x %02x %02x with bits %u and %u "
+                            "broken was not %s\n",
+                            packet[0], packet[1], packet[2], first, second,
+                            expected == FEC_CORRECTED ? "corrected"
+                                                      : "detected");
+                    return false;
+                }
+            }
+        }
+        if (fec_correct(packet) != FEC_CLEAN) {
+            fprintf(stderr, "fecsim: %02x %02x %02x was not clean\n",
+                    packet[0], packet[1], packet[2]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that a ball which is too broken to be corrected is restarted
+ * in STARTING_ROW, at the starting velocity.
+ *
+ * @return true The ball was restarted
+ */
+static bool fecsim_check_restart(void)
+{
+    uint8_t packet[BALL_PACKET_LENGTH] = {BALL_PACKET};
+    Ball restarted;
+
+    packet[FEC_DATA_LENGTH] = fec_check(packet);
+    packet[1] ^= BIT(0) | BIT(1);
+    if (ball_correct(packet) != FEC_DETECTED) {
+        fprintf(stderr, "fecsim: a ball with two broken bits was accepted\n");
+        return false;
+    }
+    ball_unpack(&restarted, packet);
+    if (restarted.row != TO_FIXED(STARTING_ROW) || restarted.row_step != 0 ||
+        restarted.velocity != STARTING_VELOCITY || restarted.stride != 1) {
+        fprintf(stderr, "fecsim: the restarted ball is not a new serve\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks the check byte, then sends balls at each bit error rate and
+ * prints what was made of them as CSV.
+ *
+ * @return int EXIT_FAILURE if a ball was not corrected or detected
+ */
+int main(void)
+{
+    if (!fecsim_check_codewords() || !fecsim_check_restart()) {
+        return EXIT_FAILURE;
+    }
+
+    srand(1);
+    printf("bit_error_rate,fec,balls,exact,corrected,restarted,unframed,"
+           "false_lost,wrong,wrong_per_million\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(bit_error_rates); i++) {
+        for (uint8_t coded = 0; coded <= 1; coded++) {
+            Tally tally = {0};
+
+            for (unsigned long ball = 0; ball < FECSIM_BALLS; ball++) {
+                fecsim_send(&tally, bit_error_rates[i], coded);
+            }
+            printf("%g,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f\n",
+                   bit_error_rates[i], coded, FECSIM_BALLS, tally.exact,
+                   tally.corrected, tally.restarted, tally.unframed,
+                   tally.false_lost, tally.wrong,
+                   tally.wrong * 1e6 / FECSIM_BALLS);
+        }
+    }
+    return EXIT_SUCCESS;
+}
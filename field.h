@@ -0,0 +1,81 @@
+/**
+ * @file field.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the field's geometry: the number of rows and columns which
+ * the ball moves in, and the length of the puck. Each can be set at build
+ * time, and every edge and starting position is worked out from them by the
+ * preprocessor, so that a different geometry costs nothing at run time.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The field starts in the bottom left of the display, and fills it by
+ * default. Every board in a ring, and the spectator, must be built with the
+ * same geometry.
+ */
+
+#ifndef FIELD_H
+#define FIELD_H
+
+#include "system.h"
+
+/**
+ * @brief The number of rows in the field. Can be set at build time. At most 8,
+ * as the whole part of the ball's row and the bottom of the ghost puck are
+ * sent in three bits.
+ *
+ */
+#ifndef FIELD_ROWS
+#define FIELD_ROWS LEDMAT_ROWS_NUM
+#endif
+
+/**
+ * @brief The number of columns in the field. Can be set at build time. The
+ * ghost puck, the ball and the puck each need a column of their own.
+ *
+ */
+#ifndef FIELD_COLUMNS
+#define FIELD_COLUMNS LEDMAT_COLS_NUM
+#endif
+
+/**
+ * @brief The number of rows which the puck covers. Can be set at build time.
+ *
+ */
+#ifndef PUCK_LENGTH
+#define PUCK_LENGTH 3
+#endif
+
+#if FIELD_ROWS > 8
+#error "FIELD_ROWS must be at most 8, to fit in the ball and puck bytes"
+#endif
+
+#if FIELD_ROWS > LEDMAT_ROWS_NUM || FIELD_COLUMNS > LEDMAT_COLS_NUM
+#error "The field must fit on the display"
+#endif
+
+#if FIELD_COLUMNS < 3
+#error "FIELD_COLUMNS must be at least 3"
+#endif
+
+#if PUCK_LENGTH < 1 || PUCK_LENGTH >= FIELD_ROWS
+#error "PUCK_LENGTH must be at least 1, and shorter than the field"
+#endif
+
+/**
+ * @brief The number of the last row and column in the field (per zero-based
+ * indexing).
+ *
+ */
+#define FIELD_LAST_ROW (FIELD_ROWS - 1)
+#define FIELD_LAST_COLUMN (FIELD_COLUMNS - 1)
+
+/**
+ * @brief The number of rows which the bottom of the puck can be in.
+ *
+ */
+#define PUCK_POSITIONS (FIELD_ROWS - PUCK_LENGTH + 1)
+
+#endif
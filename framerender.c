@@ -0,0 +1,451 @@
+/**
+ * @file framerender.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Renders a capture of the LED matrix, from host/framecap.c, as text,
+ * as a PPM image for each frame with -p, or as an animated GIF with -g.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Each LED is drawn as a square of -s pixels, 8 by default, with a dark
+ * gap along its bottom and right edges. The PPM images are numbered by frame,
+ * so that they can be turned into a video at the capture's frame rate.
+ * @note A GIF's frames last a whole number of hundredths of a second, so each
+ * run is shown until the hundredth in which it ends, and a run which starts
+ * and ends within the same hundredth is left out. The image data is LZW coded
+ * with a clear code before every other pixel, which keeps every code three bits
+ * wide, rather than compressing it: the images are small, and the runs already
+ * leave out the frames which repeat.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framecap.h"
+
+/**
+ * @brief The most columns and rows in a capture which can be rendered: a row
+ * is a bit of each column's byte.
+ *
+ */
+#define FRAMERENDER_COLUMNS_MAX 16
+#define FRAMERENDER_ROWS_MAX 8
+
+/**
+ * @brief The default and largest number of pixels along each side of an LED.
+ *
+ */
+#define FRAMERENDER_SCALE 8
+#define FRAMERENDER_SCALE_MAX 64
+
+/**
+ * @brief The colours which are drawn, as indexes into the palette.
+ *
+ */
+#define FRAMERENDER_GAP 0
+#define FRAMERENDER_UNLIT 1
+#define FRAMERENDER_LIT 2
+
+/**
+ * @brief The colours of the gaps, unlit LEDs and lit LEDs, and an unused
+ * colour which pads the palette to a power of two for the GIF.
+ *
+ */
+static const uint8_t palette[4][3] = {
+    {0x00, 0x00, 0x00}, {0x30, 0x30, 0x30}, {0xFF, 0x20, 0x20}, {0, 0, 0}};
+
+/**
+ * @brief The GIF's LZW codes, for a palette of four colours.
+ *
+ */
+#define GIF_MIN_CODE_SIZE 2
+#define GIF_CLEAR_CODE 4
+#define GIF_END_CODE 5
+#define GIF_CODE_BITS 3
+
+/**
+ * @brief The most bytes in a GIF data sub-block, and the longest that a GIF
+ * frame can last, in hundredths of a second.
+ *
+ */
+#define GIF_BLOCK_MAX 255
+#define GIF_DELAY_MAX 65535
+
+/**
+ * @brief The capture's size and frame rate.
+ *
+ */
+static uint8_t columns;
+static uint8_t rows;
+static uint16_t rate;
+
+/**
+ * @brief The number of pixels along each side of an LED.
+ *
+ */
+static uint8_t scale = FRAMERENDER_SCALE;
+
+/**
+ * @brief The GIF's codes which have not yet made up a byte, and the sub-block
+ * which is being filled.
+ *
+ */
+static uint32_t gif_bits;
+static uint8_t gif_bit_count;
+static uint8_t gif_block[GIF_BLOCK_MAX];
+static uint8_t gif_block_length;
+
+/**
+ * @brief Reads the capture's header.
+ *
+ * @param capture The capture
+ * @return true The header is valid
+ */
+static bool framerender_header(FILE* capture)
+{
+    uint8_t header[FRAMECAP_HEADER_LENGTH];
+
+    if (fread(header, 1, FRAMECAP_HEADER_LENGTH, capture) !=
+            FRAMECAP_HEADER_LENGTH ||
+        memcmp(header, FRAMECAP_MAGIC, 4) != 0) {
+        return false;
+    }
+    columns = header[4];
+    rows = header[5];
+    rate = header[6] | header[7] << 8;
+    return columns > 0 && columns <= FRAMERENDER_COLUMNS_MAX && rows > 0 &&
+           rows <= FRAMERENDER_ROWS_MAX && rate > 0;
+}
+
+/**
+ * @brief Reads the next run of the capture.
+ *
+ * @param capture The capture
+ * @param frame Set to the run's frame
+ * @return uint8_t The number of frames in the run, or 0 at the end of the
+ * capture, or if it is cut short
+ */
+static uint8_t framerender_run(FILE* capture, uint8_t* frame)
+{
+    int count = getc(capture);
+
+    if (count == EOF || count == 0 ||
+        fread(frame, 1, columns, capture) != columns) {
+        return 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the colour of a pixel of a frame, with the top row of LEDs
+ * first.
+ *
+ * @param frame The frame
+ * @param x The pixel's column
+ * @param y The pixel's row
+ * @return uint8_t The colour's index into the palette
+ */
+static uint8_t framerender_pixel(const uint8_t* frame, uint16_t x, uint16_t y)
+{
+    uint8_t column = x / scale;
+    uint8_t row = rows - 1 - y / scale;
+
+    if (scale >= 4 && (x % scale == scale - 1 || y % scale == scale - 1)) {
+        return FRAMERENDER_GAP;
+    }
+    return frame[column] & BIT(row) ? FRAMERENDER_LIT : FRAMERENDER_UNLIT;
+}
+
+/**
+ * @brief Prints a run as text, in the same way as spectreplay's show.
+ *
+ * @param frame The run's frame
+ * @param first The index of the run's first frame
+ * @param count The number of frames in the run
+ */
+static void framerender_ascii(const uint8_t* frame, uint64_t first,
+                              uint8_t count)
+{
+    printf("%llu ms, %u frames:\n",
+           (unsigned long long) (first * 1000 / rate), count);
+    for (int8_t row = rows - 1; row >= 0; row--) {
+        printf("    ");
+        for (uint8_t column = 0; column < columns; column++) {
+            putchar(frame[column] & BIT(row) ? '#' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * @brief Writes a frame as a PPM image.
+ *
+ * @param prefix The start of the image's file name
+ * @param frame The frame
+ * @param index The index of the frame, which ends the file name
+ * @return true The image was written
+ */
+static bool framerender_ppm(const char* prefix, const uint8_t* frame,
+                            uint64_t index)
+{
+    char path[FILENAME_MAX];
+    FILE* image;
+    bool written;
+
+    snprintf(path, sizeof(path), "%s%06llu.ppm", prefix,
+             (unsigned long long) index);
+    if (!(image = fopen(path, "wb"))) {
+        perror(path);
+        return false;
+    }
+    fprintf(image, "P6\n%u %u\n255\n", columns * scale, rows * scale);
+    for (uint16_t y = 0; y < rows * scale; y++) {
+        for (uint16_t x = 0; x < columns * scale; x++) {
+            fwrite(palette[framerender_pixel(frame, x, y)], 1, 3, image);
+        }
+    }
+    written = !ferror(image);
+    if (fclose(image) != 0 || !written) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a 16-bit number to a GIF, least significant byte first.
+ *
+ * @param gif The GIF
+ * @param value The number
+ */
+static void gif_word(FILE* gif, uint16_t value)
+{
+    putc(value & 0xFF, gif);
+    putc(value >> 8, gif);
+}
+
+/**
+ * @brief Writes a GIF's header, palette, and the extension which loops its
+ * animation.
+ *
+ * @param gif The GIF
+ */
+static void gif_start(FILE* gif)
+{
+    fwrite("GIF89a", 1, 6, gif);
+    gif_word(gif, columns * scale);
+    gif_word(gif, rows * scale);
+    // a global palette of four colours, which is also the background
+    putc(0x81, gif);
+    putc(FRAMERENDER_GAP, gif);
+    putc(0, gif);
+    fwrite(palette, 1, sizeof(palette), gif);
+
+    fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, gif);
+}
+
+/**
+ * @brief Adds a byte of image data to the GIF's sub-block, and writes the
+ * sub-block once it is full.
+ *
+ * @param gif The GIF
+ * @param data The byte
+ */
+static void gif_byte(FILE* gif, uint8_t data)
+{
+    gif_block[gif_block_length++] = data;
+    if (gif_block_length == GIF_BLOCK_MAX) {
+        putc(GIF_BLOCK_MAX, gif);
+        fwrite(gif_block, 1, GIF_BLOCK_MAX, gif);
+        gif_block_length = 0;
+    }
+}
+
+/**
+ * @brief Adds an LZW code to the GIF's image data, least significant bit
+ * first.
+ *
+ * @param gif The GIF
+ * @param code The code
+ */
+static void gif_code(FILE* gif, uint8_t code)
+{
+    gif_bits |= (uint32_t) code << gif_bit_count;
+    gif_bit_count += GIF_CODE_BITS;
+    while (gif_bit_count >= 8) {
+        gif_byte(gif, gif_bits & 0xFF);
+        gif_bits >>= 8;
+        gif_bit_count -= 8;
+    }
+}
+
+/**
+ * @brief Writes a frame to a GIF.
+ *
+ * @param gif The GIF
+ * @param frame The frame
+ * @param delay How long the frame is shown for, in hundredths of a second
+ */
+static void gif_frame(FILE* gif, const uint8_t* frame, uint16_t delay)
+{
+    uint16_t pixels = 0;
+
+    // the frame's delay, with no transparency
+    fwrite("\x21\xF9\x04\x00", 1, 4, gif);
+    gif_word(gif, delay);
+    putc(0, gif);
+    putc(0, gif);
+
+    // the image covers the whole screen, and uses the global palette
+    putc(0x2C, gif);
+    gif_word(gif, 0);
+    gif_word(gif, 0);
+    gif_word(gif, columns * scale);
+    gif_word(gif, rows * scale);
+    putc(0, gif);
+
+    putc(GIF_MIN_CODE_SIZE, gif);
+    gif_bits = 0;
+    gif_bit_count = 0;
+    gif_block_length = 0;
+    for (uint16_t y = 0; y < rows * scale; y++) {
+        for (uint16_t x = 0; x < columns * scale; x++) {
+            // the table never grows past the fourth code after a clear, so
+            // the codes stay three bits wide
+            if (pixels++ % 2 == 0) {
+                gif_code(gif, GIF_CLEAR_CODE);
+            }
+            gif_code(gif, framerender_pixel(frame, x, y));
+        }
+    }
+    gif_code(gif, GIF_END_CODE);
+    if (gif_bit_count > 0) {
+        gif_byte(gif, gif_bits & 0xFF);
+    }
+    if (gif_block_length > 0) {
+        putc(gif_block_length, gif);
+        fwrite(gif_block, 1, gif_block_length, gif);
+    }
+    putc(0, gif);
+}
+
+/**
+ * @brief Writes a frame to a GIF, split into frames of at most GIF_DELAY_MAX
+ * if it lasts longer.
+ *
+ * @param gif The GIF
+ * @param frame The frame
+ * @param delay How long the frame is shown for, in hundredths of a second
+ */
+static void gif_frames(FILE* gif, const uint8_t* frame, uint64_t delay)
+{
+    while (delay > GIF_DELAY_MAX) {
+        gif_frame(gif, frame, GIF_DELAY_MAX);
+        delay -= GIF_DELAY_MAX;
+    }
+    if (delay > 0) {
+        gif_frame(gif, frame, delay);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* ppm_prefix = NULL;
+    const char* gif_path = NULL;
+    FILE* capture;
+    FILE* gif = NULL;
+    uint8_t frame[FRAMERENDER_COLUMNS_MAX];
+    uint8_t shown[FRAMERENDER_COLUMNS_MAX];
+    uint8_t count;
+    uint64_t frames = 0;
+    uint64_t runs = 0;
+    uint64_t shown_until = 0;
+    bool showing = false;
+    int arg = 1;
+
+    for (; arg < argc - 1 && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-p") == 0 && arg + 2 < argc) {
+            ppm_prefix = argv[++arg];
+        } else if (strcmp(argv[arg], "-g") == 0 && arg + 2 < argc) {
+            gif_path = argv[++arg];
+        } else if (strcmp(argv[arg], "-s") == 0 && arg + 2 < argc) {
+            scale = atoi(argv[++arg]);
+        } else {
+            break;
+        }
+    }
+    if (arg != argc - 1 || (ppm_prefix && gif_path) || scale == 0 ||
+        scale > FRAMERENDER_SCALE_MAX) {
+        fprintf(stderr,
+                "usage: %s [-p prefix | -g animation.gif] [-s scale] capture\n",
+                argv[0]);
+        return 2;
+    }
+    if (!(capture = fopen(argv[arg], "rb"))) {
+        perror(argv[arg]);
+        return 1;
+    }
+    if (!framerender_header(capture)) {
+        fprintf(stderr, "%s: not a capture of the LED matrix\n", argv[arg]);
+        fclose(capture);
+        return 1;
+    }
+    if (gif_path) {
+        if (!(gif = fopen(gif_path, "wb"))) {
+            perror(gif_path);
+            fclose(capture);
+            return 1;
+        }
+        gif_start(gif);
+    }
+
+    while ((count = framerender_run(capture, frame))) {
+        if (gif) {
+            // the frame being shown carries on until the hundredth in which
+            // this run starts, and a run which repeats it is merged into it
+            uint64_t until = frames * 100 / rate;
+
+            if (!showing || memcmp(frame, shown, columns) != 0) {
+                if (showing) {
+                    gif_frames(gif, shown, until - shown_until);
+                }
+                shown_until = until;
+                memcpy(shown, frame, columns);
+                showing = true;
+            }
+        } else if (ppm_prefix) {
+            for (uint8_t i = 0; i < count; i++) {
+                if (!framerender_ppm(ppm_prefix, frame, frames + i)) {
+                    fclose(capture);
+                    return 1;
+                }
+            }
+        } else {
+            framerender_ascii(frame, frames, count);
+        }
+        frames += count;
+        runs++;
+    }
+    fclose(capture);
+
+    if (gif) {
+        bool written;
+
+        if (showing) {
+            gif_frames(gif, shown, frames * 100 / rate - shown_until);
+        }
+        putc(0x3B, gif);
+        written = !ferror(gif);
+        if (fclose(gif) != 0 || !written) {
+            perror(gif_path);
+            return 1;
+        }
+    }
+    fprintf(stderr, "%s: %llu frames in %llu runs at %u per second\n",
+            argv[arg], (unsigned long long) frames, (unsigned long long) runs,
+            rate);
+    return 0;
+}
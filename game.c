@@ -14,48 +14,133 @@
 
 #include "game.h"
 
+#include <avr/interrupt.h>
+
 #include "ball.h"
 #include "board.h"
+#include "cpu.h"
 #include "customtaskschedule.h"
+#include "ghost.h"
 #include "ir_uart.h"
+#include "lifetime.h"
+#include "link.h"
+#include "navevent.h"
 #include "navswitch.h"
-#include "pacer.h"
 #include "pio.h"
 #include "puck.h"
+#include "rematch.h"
+#include "ring.h"
+#include "spectator.h"
+#include "stats.h"
 #include "system.h"
 #include "task.h"
 #include "text.h"
+#include "timer.h"
+#include "warm.h"
+
+#ifdef TELEMETRY
+#include "telemetry.h"
+#endif
 
 bool lost_game = false;
 
 bool continue_game = true;
 
 /**
- * @brief Negotiates between the two boards who the first player is.
+ * @brief Indicates whether every board in the ring has been discovered.
  *
  */
-static void negotiate_first_player(void)
+static bool discovered = false;
+
+/**
+ * @brief Prepares the discovery of the boards in the ring, and allows the
+ * custom task scheduler to run the discovery alongside the text.
+ *
+ */
+static void negotiate_init(void)
 {
-    int8_t received_data = 0;
-
-    pacer_wait();
-    if (ir_uart_read_ready_p()) { // receives data first, so is player 2
-        received_data = ir_uart_getc();
-        if (received_data == I_AM_PLAYER_ONE) {
-            ir_uart_putc(I_AM_PLAYER_TWO);
-            have_ball = false;
-        }
-    } else {
-        while (received_data !=
-               I_AM_PLAYER_TWO) {          // sends data first, so is player 1
-            ir_uart_putc(I_AM_PLAYER_ONE); // this board has "claimed" player 1
-            pacer_wait();
-            received_data = ir_uart_getc();
-        }
-        have_ball = true;
+    ring_init();
+    link_init();
+    discovered = false;
+    continue_game = true;
+}
+
+/**
+ * @brief Negotiates the address of each board in the ring, and then the IR
+ * rate. Tokens from the other boards are answered while the text is still
+ * scrolling, and the negotiation completes once every user has pushed the
+ * navswitch and the boards have agreed on the rate. The board which started
+ * the discovery is the first player.
+ *
+ */
+static void negotiate_task(__unused__ void* data)
+{
+    if (!discovered) {
+        discovered = ring_discover(text_pushed);
+    } else if (link_negotiate()) {
+        have_ball = ring.origin;
+        continue_game = false;
     }
 }
 
+/**
+ * @brief Wakes the task which reads IR once a byte has been received. The byte
+ * is left for the task to read, so the interrupt is disabled until the task
+ * has run, and is then enabled again by ir_rearm.
+ *
+ */
+ISR(USART1_RX_vect)
+{
+    UCSR1B &= ~BIT(RXCIE1);
+    custom_task_raise(TASK_EVENT_IR);
+}
+
+/**
+ * @brief Enables the interrupt for a byte being received over IR.
+ *
+ */
+static void ir_rearm(void)
+{
+    UCSR1B |= BIT(RXCIE1);
+}
+
+/**
+ * @brief The tasks which are scheduled for the text, the rematch, the game and
+ * the spectator, highest priority first. They are kept here, rather than in
+ * main(), so that bench.c can schedule the same tasks from arrays of the same
+ * size. The CPU opponent's task is last, so that it is left out unless the
+ * game is against it.
+ *
+ */
+#ifdef TELEMETRY
+#define TELEMETRY_TASK                                                         \
+    {.func = telemetry_task, .period = TASK_RATE / TELEMETRY_TASK_RATE},
+#else
+#define TELEMETRY_TASK
+#endif
+#define TEXT_TASKS                                                             \
+    {{.func = text_task, .period = TASK_RATE / TEXT_TASK_RATE},                \
+     {.func = negotiate_task, .period = TASK_RATE / NEGOTIATE_TASK_RATE}}
+#define REMATCH_TASKS                                                          \
+    {{.func = text_task, .period = TASK_RATE / TEXT_TASK_RATE},                \
+     {.func = rematch_task, .period = TASK_RATE / NEGOTIATE_TASK_RATE},        \
+     {.func = lifetime_task, .period = TASK_RATE / LIFETIME_TASK_RATE},        \
+     {.func = cpu_task, .period = TASK_RATE / CPU_TASK_RATE}}
+#define GAME_TASKS                                                             \
+    {{.func = board_task, .period = TASK_RATE / BOARD_DISPLAY_TASK_RATE},      \
+     {.func = puck_task, .period = TASK_RATE / PUCK_TASK_RATE},                \
+     {.func = ball_task, .period = TASK_RATE / BALL_TASK_RATE},                \
+     {.func = ball_receive_task,                                               \
+      .period = TASK_RATE / BALL_RECEIVE_TASK_RATE},                           \
+     {.func = ghost_task, .period = TASK_RATE / GHOST_TASK_RATE},              \
+     {.func = warm_task, .period = TASK_RATE / WARM_TASK_RATE},                \
+     {.func = link_task, .period = TASK_RATE / LINK_TASK_RATE},                \
+     TELEMETRY_TASK                                                            \
+     {.func = cpu_task, .period = TASK_RATE / CPU_TASK_RATE}}
+#define SPECTATOR_TASKS                                                        \
+    {{.func = board_task, .period = TASK_RATE / BOARD_DISPLAY_TASK_RATE},      \
+     {.func = spectator_task, .period = TASK_RATE / SPECTATOR_TASK_RATE}}
+
 /**
  * @brief Main function for the game.
  *
@@ -63,29 +148,111 @@ static void negotiate_first_player(void)
  */
 int main(void)
 {
-    task_t tasks[] = {
-        {.func = board_task, .period = TASK_RATE / BOARD_DISPLAY_TASK_RATE},
-        {.func = puck_task, .period = TASK_RATE / PUCK_TASK_RATE},
-        {.func = ball_task, .period = TASK_RATE / BALL_TASK_RATE}};
+    task_t text_tasks[] = TEXT_TASKS;
+    task_t rematch_tasks[] = REMATCH_TASKS;
+    task_t game_tasks[] = GAME_TASKS;
+    task_t spectator_tasks[] = SPECTATOR_TASKS;
 
+    bool solo;
+
+    // the cause of the reset is read before system_init() clears it
+    warm_init();
     system_init();
+    timer_init();
+    stats_boot();
     navswitch_init();
+    navevent_init();
     ir_uart_init();
 
+    // the tasks which read IR are woken as soon as a byte arrives, and the
+    // puck as soon as the navswitch is pressed. The ball's and the spectator's
+    // tasks count their runs to time the ball, so they are never woken.
+    custom_task_wake_on(TASK_EVENT_IR, negotiate_task);
+    custom_task_wake_on(TASK_EVENT_IR, ball_receive_task);
+    custom_task_wake_on(TASK_EVENT_IR, rematch_task);
+    custom_task_wake_on(TASK_EVENT_NAVSWITCH, puck_task);
+    custom_task_rearm(TASK_EVENT_IR, ir_rearm);
+    ir_rearm();
+
+    // when the scheduler falls behind, such as while a byte is sent over IR,
+    // the display and the puck run less often, so that the ball keeps its
+    // speed. The puck is still woken by the navswitch.
+    custom_task_protect(ball_task);
+    custom_task_protect(spectator_task);
+    custom_task_shed(board_task);
+    custom_task_shed(puck_task);
+
+    // from here on, the scheduler resets the watchdog before each task, so a
+    // board which hangs is reset, and picks its game up where it left off
+    warm_watchdog();
+
+    // holding the navswitch down while the board is reset makes it a
+    // spectator, which only listens to the other boards, and never returns
+    navswitch_update();
+    if (navswitch_down_p(NAVSWITCH_PUSH)) {
+        board_init();
+        spectator_init();
+        while (1) {
+            custom_task_schedule(spectator_tasks, ARRAY_SIZE(spectator_tasks));
+        }
+    }
+
+    // holding the navswitch in any direction while the board is reset starts a
+    // single-board game against the CPU opponent
+    solo = navswitch_down_p(NAVSWITCH_NORTH) ||
+           navswitch_down_p(NAVSWITCH_EAST) ||
+           navswitch_down_p(NAVSWITCH_SOUTH) ||
+           navswitch_down_p(NAVSWITCH_WEST);
+
+    lifetime_init();
+#ifdef TELEMETRY
+    telemetry_init();
+#endif
+
     text_init();
-    show_initial_text();
 
-    // To exit the application, the user presses the reset button, which kills
-    // the program by itself. Thus, an infinite loop is justified.
-    while (1) {
-        negotiate_first_player();
+    // a board which was reset by a brownout or the watchdog during a game
+    // picks it up where it left off, rather than finding the ring again
+    board_init();
+    if (solo || !warm_restore()) {
+        show_initial_text();
+
+        negotiate_init();
+        if (solo) {
+            ring_solo();
+        }
+        custom_task_schedule(text_tasks, ARRAY_SIZE(text_tasks));
 
         board_init();
         puck_init();
         ball_init();
+        ghost_init();
+        cpu_init();
+        warm_start();
+    }
 
-        custom_task_schedule(tasks, ARRAY_SIZE(tasks));
+    // To exit the application, the user presses the reset button, which kills
+    // the program by itself. Thus, an infinite loop is justified.
+    while (1) {
+        custom_task_schedule(game_tasks, ARRAY_SIZE(game_tasks) - !ring.solo);
+        warm_end();
 
+        // the game's statistics are only written to the EEPROM once it has
+        // finished, alongside the result text
+        lifetime_end(lost_game);
         notify();
+        rematch_init();
+        custom_task_schedule(rematch_tasks,
+                             ARRAY_SIZE(rematch_tasks) - !ring.solo);
+        lifetime_flush();
+
+        // the addresses are kept for the rematch, and the loser serves next
+        have_ball = lost_game;
+        board_init();
+        puck_show();
+        ball_init();
+        ghost_init();
+        cpu_init();
+        warm_start();
     }
 }
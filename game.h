@@ -21,6 +21,72 @@
  */
 #define BALL_TASK_RATE 100
 
+/**
+ * @brief The rate at which the ball is received, when it is not woken by a
+ * byte being received over IR.
+ *
+ */
+#define BALL_RECEIVE_TASK_RATE 100
+
+/**
+ * @brief The rate at which the spectator's task runs. This has to be the
+ * ball's rate, so that the spectator moves the ball as often as the players do.
+ *
+ */
+#define SPECTATOR_TASK_RATE BALL_TASK_RATE
+
+/**
+ * @brief The rate at which the CPU opponent's task runs. This has to be the
+ * ball's rate, so that the CPU opponent moves the ball as often as a player
+ * does.
+ *
+ */
+#define CPU_TASK_RATE BALL_TASK_RATE
+
+/**
+ * @brief The rate at which the ghost puck's task runs.
+ *
+ */
+#define GHOST_TASK_RATE 20
+
+/**
+ * @brief The rate at which the ball and the puck are mirrored for a warm
+ * restart. The ball is picked up from at most a twentieth of a second before
+ * the reset.
+ *
+ */
+#define WARM_TASK_RATE 20
+
+/**
+ * @brief The rate at which the IR link's quality is checked during a game. The
+ * counts only change as bytes are received, so twice a second is plenty.
+ *
+ */
+#define LINK_TASK_RATE 2
+
+/**
+ * @brief The rate at which the lifetime statistics are written to the EEPROM,
+ * while the result text is being shown. Each byte takes 3.3 ms to write, so
+ * this allows for one byte per run.
+ *
+ */
+#define LIFETIME_TASK_RATE 250
+
+/**
+ * @brief The rate at which a telemetry record is taken, when the game is built
+ * with TELEMETRY. Each record takes around a tenth of a second to send.
+ *
+ */
+#define TELEMETRY_TASK_RATE 2
+
+/**
+ * @brief The rate at which the negotiation for who the first player is runs,
+ * while the text is being shown. A byte takes just over 4 ms to send over IR,
+ * so this allows for one byte per run.
+ *
+ */
+#define NEGOTIATE_TASK_RATE 100
+
 /**
  * @brief Indicates whether this game has lost the game. This is checked prior
  * to notifying the player of the result.
@@ -29,8 +95,8 @@
 bool lost_game;
 
 /**
- * @brief Used to indicate to the custom task scheduler whether the game is
- * still continuing.
+ * @brief Used to indicate to the custom task scheduler whether the game, or the
+ * text and negotiation which precede it, is still continuing.
  *
  */
 bool continue_game;
@@ -0,0 +1,169 @@
+/**
+ * @file ghost.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the ghost puck.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ */
+
+#include "ghost.h"
+
+#include "ball.h"
+#include "board.h"
+#include "display.h"
+#include "game.h"
+#include "puck.h"
+#include "ring.h"
+#include "stats.h"
+
+/**
+ * @brief The bottom of the ghost, or GHOST_HIDDEN before the other board's
+ * puck has been received.
+ *
+ */
+#define GHOST_HIDDEN -1
+static int8_t ghost_bottom = GHOST_HIDDEN;
+
+/**
+ * @brief The bottom of this board's puck when it was last sent, or
+ * GHOST_HIDDEN if it is yet to be sent. It is only updated once the ring has
+ * delivered the message which held it.
+ *
+ */
+static int8_t sent_bottom = GHOST_HIDDEN;
+
+/**
+ * @brief The bottom of this board's puck in the message which the ring is
+ * still sending, or GHOST_HIDDEN if there is none, and the ring's number for
+ * that message.
+ *
+ */
+static int8_t sending_bottom = GHOST_HIDDEN;
+static uint8_t sending_number = 0;
+
+/**
+ * @brief The number of runs of ghost_task since the puck was last sent on its
+ * own, and since the ghost last blinked.
+ *
+ */
+static uint8_t send_runs = 0;
+static uint8_t blink_runs = 0;
+
+/**
+ * @brief Indicates whether the ghost is being shown in this blink.
+ *
+ */
+static bool ghost_lit = false;
+
+/**
+ * @brief Shows or hides the ghost. The ball is left alone, if it is in the
+ * ghost's column.
+ *
+ * @param lit Whether the ghost is shown
+ */
+static void ghost_update_display(bool lit)
+{
+    for (int8_t row = ghost_bottom; row < ghost_bottom + PUCK_LENGTH; row++) {
+        if (!ball_in_cell(GHOST_COL, row)) {
+            display_pixel_set(GHOST_COL, row, lit);
+        }
+    }
+}
+
+/**
+ * @brief Records the puck which is being sent as sent, once the ring has
+ * delivered its message. If the ring has dropped the message instead, as it
+ * was replaced by another message or given up on, the puck is left to be sent
+ * again.
+ *
+ */
+static void ghost_confirm(void)
+{
+    if (sending_bottom == GHOST_HIDDEN) {
+        return;
+    }
+    if (ring.delivered_number == sending_number) {
+        sent_bottom = sending_bottom;
+        sending_bottom = GHOST_HIDDEN;
+    } else if (ring.outgoing_number != sending_number || !ring_sending_p()) {
+        sending_bottom = GHOST_HIDDEN;
+    }
+}
+
+/**
+ * @brief Gets the puck byte for this board's puck, and records that it is
+ * being sent. It must be sent with the next call to ring_send.
+ *
+ * @return uint8_t The puck byte
+ */
+static uint8_t ghost_encode(void)
+{
+    sending_bottom = puck.new_bottom;
+    sending_number = ring.outgoing_number + 1;
+    send_runs = 0;
+    return GHOST_PACKET | sending_bottom;
+}
+
+void ghost_init(void)
+{
+    ghost_bottom = GHOST_HIDDEN;
+    sent_bottom = GHOST_HIDDEN;
+    sending_bottom = GHOST_HIDDEN;
+    send_runs = 0;
+    blink_runs = 0;
+    ghost_lit = false;
+}
+
+uint8_t ghost_merge(uint8_t* message)
+{
+    // the ball's message replaces a puck byte which is still waiting to be
+    // sent, so the puck is added unless it has already been delivered
+    ghost_confirm();
+    if (puck.new_bottom == sent_bottom) {
+        return 0;
+    }
+    message[0] = ghost_encode() | GHOST_WITH_BALL;
+    stats.ghost_bytes++;
+    return 1;
+}
+
+bool ghost_receive(uint8_t data)
+{
+    if ((data & GHOST_PACKET_MASK) != GHOST_PACKET) {
+        return false;
+    }
+
+    if (ghost_bottom != GHOST_HIDDEN) {
+        ghost_update_display(false);
+    }
+    // the other board's puck is mirrored, as the ball is
+    ghost_bottom = FIELD_ROWS - PUCK_LENGTH - (data & GHOST_BOTTOM_MASK);
+    ghost_update_display(ghost_lit);
+    return true;
+}
+
+void ghost_task(__unused__ void* data)
+{
+    ghost_confirm();
+    if (send_runs < GHOST_SEND_PERIOD) {
+        send_runs++;
+    } else if (sending_bottom == GHOST_HIDDEN &&
+               puck.new_bottom != sent_bottom && ball_towards_puck()) {
+        uint8_t message = ghost_encode();
+        ring_send(ring_next(), &message, 1);
+        // the header is counted too
+        stats.ghost_bytes += 2;
+    }
+
+    if (ghost_bottom != GHOST_HIDDEN && ++blink_runs >= GHOST_BLINK_PERIOD) {
+        blink_runs = 0;
+        ghost_lit = !ghost_lit;
+        ghost_update_display(ghost_lit);
+    }
+}
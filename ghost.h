@@ -0,0 +1,104 @@
+/**
+ * @file ghost.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the ghost puck's function declarations and macro definitions
+ * which are to be shared with other files. The ghost is the puck of the board
+ * which sends the ball to this board, shown blinking on the far edge of the
+ * display.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note For information pertaining to the structure of the transmitted and
+ * received data, see README.md
+ */
+
+#ifndef GHOST_H
+#define GHOST_H
+
+#include "system.h"
+
+/**
+ * @brief Marks a puck byte, which holds the bottom of the sending board's puck
+ * in bits 0-2. Bits 5-7 are 001, so it is told apart from the ball and the
+ * other single bytes.
+ *
+ */
+#define GHOST_PACKET 0x20
+
+/**
+ * @brief Masks the bits of a byte which mark it as a puck byte.
+ *
+ */
+#define GHOST_PACKET_MASK 0xF0
+
+/**
+ * @brief Set in a puck byte which is followed by a ball, in the same message.
+ *
+ */
+#define GHOST_WITH_BALL 0x08
+
+/**
+ * @brief Masks the bottom of the puck within a puck byte.
+ *
+ */
+#define GHOST_BOTTOM_MASK 0x07
+
+/**
+ * @brief The column in which the ghost is shown.
+ *
+ */
+#define GHOST_COL 0
+
+/**
+ * @brief The number of runs of ghost_task for which the ghost is shown, and
+ * then hidden.
+ *
+ */
+#define GHOST_BLINK_PERIOD 2
+
+/**
+ * @brief The fewest runs of ghost_task between puck bytes which are sent on
+ * their own, which limits them to 10 each second.
+ *
+ */
+#define GHOST_SEND_PERIOD (GHOST_TASK_RATE / 10)
+
+/**
+ * @brief Hides the ghost, and makes sure that this board's puck is sent again.
+ *
+ */
+void ghost_init(void);
+
+/**
+ * @brief Adds this board's puck to a message which holds the ball, if it has
+ * moved since it was last sent. The message must be passed to ring_send next.
+ *
+ * @param message Set to the puck byte, if it is added
+ * @return uint8_t The number of bytes added to the message
+ */
+uint8_t ghost_merge(uint8_t* message);
+
+/**
+ * @brief Moves the ghost, if a byte is a puck byte.
+ *
+ * @param data The first byte of a received message
+ * @return true The byte was a puck byte
+ * @return false The byte was not a puck byte
+ */
+bool ghost_receive(uint8_t data);
+
+/**
+ * @brief Blinks the ghost, and sends this board's puck if it has moved. The
+ * puck is only sent on its own while this board has the ball, and the ball is
+ * heading away from the transmit column, so that the ball's handoff is never
+ * delayed, and the next board is listening. The puck only counts as sent once
+ * the ring has delivered its message, and is sent again if the message is
+ * dropped.
+ *
+ */
+void ghost_task(__unused__ void* data);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * @file eeprom.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Emulates the ATmega32u2's EEPROM on the host, in place of avr-libc's
+ * <avr/eeprom.h>. It counts the writes to each byte, and can lose power part
+ * way through a write.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The address of the last byte of the EEPROM, as in <avr/io.h>.
+ *
+ */
+#ifndef E2END
+#define E2END 0x3FF
+#endif
+
+/**
+ * @brief The number of times that each byte of the EEPROM can be written, per
+ * the ATmega32u2's datasheet.
+ *
+ */
+#define EEPROM_ENDURANCE 100000UL
+
+void eeprom_read_block(void* destination, const void* source, size_t length);
+uint8_t eeprom_read_byte(const uint8_t* address);
+void eeprom_update_byte(uint8_t* address, uint8_t value);
+bool eeprom_is_ready(void);
+
+/**
+ * @brief Erases the EEPROM, and forgets how many times it has been written.
+ *
+ */
+void eeprom_emu_erase(void);
+
+/**
+ * @brief Loses the power after a number of writes. The write after these is
+ * left half done, and every write after it is lost.
+ *
+ * @param writes The number of writes which complete
+ */
+void eeprom_emu_power_cut(uint32_t writes);
+
+/**
+ * @brief Restores the power.
+ *
+ */
+void eeprom_emu_power_on(void);
+
+/**
+ * @brief Gets the most times that any byte of the EEPROM has been written.
+ *
+ * @return uint32_t The number of writes
+ */
+uint32_t eeprom_emu_most_writes(void);
+
+#endif
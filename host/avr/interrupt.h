@@ -0,0 +1,20 @@
+/**
+ * @file interrupt.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Stands in for avr-libc's <avr/interrupt.h> on the host, where there
+ * are no interrupts to enable or disable.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,23 @@
+/**
+ * @file pgmspace.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Stands in for avr-libc's <avr/pgmspace.h> on the host, where tables
+ * which would be kept in flash are kept in memory like any other constant.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(const uint8_t*) (address))
+
+#endif
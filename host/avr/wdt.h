@@ -0,0 +1,19 @@
+/**
+ * @file wdt.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Stands in for avr-libc's <avr/wdt.h> on the host, where there is no
+ * watchdog to reset.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef WDT_H
+#define WDT_H
+
+#define wdt_reset()
+
+#endif
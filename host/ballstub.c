@@ -0,0 +1,104 @@
+/**
+ * @file ballstub.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Includes the ball and puck modules on the host, with the display,
+ * the navswitch, the ring and the other modules which they call stubbed out,
+ * for the host's tools which drive the ball and the puck directly.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note This file is included by explore.c and benchhost.c, rather than
+ * linked, so that they can call the static functions of ball.c and puck.c.
+ */
+
+#include "display.h"
+#include "timer.h"
+
+// the display is not needed to drive the ball and the puck, and the puck is
+// never held down, so its repeat never reads the timer
+#define display_pixel_set(column, row, value)
+#define timer_get() 0
+
+#include "ball.c"
+#include "puck.c"
+
+bool lost_game = false;
+
+bool continue_game = true;
+
+// the puck is moved directly, so there is no navswitch input to follow
+bool navevent_pop(__unused__ NavEvent* event)
+{
+    return false;
+}
+
+bool navevent_down_p(__unused__ uint8_t button)
+{
+    return false;
+}
+
+void navevent_flush(void)
+{
+}
+
+void stats_input(__unused__ timer_tick_t press_time)
+{
+}
+
+// the lifetime statistics are only kept by the game
+void lifetime_hit(__unused__ uint8_t velocity)
+{
+}
+
+// the other board's puck is never drawn
+uint8_t ghost_merge(__unused__ uint8_t* message)
+{
+    return 0;
+}
+
+bool ghost_receive(__unused__ uint8_t data)
+{
+    return false;
+}
+
+// the board is never reset
+void warm_handoff(__unused__ const uint8_t* message, __unused__ uint8_t length)
+{
+}
+
+void warm_caught(void)
+{
+}
+
+bool warm_receive(__unused__ uint8_t data, __unused__ uint8_t source)
+{
+    return false;
+}
+
+// the ball only needs to leave this board, not to reach another one
+uint8_t ring_next(void)
+{
+    return 0;
+}
+
+void ring_send(__unused__ uint8_t destination,
+               __unused__ const uint8_t* payload, __unused__ uint8_t length)
+{
+}
+
+void ring_broadcast(__unused__ const uint8_t* payload,
+                    __unused__ uint8_t length)
+{
+}
+
+uint8_t ring_receive(__unused__ uint8_t* payload, __unused__ uint8_t* source)
+{
+    return 0;
+}
+
+void ring_flush(void)
+{
+}
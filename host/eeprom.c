@@ -0,0 +1,101 @@
+/**
+ * @file eeprom.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the host's EEPROM emulator.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ */
+
+#include "avr/eeprom.h"
+
+#include <string.h>
+
+/**
+ * @brief The contents of the EEPROM, and the number of times that each byte
+ * has been written.
+ *
+ */
+static uint8_t memory[E2END + 1];
+static uint32_t writes[E2END + 1];
+
+/**
+ * @brief Whether the power is on, and the number of writes which can complete
+ * before it is lost.
+ *
+ */
+static bool powered = true;
+static bool cut_pending = false;
+static uint32_t writes_left = 0;
+
+void eeprom_read_block(void* destination, const void* source, size_t length)
+{
+    memcpy(destination, memory + (uintptr_t) source, length);
+}
+
+uint8_t eeprom_read_byte(const uint8_t* address)
+{
+    return memory[(uintptr_t) address];
+}
+
+void eeprom_update_byte(uint8_t* address, uint8_t value)
+{
+    uintptr_t index = (uintptr_t) address;
+
+    // like avr-libc, a byte which already holds the value is not written
+    if (!powered || memory[index] == value) {
+        return;
+    }
+
+    if (cut_pending && writes_left-- == 0) {
+        // the byte has been erased, but not yet programmed
+        memory[index] = 0xFF;
+        powered = false;
+        cut_pending = false;
+        return;
+    }
+    memory[index] = value;
+    writes[index]++;
+}
+
+bool eeprom_is_ready(void)
+{
+    return true;
+}
+
+void eeprom_emu_erase(void)
+{
+    memset(memory, 0xFF, sizeof(memory));
+    memset(writes, 0, sizeof(writes));
+    powered = true;
+    cut_pending = false;
+}
+
+void eeprom_emu_power_cut(uint32_t count)
+{
+    cut_pending = true;
+    writes_left = count;
+}
+
+void eeprom_emu_power_on(void)
+{
+    powered = true;
+    cut_pending = false;
+}
+
+uint32_t eeprom_emu_most_writes(void)
+{
+    uint32_t most = 0;
+
+    for (uint16_t i = 0; i <= E2END; i++) {
+        if (writes[i] > most) {
+            most = writes[i];
+        }
+    }
+    return most;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file framecap.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the host's LED matrix capture.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note The ring has a single producer, the simulation, and a single consumer,
+ * the writer, so it needs no lock: each side only writes its own count, and
+ * publishes it with a release store once the frames which it covers have been
+ * copied. The writer takes every frame which is waiting at once, and only
+ * sleeps when the ring is empty.
+ */
+
+#include "framecap.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief How long the writer sleeps for when the ring is empty (100 us).
+ *
+ */
+#define FRAMECAP_IDLE_NS 100000L
+
+/**
+ * @brief The size of the file's buffer.
+ *
+ */
+#define FRAMECAP_BUFFER_SIZE 65536
+
+/**
+ * @brief The frames which are waiting to be written, and the number of frames
+ * which have been put into and taken out of the ring. The counts wrap, and the
+ * frame which a count refers to is at count % FRAMECAP_RING_SIZE.
+ *
+ */
+static uint8_t ring[FRAMECAP_RING_SIZE][LEDMAT_COLS_NUM];
+static uint32_t produced;
+static uint32_t consumed;
+
+/**
+ * @brief Whether a capture is open, and whether it is being closed, so that
+ * the writer stops once the ring is empty.
+ *
+ */
+static bool capturing = false;
+static bool closing;
+
+/**
+ * @brief The capture's file and writer.
+ *
+ */
+static FILE* file;
+static pthread_t writer;
+
+/**
+ * @brief The run which is being counted by the writer.
+ *
+ */
+static uint8_t run[LEDMAT_COLS_NUM];
+static uint8_t run_frames;
+
+/**
+ * @brief What has been captured. The simulation counts the frames and stalls,
+ * and the writer the runs and bytes.
+ *
+ */
+static Framecap counted;
+
+/**
+ * @brief Writes the run which is being counted to the file.
+ *
+ */
+static void framecap_write_run(void)
+{
+    if (run_frames == 0) {
+        return;
+    }
+    putc(run_frames, file);
+    fwrite(run, 1, LEDMAT_COLS_NUM, file);
+    counted.runs++;
+    counted.bytes += FRAMECAP_RUN_LENGTH;
+    run_frames = 0;
+}
+
+/**
+ * @brief Adds a frame to the run which is being counted, or, if it differs,
+ * writes the run and starts a new one.
+ *
+ * @param frame The frame
+ */
+static void framecap_store(const uint8_t* frame)
+{
+    if (run_frames != 0 && run_frames < FRAMECAP_RUN_MAX &&
+        memcmp(frame, run, LEDMAT_COLS_NUM) == 0) {
+        run_frames++;
+        return;
+    }
+    framecap_write_run();
+    memcpy(run, frame, LEDMAT_COLS_NUM);
+    run_frames = 1;
+}
+
+/**
+ * @brief Writes the frames in the ring to the file until the capture is
+ * closed.
+ *
+ * @param unused Unused
+ * @return void* NULL
+ */
+static void* framecap_writer(__unused__ void* unused)
+{
+    const struct timespec idle = {.tv_nsec = FRAMECAP_IDLE_NS};
+    uint32_t taken = consumed;
+
+    for (;;) {
+        uint32_t given = __atomic_load_n(&produced, __ATOMIC_ACQUIRE);
+
+        if (taken == given) {
+            // closing is set after the last frame, so one more look at the
+            // ring finds any frame which was put in before it
+            if (__atomic_load_n(&closing, __ATOMIC_ACQUIRE)) {
+                if (taken == __atomic_load_n(&produced, __ATOMIC_ACQUIRE)) {
+                    break;
+                }
+                continue;
+            }
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        while (taken != given) {
+            framecap_store(ring[taken % FRAMECAP_RING_SIZE]);
+            taken++;
+        }
+        __atomic_store_n(&consumed, taken, __ATOMIC_RELEASE);
+    }
+    framecap_write_run();
+    return NULL;
+}
+
+bool framecap_open(const char* path, uint16_t rate)
+{
+    uint8_t header[FRAMECAP_HEADER_LENGTH] = {
+        FRAMECAP_MAGIC[0], FRAMECAP_MAGIC[1], FRAMECAP_MAGIC[2],
+        FRAMECAP_MAGIC[3], LEDMAT_COLS_NUM,   LEDMAT_ROWS_NUM,
+        rate & 0xFF,       rate >> 8};
+
+    if (capturing || !(file = fopen(path, "wb"))) {
+        return false;
+    }
+    setvbuf(file, NULL, _IOFBF, FRAMECAP_BUFFER_SIZE);
+    fwrite(header, 1, FRAMECAP_HEADER_LENGTH, file);
+
+    counted = (Framecap){.bytes = FRAMECAP_HEADER_LENGTH};
+    produced = 0;
+    consumed = 0;
+    closing = false;
+    run_frames = 0;
+    if (pthread_create(&writer, NULL, framecap_writer, NULL) != 0) {
+        fclose(file);
+        return false;
+    }
+    capturing = true;
+    return true;
+}
+
+void framecap_frame(const uint8_t* columns)
+{
+    uint32_t given = produced;
+
+    if (!capturing) {
+        return;
+    }
+
+    if (given - __atomic_load_n(&consumed, __ATOMIC_ACQUIRE) ==
+        FRAMECAP_RING_SIZE) {
+        counted.stalls++;
+        do {
+            sched_yield();
+        } while (given - __atomic_load_n(&consumed, __ATOMIC_ACQUIRE) ==
+                 FRAMECAP_RING_SIZE);
+    }
+
+    memcpy(ring[given % FRAMECAP_RING_SIZE], columns, LEDMAT_COLS_NUM);
+    __atomic_store_n(&produced, given + 1, __ATOMIC_RELEASE);
+    counted.frames++;
+}
+
+bool framecap_close(Framecap* counts)
+{
+    bool written;
+
+    if (!capturing) {
+        return false;
+    }
+    __atomic_store_n(&closing, true, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+    capturing = false;
+
+    written = !ferror(file);
+    written = fclose(file) == 0 && written;
+    *counts = counted;
+    return written;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file framecap.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Captures the LED matrix on the host, after each display update, to a
+ * file which framerender turns into text, images or an animation. The
+ * simulation hands each frame to a ring, without locking, and a thread of its
+ * own writes the ring to the file, so that a simulation which runs many times
+ * faster than real time is not held up by the disk.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note A capture starts with a FRAMECAP_HEADER_LENGTH byte header: the magic
+ * "LEDF", the number of columns and rows, then the frames per second, least
+ * significant byte first. It is followed by runs of identical frames, each of
+ * which is a count of frames, from 1 to FRAMECAP_RUN_MAX, followed by a byte
+ * for each column, with row 0 in bit 0. A display which does not change is
+ * stored once per FRAMECAP_RUN_MAX frames.
+ */
+
+#ifndef FRAMECAP_H
+#define FRAMECAP_H
+
+#include "system.h"
+
+/**
+ * @brief The magic which a capture starts with, and the length of its header.
+ *
+ */
+#define FRAMECAP_MAGIC "LEDF"
+#define FRAMECAP_HEADER_LENGTH 8
+
+/**
+ * @brief The most frames in a run.
+ *
+ */
+#define FRAMECAP_RUN_MAX 255
+
+/**
+ * @brief The length of a run: its count, then the frame.
+ *
+ */
+#define FRAMECAP_RUN_LENGTH (1 + LEDMAT_COLS_NUM)
+
+/**
+ * @brief The number of frames which the ring holds. At 250 frames per second,
+ * this is over a minute of the display. Must be a power of two.
+ *
+ */
+#define FRAMECAP_RING_SIZE 16384
+
+/**
+ * @brief Definition for the Framecap type, which counts what has been
+ * captured.
+ *
+ */
+typedef struct framecap_s
+{
+    // the frames which were captured, and the runs which they were stored as
+    uint32_t frames;
+    uint32_t runs;
+    // the number of bytes which were written to the file
+    uint32_t bytes;
+    // the frames which found the ring full, and waited for the writer
+    uint32_t stalls;
+} Framecap;
+
+/**
+ * @brief Opens a capture, and starts its writer.
+ *
+ * @param path The file to write
+ * @param rate The number of frames per second
+ * @return true The capture was opened
+ * @return false The file could not be written, or the writer not started
+ */
+bool framecap_open(const char* path, uint16_t rate);
+
+/**
+ * @brief Captures a frame. It is copied into the ring, so the caller can
+ * change the display straight away. This only waits when the writer has
+ * fallen FRAMECAP_RING_SIZE frames behind.
+ *
+ * @param columns A byte for each of the LEDMAT_COLS_NUM columns, with row 0 in
+ * bit 0
+ */
+void framecap_frame(const uint8_t* columns);
+
+/**
+ * @brief Writes the frames which are left in the ring, and closes the
+ * capture.
+ *
+ * @param counts Set to what was captured
+ * @return true Every frame was written
+ */
+bool framecap_close(Framecap* counts);
+
+#endif
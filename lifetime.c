@@ -0,0 +1,169 @@
+/**
+ * @file lifetime.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the lifetime statistics.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note A record is written over the oldest record, and its sequence is
+ * written last, so the newest complete record is never lost, even if the power
+ * is lost part way through a write.
+ */
+
+#include "lifetime.h"
+
+#include <avr/eeprom.h>
+
+Lifetime lifetime;
+
+/**
+ * @brief The record which is being written, and the slot that it is being
+ * written to.
+ *
+ */
+static LifetimeRecord record;
+static uint8_t slot = 0;
+
+/**
+ * @brief The number of bytes of the record which have been written. The record
+ * has been written once this is sizeof(record).
+ *
+ */
+static uint8_t written = sizeof(LifetimeRecord);
+
+/**
+ * @brief The number of times that this board's puck has hit the ball in this
+ * game.
+ *
+ */
+static uint8_t rally = 0;
+
+/**
+ * @brief Adds a byte to a CRC-8 (polynomial 0x07).
+ *
+ * @param crc The CRC so far
+ * @param data The byte
+ * @return uint8_t The CRC
+ */
+static uint8_t lifetime_crc_update(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+/**
+ * @brief Calculates the CRC of a record, over every byte but the CRC.
+ *
+ * @param entry The record
+ * @return uint8_t The CRC
+ */
+static uint8_t lifetime_crc(const LifetimeRecord* entry)
+{
+    const uint8_t* data = (const uint8_t*) &entry->lifetime;
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < sizeof(Lifetime); i++) {
+        crc = lifetime_crc_update(crc, data[i]);
+    }
+    return lifetime_crc_update(crc, entry->sequence);
+}
+
+/**
+ * @brief Gets the address of a slot in the EEPROM.
+ *
+ * @param index The slot
+ * @return uint8_t* The address of the slot's first byte
+ */
+static uint8_t* lifetime_slot(uint8_t index)
+{
+    return (uint8_t*) (uintptr_t) (index * sizeof(LifetimeRecord));
+}
+
+void lifetime_init(void)
+{
+    LifetimeRecord newest = {.sequence = LIFETIME_ERASED};
+    uint8_t newest_slot = LIFETIME_SLOTS - 1;
+
+    for (uint8_t i = 0; i < LIFETIME_SLOTS; i++) {
+        LifetimeRecord entry;
+
+        eeprom_read_block(&entry, lifetime_slot(i), sizeof(entry));
+        if (entry.sequence == LIFETIME_ERASED ||
+            entry.crc != lifetime_crc(&entry)) {
+            continue;
+        }
+        // the sequence wraps, so it is compared by its difference
+        if (newest.sequence == LIFETIME_ERASED ||
+            (int8_t) (entry.sequence - newest.sequence) > 0) {
+            newest = entry;
+            newest_slot = i;
+        }
+    }
+
+    if (newest.sequence == LIFETIME_ERASED) {
+        newest = (LifetimeRecord){.sequence = 0};
+    }
+    record = newest;
+    lifetime = newest.lifetime;
+    slot = newest_slot;
+    written = sizeof(LifetimeRecord);
+    rally = 0;
+}
+
+void lifetime_hit(uint8_t velocity)
+{
+    rally++;
+    if (rally > lifetime.longest_rally) {
+        lifetime.longest_rally = rally;
+    }
+    if (velocity > lifetime.top_velocity) {
+        lifetime.top_velocity = velocity;
+    }
+}
+
+void lifetime_end(bool lost)
+{
+    if (lost) {
+        lifetime.losses++;
+    } else {
+        lifetime.wins++;
+    }
+    rally = 0;
+
+    // a record which is still being written is replaced by the newer one, in
+    // the same slot
+    if (written == sizeof(LifetimeRecord)) {
+        slot = slot + 1 < LIFETIME_SLOTS ? slot + 1 : 0;
+    }
+    record.sequence++;
+    if (record.sequence == LIFETIME_ERASED) {
+        record.sequence = 0;
+    }
+    record.lifetime = lifetime;
+    record.crc = lifetime_crc(&record);
+    written = 0;
+}
+
+void lifetime_task(__unused__ void* data)
+{
+    if (written < sizeof(LifetimeRecord) && eeprom_is_ready()) {
+        eeprom_update_byte(lifetime_slot(slot) + written,
+                           ((const uint8_t*) &record)[written]);
+        written++;
+    }
+}
+
+void lifetime_flush(void)
+{
+    while (written < sizeof(LifetimeRecord)) {
+        lifetime_task(NULL);
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file lifetime.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the lifetime statistics' function declarations and macro
+ * definitions which are to be shared with other files. The statistics are kept
+ * in the EEPROM, in an append-only log which spreads its writes over the whole
+ * EEPROM, so that they survive a reset.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef LIFETIME_H
+#define LIFETIME_H
+
+#include "system.h"
+
+/**
+ * @brief Definition for the Lifetime type, which holds the statistics for
+ * every game that this board has played.
+ *
+ */
+typedef struct lifetime_s
+{
+    uint16_t wins;
+    uint16_t losses;
+    // the most times that this board's puck has hit the ball in one game
+    uint8_t longest_rally;
+    // the fastest that the ball has left this board's puck, as its velocity
+    // multiplied by its stride
+    uint8_t top_velocity;
+} Lifetime;
+
+/**
+ * @brief Definition for the LifetimeRecord type, which is a single entry in
+ * the log. It is packed, so that it has the same layout on the host as on the
+ * board.
+ *
+ */
+typedef struct __attribute__((packed)) lifetime_record_s
+{
+    Lifetime lifetime;
+    // covers every other byte of the record, so that a record which was only
+    // partly written when the power was lost is never used
+    uint8_t crc;
+    // increases by one for each record, so that the newest can be found. It is
+    // written last, so until a record has been written in full, its slot keeps
+    // the sequence of the oldest record, or of an erased slot.
+    uint8_t sequence;
+} LifetimeRecord;
+
+/**
+ * @brief The number of records in the log. Each record is written to the slot
+ * after the last, so each slot is written once in this many games. The
+ * sequences of the records are compared by their difference, which must fit
+ * in an int8_t, so this is one fewer than the 128 records which fit in the
+ * EEPROM.
+ *
+ */
+#define LIFETIME_SLOTS 127
+
+/**
+ * @brief The sequence of an erased slot, which is never used by a record.
+ *
+ */
+#define LIFETIME_ERASED 0xFF
+
+/**
+ * @brief The statistics, including every game which has finished.
+ *
+ */
+extern Lifetime lifetime;
+
+/**
+ * @brief Loads the newest complete record from the log.
+ *
+ */
+void lifetime_init(void);
+
+/**
+ * @brief Records that this board's puck hit the ball. Only the statistics in
+ * RAM are changed.
+ *
+ * @param velocity The ball's velocity after the hit, multiplied by its stride
+ */
+void lifetime_hit(uint8_t velocity);
+
+/**
+ * @brief Records the end of a game, and starts a new record. The record is
+ * written by lifetime_task.
+ *
+ * @param lost Whether this board lost the game
+ */
+void lifetime_end(bool lost);
+
+/**
+ * @brief Writes the next byte of the record, if the EEPROM is ready for it, so
+ * that nothing waits on the EEPROM. Runs alongside the result text.
+ *
+ */
+void lifetime_task(__unused__ void* data);
+
+/**
+ * @brief Waits for the rest of the record to be written, if lifetime_task has
+ * not already written it.
+ *
+ */
+void lifetime_flush(void);
+
+#endif
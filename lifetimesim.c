@@ -0,0 +1,148 @@
+/**
+ * @file lifetimesim.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Tests the lifetime statistics' log on the host, with the EEPROM
+ * emulator. It plays games until a byte of the EEPROM has been written as many
+ * times as it can be, and loses the power at every write of a record, to check
+ * that the newest complete record is always recovered.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "avr/eeprom.h"
+#include "lifetime.h"
+
+/**
+ * @brief Plays a game, and writes its record.
+ *
+ * @param game The number of the game, which decides how it goes
+ */
+static void lifetimesim_game(uint32_t game)
+{
+    for (uint8_t hit = 0; hit < game % 23; hit++) {
+        lifetime_hit(game % 9);
+    }
+    lifetime_end(game % 3 == 0);
+    lifetime_flush();
+}
+
+/**
+ * @brief Checks whether the statistics in RAM are the same as some expected
+ * statistics.
+ *
+ * @param expected The expected statistics
+ * @return true The statistics are the same
+ */
+static bool lifetimesim_equal(const Lifetime* expected)
+{
+    return memcmp(&lifetime, expected, sizeof(Lifetime)) == 0;
+}
+
+/**
+ * @brief Plays games until a byte of the EEPROM has reached its endurance, and
+ * checks that the statistics can still be loaded.
+ *
+ * @return uint32_t The number of games which were played
+ */
+static uint32_t lifetimesim_endurance(void)
+{
+    uint32_t game = 0;
+
+    eeprom_emu_erase();
+    lifetime_init();
+    while (eeprom_emu_most_writes() < EEPROM_ENDURANCE) {
+        // a byte is written at most once each time that its slot is written
+        for (uint8_t i = 0; i < LIFETIME_SLOTS; i++) {
+            lifetimesim_game(game++);
+        }
+    }
+
+    Lifetime expected = lifetime;
+    lifetime_init();
+    if (!lifetimesim_equal(&expected)) {
+        fprintf(stderr, "lifetimesim: statistics lost after %u games\n",
+                game);
+        exit(EXIT_FAILURE);
+    }
+    return game;
+}
+
+/**
+ * @brief Loses the power at each write of a record, after each number of games
+ * up to twice around the log, and checks that either the old or the new
+ * statistics are loaded, and that the log carries on from them.
+ *
+ * @return uint32_t The number of power losses which were not recovered from
+ */
+static uint32_t lifetimesim_power_loss(uint32_t* cuts)
+{
+    uint32_t failed = 0;
+
+    *cuts = 0;
+    for (uint32_t games = 0; games < 2 * LIFETIME_SLOTS; games++) {
+        for (uint8_t cut = 0; cut <= sizeof(LifetimeRecord); cut++) {
+            eeprom_emu_erase();
+            lifetime_init();
+            for (uint32_t game = 0; game < games; game++) {
+                lifetimesim_game(game);
+            }
+
+            Lifetime old = lifetime;
+            eeprom_emu_power_cut(cut);
+            lifetimesim_game(games);
+            Lifetime new = lifetime;
+
+            eeprom_emu_power_on();
+            lifetime_init();
+            (*cuts)++;
+            if (!lifetimesim_equal(&old) && !lifetimesim_equal(&new)) {
+                failed++;
+                continue;
+            }
+
+            Lifetime recovered = lifetime;
+            lifetimesim_game(games + 1);
+            Lifetime next = lifetime;
+            lifetime_init();
+            if (!lifetimesim_equal(&next) ||
+                lifetimesim_equal(&recovered)) {
+                failed++;
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief Runs the tests, and prints what they found.
+ *
+ * @return int EXIT_FAILURE if a power loss was not recovered from, or the log
+ * wears out early
+ */
+int main(void)
+{
+    uint32_t cuts;
+    uint32_t failed = lifetimesim_power_loss(&cuts);
+    uint32_t games = lifetimesim_endurance();
+
+    printf("slots: %u of %u bytes\n", (unsigned) LIFETIME_SLOTS,
+           (unsigned) sizeof(LifetimeRecord));
+    printf("games before a byte is written %lu times: %u (%.1f times a "
+           "single record)\n",
+           EEPROM_ENDURANCE, games, (double) games / EEPROM_ENDURANCE);
+    printf("power losses: %u, not recovered: %u\n", cuts, failed);
+
+    if (games < (LIFETIME_SLOTS - 1) * EEPROM_ENDURANCE) {
+        fprintf(stderr, "lifetimesim: the log wore out early\n");
+        return EXIT_FAILURE;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,440 @@
+/**
+ * @file link.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the IR link.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note Tokens and probes are read byte by byte, as the spectator reads the
+ * ring, so that a byte which is broken at a new rate is skipped rather than
+ * waited on. A board hears its own transmissions, so each one carries the
+ * number of boards which have forwarded it: a board only takes what comes from
+ * the board before it, and the board which started the discovery only takes
+ * what has come all the way around the ring.
+ * @note The rate which the ring was discovered at, or which the last game was
+ * played at, may be the one that no longer works, so every board switches to
+ * the slowest rate before the agreement starts, and goes back to it after each
+ * rate which is tried.
+ */
+
+#include "link.h"
+
+#include "ir_uart.h"
+#include "ring.h"
+#include "stats.h"
+#include "timer.h"
+#include "usart1.h"
+
+/**
+ * @brief The states of the agreement on the rate.
+ *
+ */
+#define LINK_START 0
+#define LINK_FOLLOW 1
+#define LINK_SETTLE 2
+#define LINK_ASKED 3
+#define LINK_SWITCHING 4
+#define LINK_TRYING 5
+#define LINK_FAILED 6
+#define LINK_COMMITTED 7
+#define LINK_AGREED 8
+
+/**
+ * @brief The number of times that a commit token is sent, as a board which
+ * misses every copy is left at a rate which no other board uses.
+ *
+ */
+#define LINK_COMMIT_COPIES 3
+
+/**
+ * @brief The baud rate of each of the rates, slowest first.
+ *
+ */
+static const uint16_t bauds[LINK_RATES_NUM] = {1200, 2400, 4800};
+
+/**
+ * @brief The probe's pattern, which has runs of each length of 0s and 1s.
+ *
+ */
+static const uint8_t pattern[LINK_PROBE_BYTES] = {
+    0x55, 0x2A, 0x7F, 0x00, 0x0F, 0x70, 0x33, 0x4C,
+    0x01, 0x7E, 0x19, 0x66, 0x3C, 0x43, 0x2D, 0x52};
+
+uint16_t link_baud(uint8_t rate)
+{
+    return bauds[rate];
+}
+
+void link_rate_set(uint8_t rate)
+{
+    link.rate = rate;
+    usart1_baud_divisor_set(USART1_BAUD_DIVISOR(bauds[rate]));
+}
+
+/**
+ * @brief Transmits a switch or commit token. A commit token is sent
+ * LINK_COMMIT_COPIES times.
+ *
+ * @param token The token, with its rate
+ * @param count The number of boards which have forwarded it
+ */
+static void link_token_transmit(uint8_t token, uint8_t count)
+{
+    uint8_t copies =
+        (token & RING_TOKEN_MASK) == LINK_COMMIT ? LINK_COMMIT_COPIES : 1;
+
+    for (uint8_t i = 0; i < copies; i++) {
+        ir_uart_putc(token);
+        ir_uart_putc(count);
+    }
+    stats_ir(2 * copies);
+}
+
+/**
+ * @brief Changes the agreement's state.
+ *
+ * @param state The state
+ */
+static void link_state_set(uint8_t state)
+{
+    link.state = state;
+    link.since = timer_get();
+}
+
+/**
+ * @brief Checks whether the agreement has been in its state for a time.
+ *
+ * @param ticks The time
+ * @return true The agreement has been in its state for at least the time
+ */
+static bool link_elapsed(timer_tick_t ticks)
+{
+    return (timer_tick_t) (timer_get() - link.since) >= ticks;
+}
+
+/**
+ * @brief Gets this board's report on the rate which is being tried.
+ *
+ * @return uint8_t LINK_REPORT_DEGRADED if this board does not accept the rate,
+ * otherwise 0
+ */
+static uint8_t link_report(void)
+{
+    return link.trying > link.ceiling ? LINK_REPORT_DEGRADED : 0;
+}
+
+/**
+ * @brief Asks every board to switch to the rate which is being tried.
+ *
+ */
+static void link_ask(void)
+{
+    link_token_transmit(LINK_SWITCH | link.trying, 0);
+    link_state_set(LINK_ASKED);
+}
+
+/**
+ * @brief Tells every board to keep the rate which is being tried.
+ *
+ */
+static void link_commit(void)
+{
+    link_token_transmit(LINK_COMMIT | link.trying, 0);
+    link_state_set(LINK_COMMITTED);
+}
+
+/**
+ * @brief Sends the probe around the ring, at the rate which is being tried.
+ *
+ */
+static void link_probe(void)
+{
+    ir_uart_putc(LINK_PROBE | link.trying);
+    ir_uart_putc(0);
+    for (uint8_t i = 0; i < LINK_PROBE_BYTES; i++) {
+        ir_uart_putc(pattern[i]);
+    }
+    ir_uart_putc(link_report());
+    stats_ir(LINK_PROBE_LENGTH);
+}
+
+/**
+ * @brief Counts the pattern bytes of a probe which were broken on the way, and
+ * adds them to this board's counts.
+ *
+ * @param probe The probe
+ * @return uint8_t The number of broken bytes
+ */
+static uint8_t link_probe_check(const uint8_t* probe)
+{
+    uint8_t broken = 0;
+
+    for (uint8_t i = 0; i < LINK_PROBE_BYTES; i++) {
+        broken += probe[2 + i] != pattern[i];
+    }
+    link.probe_bad += broken;
+    link.probe_good += LINK_PROBE_BYTES - broken;
+    return broken;
+}
+
+/**
+ * @brief Handles a token or probe, for the board which started the discovery.
+ *
+ * @param frame The token or probe
+ * @param from_ring Whether it has come all the way around the ring
+ */
+static void link_origin_frame(const uint8_t* frame, bool from_ring)
+{
+    if (!from_ring) {
+        return;
+    }
+    if (link.state == LINK_TRYING &&
+        frame[0] == (LINK_PROBE | link.trying)) {
+        // a single broken byte, or a board which does not accept the rate,
+        // fails the rate. The time of the switch is kept, as the other boards
+        // go back from when they switched.
+        if (link_probe_check(frame) == 0 &&
+            !(frame[LINK_PROBE_LENGTH - 1] & LINK_REPORT_DEGRADED)) {
+            link_commit();
+        } else {
+            link.state = LINK_FAILED;
+        }
+    } else if (link.state == LINK_COMMITTED &&
+               frame[0] == (LINK_COMMIT | link.trying)) {
+        link.agreed = link.trying;
+        link_state_set(LINK_AGREED);
+    }
+}
+
+/**
+ * @brief Handles a token or probe, for every other board. Each is forwarded
+ * once, with its count increased, and a probe with this board's report added.
+ *
+ * @param frame The token or probe
+ * @param from_previous Whether it has come from the board before this one
+ */
+static void link_follower_frame(uint8_t* frame, bool from_previous)
+{
+    uint8_t token = frame[0] & RING_TOKEN_MASK;
+    uint8_t rate = frame[0] & LINK_RATE_MASK;
+
+    if (!from_previous) {
+        return;
+    }
+    if (link.state == LINK_FOLLOW && token == LINK_SWITCH &&
+        rate < LINK_RATES_NUM) {
+        link_token_transmit(frame[0], frame[1] + 1);
+        link.trying = rate;
+        link_state_set(LINK_SWITCHING);
+    } else if (link.state == LINK_TRYING &&
+               frame[0] == (LINK_PROBE | link.trying)) {
+        link_probe_check(frame);
+        frame[1]++;
+        frame[LINK_PROBE_LENGTH - 1] |= link_report();
+        for (uint8_t i = 0; i < LINK_PROBE_LENGTH; i++) {
+            ir_uart_putc(frame[i]);
+        }
+        stats_ir(LINK_PROBE_LENGTH);
+    } else if (token == LINK_COMMIT &&
+               ((link.state == LINK_FOLLOW && rate == link.rate) ||
+                (link.state == LINK_TRYING && rate == link.trying))) {
+        link_token_transmit(frame[0], frame[1] + 1);
+        link.agreed = rate;
+        link_state_set(LINK_AGREED);
+    }
+}
+
+/**
+ * @brief Adds a byte to the token or probe which is being read, and handles it
+ * once it is complete. A byte with bit 7 set always starts a new one.
+ *
+ * @param data The byte
+ */
+static void link_read(uint8_t data)
+{
+    uint8_t length;
+
+    if (data & RING_PACKET) {
+        link.frame[0] = data;
+        link.received = 1;
+        return;
+    }
+    if (link.received == 0) {
+        return;
+    }
+
+    link.frame[link.received++] = data;
+    length =
+        (link.frame[0] & RING_TOKEN_MASK) == LINK_PROBE ? LINK_PROBE_LENGTH : 2;
+    if (link.received < length) {
+        return;
+    }
+    link.received = 0;
+
+    if (ring.origin) {
+        link_origin_frame(link.frame, link.frame[1] == ring.size - 1);
+    } else {
+        link_follower_frame(link.frame, link.frame[1] == ring.address - 1);
+    }
+}
+
+void link_init(void)
+{
+    link = (Link){.agreed = LINK_BASE_RATE, .ceiling = LINK_RATES_NUM - 1};
+    link_rate_set(LINK_BASE_RATE);
+}
+
+/**
+ * @brief Checks whether too many of the bytes which were received since the
+ * rate was last agreed were broken.
+ *
+ * @return true More than LINK_ERRORS_PER_MILLE of at least LINK_BYTES_MIN
+ * bytes were broken
+ */
+static bool link_broken_p(void)
+{
+    return link.bytes >= LINK_BYTES_MIN &&
+           (uint32_t) link.errors * 1000 >
+               (uint32_t) link.bytes * LINK_ERRORS_PER_MILLE;
+}
+
+void link_restart(void)
+{
+    if (link_broken_p()) {
+        link.ceiling = link.rate > 0 ? link.rate - 1 : 0;
+    } else {
+        link.ceiling = LINK_RATES_NUM - 1;
+    }
+    link.bytes = 0;
+    link.errors = 0;
+    link.state = LINK_START;
+}
+
+bool link_degraded_p(void)
+{
+    if (link_broken_p()) {
+        link.ceiling = link.rate > 0 ? link.rate - 1 : 0;
+    }
+    return link.ceiling < link.rate;
+}
+
+void link_task(__unused__ void* data)
+{
+    link_degraded_p();
+}
+
+bool link_negotiate(void)
+{
+    if (ring.solo) {
+        return true;
+    }
+    if (link.state == LINK_START) {
+        // the last byte at the old rate is sent before switching
+        if (!ir_uart_write_finished_p()) {
+            return false;
+        }
+        link_rate_set(LINK_SLOWEST_RATE);
+        link.received = 0;
+        link_state_set(ring.origin ? LINK_SETTLE : LINK_FOLLOW);
+    }
+
+    while (link.state != LINK_AGREED && link.state != LINK_SWITCHING &&
+           ir_uart_read_ready_p()) {
+        // a broken byte can look like any other, so the token or probe which
+        // it is in is dropped
+        if (UCSR1A & (BIT(FE1) | BIT(DOR1))) {
+            ir_uart_getc();
+            if (link.received > 0 &&
+                (link.frame[0] & RING_TOKEN_MASK) == LINK_PROBE) {
+                link.probe_bad++;
+            }
+            link.received = 0;
+        } else {
+            link_read(ir_uart_getc());
+        }
+    }
+
+    switch (link.state) {
+    case LINK_SETTLE:
+        if (link_elapsed(LINK_SETTLE_TICKS)) {
+            link.trying = LINK_RATES_NUM - 1;
+            link_ask();
+        }
+        break;
+    case LINK_ASKED:
+        // the switch token has gone around the ring by now
+        if (link_elapsed(LINK_SETTLE_TICKS)) {
+            link_state_set(LINK_SWITCHING);
+        }
+        break;
+    case LINK_SWITCHING:
+        // the token is forwarded at the old rate, before switching
+        if (ir_uart_write_finished_p()) {
+            link_rate_set(link.trying);
+            link.received = 0;
+            link_state_set(LINK_TRYING);
+            if (ring.origin) {
+                link_probe();
+            }
+        }
+        break;
+    case LINK_TRYING:
+        if (link_elapsed(LINK_TIMEOUT_TICKS(link.trying))) {
+            if (ring.origin) {
+                link.state = LINK_FAILED;
+            } else {
+                link_rate_set(LINK_SLOWEST_RATE);
+                link_state_set(LINK_FOLLOW);
+            }
+        }
+        break;
+    case LINK_FAILED:
+        // every other board has gone back by the time this board does, as
+        // each of them switched before it
+        if (link_elapsed(LINK_TIMEOUT_TICKS(link.trying))) {
+            link_rate_set(LINK_SLOWEST_RATE);
+            if (link.trying == LINK_SLOWEST_RATE) {
+                // no rate works, so the slowest rate is kept, as it is the
+                // most likely to work
+                link_commit();
+            } else {
+                link.trying--;
+                link_ask();
+            }
+        }
+        break;
+    case LINK_COMMITTED:
+        // a commit which does not come back has left a board behind, so the
+        // rate fails, unless it is the slowest
+        if (link_elapsed(LINK_TIMEOUT_TICKS(link.trying))) {
+            if (link.trying == LINK_SLOWEST_RATE) {
+                link.agreed = link.trying;
+                link_state_set(LINK_AGREED);
+            } else {
+                link_state_set(LINK_FAILED);
+            }
+        }
+        break;
+    }
+    return link.state == LINK_AGREED;
+}
+
+bool link_byte(void)
+{
+    // the counts are halved when they are full, which keeps their ratio
+    if (link.bytes == UINT16_MAX) {
+        link.bytes >>= 1;
+        link.errors >>= 1;
+    }
+    link.bytes++;
+    if (UCSR1A & (BIT(FE1) | BIT(DOR1))) {
+        link.errors++;
+        return true;
+    }
+    return false;
+}
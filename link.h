@@ -0,0 +1,238 @@
+/**
+ * @file link.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the IR link's function declarations and macro definitions
+ * which are to be shared with other files. Once the ring has been discovered,
+ * the boards agree on the fastest IR rate which every link in the ring can
+ * carry: the board which started the discovery asks every board to switch to
+ * a rate, sends a pattern around the ring at that rate, and keeps the rate if
+ * the pattern comes back whole. Otherwise, every board goes back to the
+ * slowest rate, which every link is expected to carry, and the next slower
+ * rate is tried from there. The link's quality is counted and checked during
+ * play, and the rate is only agreed again at a rematch if a board's link broke
+ * too many bytes.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note For information pertaining to the structure of the transmitted and
+ * received data, see README.md
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include "system.h"
+#include "timer.h"
+
+/**
+ * @brief The number of IR rates which can be used, the index of
+ * IR_UART_BAUD_RATE, which the ring is discovered at, and the index of the
+ * slowest rate, which the rate is agreed at. The rates are 1200, 2400 and 4800
+ * baud, slowest first.
+ *
+ */
+#define LINK_RATES_NUM 3
+#define LINK_BASE_RATE 1
+#define LINK_SLOWEST_RATE 0
+
+/**
+ * @brief Marks a switch token, which asks every board to switch to the rate
+ * held in bits 0-2. It is followed by the number of boards which have
+ * forwarded it.
+ *
+ */
+#define LINK_SWITCH 0xD0
+
+/**
+ * @brief Marks a probe, which is sent around the ring at the rate held in bits
+ * 0-2. It is followed by the number of boards which have forwarded it, the
+ * LINK_PROBE_BYTES bytes of the pattern, and the report.
+ *
+ */
+#define LINK_PROBE 0xD8
+
+/**
+ * @brief Marks a commit token, which tells every board to keep the rate held
+ * in bits 0-2. It is followed by the number of boards which have forwarded
+ * it.
+ *
+ */
+#define LINK_COMMIT 0xE0
+
+/**
+ * @brief Masks the rate which is held in a switch, probe or commit token.
+ *
+ */
+#define LINK_RATE_MASK 0x07
+
+/**
+ * @brief The number of bytes in the probe's pattern. Each is below 0x80, so
+ * that the ring and the spectator skip them.
+ *
+ */
+#define LINK_PROBE_BYTES 16
+
+/**
+ * @brief The number of bytes in a probe, with its token, its forward count and
+ * its report.
+ *
+ */
+#define LINK_PROBE_LENGTH (2 + LINK_PROBE_BYTES + 1)
+
+/**
+ * @brief Set in a probe's report by a board which does not accept the probe's
+ * rate, as the link was too poor at that rate in the last game.
+ *
+ */
+#define LINK_REPORT_DEGRADED 0x40
+
+/**
+ * @brief The number of bytes' worth of time, at the rate which is being tried,
+ * for which the boards try it before going back to the slowest rate. This
+ * covers a probe and a commit going around a ring of RING_BOARDS_MAX boards,
+ * which is 168 bytes, and the time for each board's task to forward them. It
+ * is 2 s at 1200 baud, which fits within a timer_tick_t, and 500 ms at 4800
+ * baud, so a rate which fails costs less the faster it is.
+ *
+ */
+#define LINK_TIMEOUT_BYTES 240
+
+/**
+ * @brief The number of ticks for which the boards try a rate before going
+ * back to the slowest rate.
+ *
+ */
+#define LINK_TIMEOUT_TICKS(rate)                                               \
+    ((timer_tick_t) (LINK_TIMEOUT_BYTES * 10UL * TIMER_RATE / link_baud(rate)))
+
+/**
+ * @brief The number of ticks which the board that started the discovery waits
+ * before it starts to agree on the rate (250 ms), so that the other boards
+ * have finished the discovery or the rematch, and after it asks for a rate,
+ * so that the switch token has gone around the ring.
+ *
+ */
+#define LINK_SETTLE_TICKS (TIMER_RATE / 4)
+
+/**
+ * @brief The most bytes in every thousand which can be received with a
+ * framing error or an overrun during a game before its rate is no longer
+ * accepted, once at least LINK_BYTES_MIN bytes have been received.
+ *
+ */
+#define LINK_ERRORS_PER_MILLE 20
+#define LINK_BYTES_MIN 100
+
+/**
+ * @brief Definition for the Link type, which holds the IR link's rate, its
+ * quality, and the agreement on its rate.
+ *
+ */
+typedef struct link_s
+{
+    // the rate in use, and the rate which the boards last agreed on
+    uint8_t rate;
+    uint8_t agreed;
+    // the fastest rate which this board accepts
+    uint8_t ceiling;
+    // the agreement's state, the rate which is being tried, and when the
+    // state started
+    uint8_t state;
+    uint8_t trying;
+    timer_tick_t since;
+    // the token or probe which is being received, and the number of its bytes
+    // which have been received
+    uint8_t frame[LINK_PROBE_LENGTH];
+    uint8_t received;
+    // the bytes which have been received since the rate was last agreed, and
+    // those which had a framing error or an overrun
+    uint16_t bytes;
+    uint16_t errors;
+    // the pattern bytes which this board has received whole and broken, over
+    // every probe
+    uint16_t probe_good;
+    uint16_t probe_bad;
+} Link;
+
+/**
+ * @brief This board's IR link.
+ *
+ */
+Link link;
+
+/**
+ * @brief Gets the number of bits each second which a rate carries.
+ *
+ * @param rate The rate's index
+ * @return uint16_t The baud rate
+ */
+uint16_t link_baud(uint8_t rate);
+
+/**
+ * @brief Switches the IR UART to a rate. Any byte which is still being sent is
+ * broken.
+ *
+ * @param rate The rate's index
+ */
+void link_rate_set(uint8_t rate);
+
+/**
+ * @brief Goes back to IR_UART_BAUD_RATE, accepts every rate, and prepares to
+ * agree on the rate once the ring has been discovered.
+ *
+ */
+void link_init(void);
+
+/**
+ * @brief Prepares to agree on the rate again. If too many of the bytes which
+ * were received since the rate was last agreed were broken, this board no
+ * longer accepts that rate, or any faster one. Otherwise, it accepts every
+ * rate again.
+ *
+ */
+void link_restart(void);
+
+/**
+ * @brief Checks whether this board's link has broken too many of the bytes
+ * which were received since the rate was last agreed, in which case this board
+ * no longer accepts that rate, or any faster one.
+ *
+ * @return true The rate should be agreed again
+ */
+bool link_degraded_p(void);
+
+/**
+ * @brief Checks the link's quality during a game, so that a link which breaks
+ * too many bytes is caught while play continues, and the rate is agreed again
+ * at the rematch. Runs at LINK_TASK_RATE.
+ *
+ */
+void link_task(__unused__ void* data);
+
+/**
+ * @brief Takes part in the agreement on the rate, once the ring has been
+ * discovered. Every board first switches to the slowest rate, once its last
+ * byte has been sent. The board which started the discovery then tries each
+ * rate, fastest first, and the other boards follow it. Should be called
+ * periodically until it returns true, and nothing else should read from IR
+ * until then.
+ *
+ * @return true Every board has agreed on the rate
+ * @return false The agreement is still running
+ */
+bool link_negotiate(void);
+
+/**
+ * @brief Counts a byte which is about to be read from IR, and whether it was
+ * received with a framing error or an overrun. Should be called before each
+ * byte is read.
+ *
+ * @return true The byte was broken
+ * @return false The byte was received whole
+ */
+bool link_byte(void);
+
+#endif
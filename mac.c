@@ -0,0 +1,77 @@
+/**
+ * @file mac.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the IR medium access.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note A byte which has only just started to arrive cannot be told apart from
+ * a quiet IR, so two boards can still start within a byte of each other. Their
+ * bytes are broken, and are dropped by the boards which receive them; the
+ * backoff which each board then picks keeps them from colliding again.
+ */
+
+#include "mac.h"
+
+#include "ir_uart.h"
+#include "link.h"
+
+Mac mac;
+
+uint16_t mac_random(void)
+{
+    mac.random ^= timer_get();
+    if (mac.random == 0) {
+        mac.random = 1;
+    }
+    mac.random ^= mac.random << 7;
+    mac.random ^= mac.random >> 9;
+    mac.random ^= mac.random << 8;
+    return mac.random;
+}
+
+void mac_init(void)
+{
+    mac = (Mac){.heard = timer_get(), .random = 1};
+}
+
+void mac_heard(void)
+{
+    mac.heard = timer_get();
+    mac.quiet = false;
+}
+
+void mac_update(void)
+{
+    timer_tick_t quiet =
+        (timer_tick_t) (10UL * TIMER_RATE / link_baud(link.rate)) *
+            MAC_QUIET_BYTES +
+        (timer_tick_t) mac.backoff * MAC_SLOT_TICKS;
+
+    if ((timer_tick_t) (timer_get() - mac.heard) >= quiet) {
+        mac.quiet = true;
+    }
+}
+
+bool mac_clear_p(void)
+{
+    mac_update();
+    return mac.quiet && !ir_uart_read_ready_p() && ir_uart_write_finished_p();
+}
+
+void mac_backoff(uint8_t attempt)
+{
+    mac.backoff = 1 + (mac_random() & ((MAC_BACKOFF_SLOTS << attempt) - 1));
+    mac_heard();
+}
+
+void mac_sent(void)
+{
+    mac.backoff = 0;
+    mac_heard();
+}
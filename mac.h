@@ -0,0 +1,149 @@
+/**
+ * @file mac.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the IR medium access's function declarations and macro
+ * definitions which are to be shared with other files. The IR is half-duplex:
+ * each board hears its own transmissions, so a board which sends while it is
+ * receiving breaks the bytes that it receives. A board only starts a message
+ * once the IR has been quiet for MAC_QUIET_BYTES bytes' worth of time, and,
+ * once it has found the IR busy, waits a random number of slots more, so that
+ * two boards which were waiting for the same message to end do not both start
+ * straight after it.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note During a game, the ball is the turn: only the board which has the ball
+ * starts messages, and the other boards only forward them, straight away.
+ */
+
+#ifndef MAC_H
+#define MAC_H
+
+#include "system.h"
+#include "timer.h"
+
+/**
+ * @brief The number of bytes' worth of time for which the IR has to be quiet
+ * before a board starts a message: a byte which is still being received, and
+ * the gap before the byte after it.
+ *
+ */
+#define MAC_QUIET_BYTES 2
+
+/**
+ * @brief The number of ticks in a backoff slot (10 ms). A board only checks
+ * the IR as often as its tasks run, at 100 Hz, so two backoffs which differ by
+ * less than this would end at the same check.
+ *
+ */
+#define MAC_SLOT_TICKS (TIMER_RATE / 100)
+
+/**
+ * @brief The number of different backoffs, in slots, which a board picks from
+ * once it has found the IR busy. This doubles each time that a broadcast is
+ * sent again. Must be a power of two.
+ *
+ */
+#define MAC_BACKOFF_SLOTS 4
+
+/**
+ * @brief The number of ticks which a board waits for its broadcast to come back
+ * around the ring before it sends it again (500 ms). This covers a message
+ * going around a ring of RING_BOARDS_MAX boards at 1200 baud.
+ *
+ */
+#define MAC_RETRY_TICKS (TIMER_RATE / 2)
+
+/**
+ * @brief The most times that a broadcast is sent again before this board gives
+ * up on it.
+ *
+ */
+#define MAC_RETRIES_MAX 4
+
+/**
+ * @brief Definition for the Mac type, which holds what this board has heard of
+ * the IR, and how long it waits before it sends.
+ *
+ */
+typedef struct mac_s
+{
+    // the time at which a byte was last heard or sent, and whether the IR has
+    // been quiet for long enough since, which is remembered as the time wraps
+    timer_tick_t heard;
+    bool quiet;
+    // the slots which this board waits on top of MAC_QUIET_BYTES, from when
+    // the backoff was picked or a byte was last heard
+    uint8_t backoff;
+    // the state of the pseudo-random numbers which pick the backoff
+    uint16_t random;
+} Mac;
+
+/**
+ * @brief This board's IR medium access.
+ *
+ */
+Mac mac;
+
+/**
+ * @brief Forgets what has been heard of the IR.
+ *
+ */
+void mac_init(void);
+
+/**
+ * @brief Records that a byte has just been received or sent over IR.
+ *
+ */
+void mac_heard(void);
+
+/**
+ * @brief Checks how long the IR has been quiet for. This must be called more
+ * often than the timer wraps, so that a long quiet is not taken for a short
+ * one.
+ *
+ */
+void mac_update(void);
+
+/**
+ * @brief Checks whether this board can start a message: no byte is waiting to
+ * be read or still being sent, and the IR has been quiet for MAC_QUIET_BYTES
+ * bytes' worth of time and this board's backoff.
+ *
+ * @return true The IR is clear
+ * @return false The IR is busy
+ */
+bool mac_clear_p(void);
+
+/**
+ * @brief Picks a new random backoff, for a message which has found the IR busy,
+ * or which is about to be sent again, so that it does not start at the same
+ * time as another board's message. The backoff starts now, as a board which
+ * sends again when the IR has long been quiet would otherwise send straight
+ * away, at the same time as the board which its message collided with.
+ *
+ * @param attempt The number of times that the message has been sent again,
+ * up to MAC_RETRIES_MAX
+ */
+void mac_backoff(uint8_t attempt);
+
+/**
+ * @brief Gets the next pseudo-random number, with a 16-bit xorshift. The time
+ * is mixed in first, as boards which were turned on together start with the
+ * same state.
+ *
+ * @return uint16_t The number
+ */
+uint16_t mac_random(void);
+
+/**
+ * @brief Records that this board has started a message, and clears its
+ * backoff.
+ *
+ */
+void mac_sent(void);
+
+#endif
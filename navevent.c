@@ -0,0 +1,142 @@
+/**
+ * @file navevent.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the navswitch event queue.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note The queue has a single producer (the interrupt) and a single consumer,
+ * and each index is only written by one of them. The indices are single bytes,
+ * so they are read and written atomically, and no locking is needed.
+ */
+
+#include "navevent.h"
+
+#include <avr/interrupt.h>
+
+#include "customtaskschedule.h"
+#include "navswitch.h"
+#include "pio.h"
+#include "stats.h"
+
+/**
+ * @brief The buttons of the navswitch which are queued.
+ *
+ */
+static const uint8_t buttons[] = {NAVSWITCH_NORTH, NAVSWITCH_SOUTH,
+                                  NAVSWITCH_PUSH};
+
+/**
+ * @brief The lines which each of the buttons are read from. The lines are
+ * active low.
+ *
+ */
+static const pio_t button_pios[] = {NAVSWITCH_PIO_NORTH, NAVSWITCH_PIO_SOUTH,
+                                    NAVSWITCH_PIO_PUSH};
+
+/**
+ * @brief Whether each button was down when the interrupt last ran.
+ *
+ */
+static volatile bool was_down[ARRAY_SIZE(buttons)];
+
+/**
+ * @brief The time at which each button's line last changed.
+ *
+ */
+static timer_tick_t last_change[ARRAY_SIZE(buttons)];
+
+/**
+ * @brief The queue of presses. It is volatile, like the indices, so that the
+ * interrupt's writes to a press are never moved after its write to head, and
+ * navevent_pop() never reads a press before it has read head.
+ *
+ */
+static volatile NavEvent queue[NAVEVENT_QUEUE_SIZE];
+
+/**
+ * @brief The index at which the next press is added. Only written by the
+ * interrupt.
+ *
+ */
+static volatile uint8_t head;
+
+/**
+ * @brief The index of the oldest press. Only written by navevent_pop() and
+ * navevent_flush().
+ *
+ */
+static volatile uint8_t tail;
+
+void navevent_init(void)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(buttons); i++) {
+        was_down[i] = !pio_input_get(button_pios[i]);
+    }
+    PCMSK1 |= NAVEVENT_PCINT_MASK;
+    PCIFR = BIT(PCIF1);
+    PCICR |= BIT(PCIE1);
+    sei();
+}
+
+bool navevent_pop(NavEvent* event)
+{
+    if (tail == head) {
+        return false;
+    }
+    *event = queue[tail];
+    tail = (tail + 1) & (NAVEVENT_QUEUE_SIZE - 1);
+    return true;
+}
+
+bool navevent_down_p(uint8_t button)
+{
+    for (uint8_t i = 0; i < ARRAY_SIZE(buttons); i++) {
+        if (buttons[i] == button) {
+            return was_down[i];
+        }
+    }
+    return false;
+}
+
+void navevent_flush(void)
+{
+    tail = head;
+}
+
+/**
+ * @brief Runs when any of the navswitch's lines change. A press is queued when
+ * a line goes low after being stable for NAVEVENT_DEBOUNCE_TICKS, so that
+ * bouncing on either the press or the release is ignored.
+ *
+ */
+ISR(PCINT1_vect)
+{
+    // the timer is only read once, at the start, to timestamp every line
+    timer_tick_t now = timer_get();
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(buttons); i++) {
+        bool down = !pio_input_get(button_pios[i]);
+        if (down == was_down[i]) {
+            continue;
+        }
+
+        if (down && now - last_change[i] >= NAVEVENT_DEBOUNCE_TICKS) {
+            uint8_t next = (head + 1) & (NAVEVENT_QUEUE_SIZE - 1);
+            if (next == tail) {
+                stats.nav_events_dropped++;
+            } else {
+                queue[head] = (NavEvent){.button = buttons[i], .time = now};
+                head = next;
+                custom_task_raise(TASK_EVENT_NAVSWITCH);
+            }
+        }
+        was_down[i] = down;
+        last_change[i] = now;
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file navevent.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the navswitch event queue's function declarations and macro
+ * definitions which are to be shared with other files. Presses of the
+ * navswitch are caught by a pin change interrupt, debounced and timestamped,
+ * so that a quick tap between two runs of puck_task is never missed.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef NAVEVENT_H
+#define NAVEVENT_H
+
+#include "system.h"
+#include "timer.h"
+
+/**
+ * @brief The number of events which the queue can hold. Must be a power of two,
+ * so that the indices wrap with a mask.
+ *
+ */
+#define NAVEVENT_QUEUE_SIZE 8
+
+/**
+ * @brief The number of ticks for which a navswitch line must be stable before
+ * a press is accepted (5 ms).
+ *
+ */
+#define NAVEVENT_DEBOUNCE_TICKS (TIMER_RATE / 200)
+
+/**
+ * @brief The pin change interrupts for the navswitch's lines on port C. The
+ * east line has no pin change interrupt, and is not needed by the game.
+ *
+ */
+#define NAVEVENT_PCINT_MASK                                                    \
+    (BIT(PCINT8) | BIT(PCINT9) | BIT(PCINT10) | BIT(PCINT11))
+
+/**
+ * @brief Definition for the NavEvent type. It records which button of the
+ * navswitch was pressed, and when.
+ *
+ */
+typedef struct nav_event_s
+{
+    uint8_t button;
+    timer_tick_t time;
+} NavEvent;
+
+/**
+ * @brief Enables the pin change interrupts for the navswitch.
+ * CAN ONLY BE USED AFTER navswitch_init().
+ *
+ */
+void navevent_init(void);
+
+/**
+ * @brief Takes the oldest press from the queue. Only a single task may take
+ * presses from the queue at a time.
+ *
+ * @param event Set to the oldest press, if there is one
+ * @return true A press was taken from the queue
+ * @return false The queue is empty
+ */
+bool navevent_pop(NavEvent* event);
+
+/**
+ * @brief Checks whether a button of the navswitch is held down, as of the last
+ * change to its line. Nothing is read from the navswitch, so it can be called
+ * as often as needed.
+ *
+ * @param button The button, which must be one of the buttons which are queued
+ * @return true The button is held down
+ */
+bool navevent_down_p(uint8_t button);
+
+/**
+ * @brief Discards every press in the queue, such as those made while the text
+ * was being shown.
+ *
+ */
+void navevent_flush(void);
+
+#endif
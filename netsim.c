@@ -0,0 +1,1119 @@
+/**
+ * @file netsim.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Simulates a ring of boards on the host, each running the real ring
+ * module over a simulated IR link to the next board. For each number of boards
+ * up to RING_BOARDS_MAX, it checks that the discovery gives each board its
+ * address, and that the ball's handoff to the next board takes the same,
+ * bounded, time however many boards there are. It then places the boards at
+ * random distances from each other, and checks that they agree on the fastest
+ * IR rate which every link can carry, and on a slower one once a board has
+ * counted too many broken bytes. Last, it times the rematch from the last user
+ * pushing their navswitch to every board playing again, with the rate kept,
+ * and with it agreed again.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The ring, link and rematch modules are included, rather than linked,
+ * so that their IR and timer calls can be redirected to the simulation. Their
+ * state is swapped in and out for each board in turn. Each board also hears
+ * its own transmissions, as the real boards do.
+ * @note Each link reaches NETSIM_RANGE_CM at IR_UART_BAUD_RATE, and twice as
+ * far at half the rate. Beyond its reach, the chance that a byte is broken
+ * grows with the distance, until nothing is received at twice the reach. A
+ * byte which is sent at a different rate to the receiver's is always broken.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ir_uart.h"
+#include "timer.h"
+#include "usart1.h"
+
+// the ring's and the link's IR and timer calls are made to the simulation
+#define ir_uart_putc(data) netsim_putc(data)
+#define ir_uart_getc() netsim_getc()
+#define ir_uart_read_ready_p() netsim_read_ready_p()
+#define ir_uart_write_finished_p() netsim_write_finished_p()
+#define usart1_baud_divisor_set(divisor) netsim_divisor_set(divisor)
+#define timer_get() netsim_timer_get()
+#define UCSR1A netsim_status()
+#ifndef FE1
+#define FE1 4
+#define DOR1 3
+#endif
+
+static void netsim_putc(uint8_t data);
+static uint8_t netsim_getc(void);
+static bool netsim_read_ready_p(void);
+static bool netsim_write_finished_p(void);
+static void netsim_divisor_set(uint16_t divisor);
+static timer_tick_t netsim_timer_get(void);
+static uint8_t netsim_status(void);
+
+#include "ring.c"
+#include "link.c"
+#include "mac.c"
+#include "rematch.c"
+
+#include "board.h"
+
+// the bytes are counted by the simulation instead
+void stats_ir(__unused__ uint8_t bytes)
+{
+}
+
+// every simulated board is a real one, so the CPU opponent is never used
+void cpu_receive(__unused__ const uint8_t* payload, __unused__ uint8_t length)
+{
+}
+
+uint8_t cpu_transmit(__unused__ uint8_t* payload)
+{
+    return 0;
+}
+
+/**
+ * @brief The number of microseconds that it takes to send a byte over IR, with
+ * its start and stop bits.
+ *
+ */
+#define NETSIM_BYTE_US (10 * 1000000UL / IR_UART_BAUD_RATE)
+
+/**
+ * @brief The number of microseconds that it takes to send a byte at a rate.
+ *
+ */
+#define NETSIM_RATE_BYTE_US(rate) (10 * 1000000UL / link_baud(rate))
+
+/**
+ * @brief The number of microseconds between each time that a board checks for
+ * IR data. This is the period of the negotiation and the ball's tasks.
+ *
+ */
+#define NETSIM_POLL_US 10000UL
+
+/**
+ * @brief The longest time which a message can take to get from one board to
+ * the next: the message's bytes, and a board's wait to next check for them.
+ *
+ */
+#define NETSIM_HOP_US(length) ((1 + (length)) * NETSIM_BYTE_US + NETSIM_POLL_US)
+
+/**
+ * @brief The number of discoveries which are simulated for each number of
+ * boards, and the time within which the users push their navswitches.
+ *
+ */
+#define NETSIM_TRIALS 20
+#define NETSIM_PUSH_US 2000000UL
+
+/**
+ * @brief The longest that anything is simulated for before it has failed.
+ *
+ */
+#define NETSIM_TIMEOUT_US 10000000UL
+
+/**
+ * @brief The number of times that two boards ask for a rematch at once, for
+ * each number of boards, and the time within which they both ask.
+ *
+ */
+#define NETSIM_CONTEND_TRIALS 100
+#define NETSIM_CONTEND_US NETSIM_POLL_US
+
+/**
+ * @brief The time for which the boards run after asking for a rematch: every
+ * retry of a broadcast, and a little more.
+ *
+ */
+#define NETSIM_CONTEND_RUN_US                                                  \
+    ((MAC_RETRIES_MAX + 2) * MAC_RETRY_TICKS * 1000000ULL / TIMER_RATE)
+
+/**
+ * @brief The longest that the boards can take to agree on the rate: a failed
+ * try of every rate, and the commit, each bounded by the slowest rate's.
+ *
+ */
+#define NETSIM_LINK_TIMEOUT_US                                                 \
+    ((2 * LINK_RATES_NUM + 1) *                                                \
+         (LINK_TIMEOUT_TICKS(LINK_SLOWEST_RATE) + 1ULL) * 1000000ULL /         \
+         TIMER_RATE +                                                          \
+     NETSIM_TIMEOUT_US / 10)
+
+/**
+ * @brief The longest that a rematch which keeps the rate can take, from the
+ * last push until every board plays again: every board's request, each sent in
+ * turn after its backoff and heard back around the ring at the slowest rate,
+ * and a poll for the game to start.
+ *
+ */
+#define NETSIM_REMATCH_US(num)                                                 \
+    ((num) * ((num) * ((1 + 1) * NETSIM_RATE_BYTE_US(LINK_SLOWEST_RATE) +      \
+                       NETSIM_POLL_US) +                                       \
+              (MAC_BACKOFF_SLOTS + 1) * NETSIM_POLL_US) +                      \
+     NETSIM_POLL_US)
+
+/**
+ * @brief The distance in centimetres which a link reaches at
+ * IR_UART_BAUD_RATE, and the furthest apart that boards are placed. Every link
+ * can carry the slowest rate.
+ *
+ */
+#define NETSIM_RANGE_CM 30
+#define NETSIM_DISTANCE_MAX_CM 45
+
+/**
+ * @brief The number of broken bytes, and the number of bytes, which a board is
+ * given to make it stop accepting its rate.
+ *
+ */
+#define NETSIM_DEGRADED_ERRORS 100
+#define NETSIM_DEGRADED_BYTES 1000
+
+/**
+ * @brief The number of bytes which can be waiting to be received by a board.
+ *
+ */
+#define NETSIM_QUEUE_SIZE 256
+
+/**
+ * @brief Definition for the Board type, which holds a simulated board.
+ *
+ */
+typedef struct board_s
+{
+    Ring ring;
+    uint8_t forwarded[sizeof(forwarded)];
+    Link link;
+    Mac mac;
+    // the distance to the next board, in centimetres
+    uint8_t distance;
+    // the board's timer at the start of the simulation, as each board was
+    // turned on at a different time
+    timer_tick_t timer_offset;
+    // the board's own time, which can be ahead of its next check while it
+    // waits to send or receive
+    uint64_t clock;
+    uint64_t next_poll;
+    uint64_t transmit_free;
+    uint64_t push_time;
+    // the bytes which are waiting to be received, when they arrive, the rate
+    // which they were sent at, the board which sent them, and whether they
+    // were broken on the way
+    uint8_t queue[NETSIM_QUEUE_SIZE];
+    uint64_t arrival[NETSIM_QUEUE_SIZE];
+    uint8_t rates[NETSIM_QUEUE_SIZE];
+    uint8_t senders[NETSIM_QUEUE_SIZE];
+    bool broken[NETSIM_QUEUE_SIZE];
+    uint16_t head;
+    uint16_t tail;
+    // the messages which this board has received, and the first of them
+    uint8_t delivered;
+    uint8_t delivered_payload;
+    uint64_t delivered_time;
+    // the time at which a message from each address was first received, or 0
+    uint64_t first_time[RING_BOARDS_MAX];
+    // the broadcast which this board's user asks to send, and when, or 0
+    uint8_t request;
+    uint64_t request_time;
+    // the rematch's state, whether this board lost the last game, and when it
+    // started playing again, or 0
+    uint8_t rematch_boards;
+    bool sent_rematch;
+    uint8_t rematch_number;
+    bool rematch_relink;
+    bool continue_game;
+    bool lost;
+    uint64_t resume_time;
+} Board;
+
+static Board boards[RING_BOARDS_MAX];
+static uint8_t boards_num;
+
+/**
+ * @brief The board which is running, and the time at which it is running.
+ *
+ */
+static Board* current;
+static uint64_t now;
+
+/**
+ * @brief Whether bytes from different boards which overlap at a receiver
+ * break each other, and the number of bytes which have been broken so.
+ *
+ */
+static bool collisions = false;
+static unsigned long collided = 0;
+
+/**
+ * @brief Gets the chance that a byte is broken over a distance.
+ *
+ * @param distance The distance, in centimetres
+ * @param rate The rate which the byte is sent at
+ * @return double The chance, from 0 to 1
+ */
+static double netsim_error_p(uint8_t distance, uint8_t rate)
+{
+    double reach =
+        (double) NETSIM_RANGE_CM * IR_UART_BAUD_RATE / link_baud(rate);
+
+    if (distance <= reach) {
+        return 0;
+    }
+    if (distance >= 2 * reach) {
+        return 1;
+    }
+    return (distance - reach) / reach;
+}
+
+/**
+ * @brief Adds a byte to the bytes which are waiting to be received by a
+ * board.
+ *
+ * @param board The board
+ * @param data The byte
+ * @param arrival The time at which the byte has been received
+ * @param broken Whether the byte was broken on the way
+ */
+static void netsim_queue(Board* board, uint8_t data, uint64_t arrival,
+                         bool broken)
+{
+    uint8_t sender = current - boards;
+
+    if ((uint16_t) (board->tail - board->head) == NETSIM_QUEUE_SIZE) {
+        fprintf(stderr, "netsim: board %ld is too far behind\n",
+                (long) (board - boards));
+        exit(EXIT_FAILURE);
+    }
+
+    // the last few bytes are enough to find any which overlap this one
+    for (uint16_t i = board->tail - 8; collisions && i != board->tail; i++) {
+        uint16_t index = i % NETSIM_QUEUE_SIZE;
+
+        if (board->senders[index] != sender &&
+            board->arrival[index] >
+                arrival - NETSIM_RATE_BYTE_US(link.rate) &&
+            board->arrival[index] -
+                    NETSIM_RATE_BYTE_US(board->rates[index]) <
+                arrival) {
+            collided += !board->broken[index] + !broken;
+            board->broken[index] = true;
+            broken = true;
+        }
+    }
+
+    board->queue[board->tail % NETSIM_QUEUE_SIZE] = data;
+    board->arrival[board->tail % NETSIM_QUEUE_SIZE] = arrival;
+    board->rates[board->tail % NETSIM_QUEUE_SIZE] = link.rate;
+    board->senders[board->tail % NETSIM_QUEUE_SIZE] = sender;
+    board->broken[board->tail % NETSIM_QUEUE_SIZE] = broken;
+    board->tail++;
+}
+
+static void netsim_putc(uint8_t data)
+{
+    uint8_t next = (current - boards + 1) % boards_num;
+
+    // a byte waits for the last one to be sent
+    if (now < current->transmit_free) {
+        now = current->transmit_free;
+    }
+    current->transmit_free = now + NETSIM_RATE_BYTE_US(link.rate);
+    netsim_queue(boards + next, data, current->transmit_free,
+                 rand() < netsim_error_p(current->distance, link.rate) *
+                              ((double) RAND_MAX + 1));
+    netsim_queue(current, data, current->transmit_free, false);
+}
+
+/**
+ * @brief Checks whether the byte which is read next is broken, as it was
+ * broken on the way, or sent at a different rate.
+ *
+ * @return true The byte is broken
+ */
+static bool netsim_broken_p(void)
+{
+    uint16_t index = current->head % NETSIM_QUEUE_SIZE;
+
+    return current->broken[index] || current->rates[index] != link.rate;
+}
+
+static uint8_t netsim_getc(void)
+{
+    uint8_t data;
+
+    // the real board would wait for the byte, and stop its display, its ball
+    // and its puck until it came
+    if (!netsim_read_ready_p()) {
+        fprintf(stderr,
+                "netsim: board %ld stalled, reading a byte which had not "
+                "arrived\n",
+                (long) (current - boards));
+        exit(EXIT_FAILURE);
+    }
+    data = current->queue[current->head % NETSIM_QUEUE_SIZE];
+    if (netsim_broken_p()) {
+        data ^= 1 + rand() % 0xFF;
+    }
+    current->head++;
+    return data;
+}
+
+static bool netsim_read_ready_p(void)
+{
+    return current->head != current->tail &&
+           current->arrival[current->head % NETSIM_QUEUE_SIZE] <= now;
+}
+
+static bool netsim_write_finished_p(void)
+{
+    return current->transmit_free <= now;
+}
+
+// the rate is taken from link.rate as each byte is sent
+static void netsim_divisor_set(__unused__ uint16_t divisor)
+{
+}
+
+static timer_tick_t netsim_timer_get(void)
+{
+    return now * TIMER_RATE / 1000000UL + current->timer_offset;
+}
+
+// only a broken byte's framing error is simulated
+static uint8_t netsim_status(void)
+{
+    return netsim_read_ready_p() && netsim_broken_p() ? BIT(FE1) : 0;
+}
+
+/**
+ * @brief Swaps a board's ring state in, so that it can run.
+ *
+ * @param board The board
+ */
+static void board_enter(Board* board)
+{
+    current = board;
+    ring = board->ring;
+    memcpy(forwarded, board->forwarded, sizeof(forwarded));
+    link = board->link;
+    mac = board->mac;
+    rematch_boards = board->rematch_boards;
+    sent_rematch = board->sent_rematch;
+    rematch_number = board->rematch_number;
+    rematch_relink = board->rematch_relink;
+    continue_game = board->continue_game;
+    now = board->next_poll > board->clock ? board->next_poll : board->clock;
+}
+
+/**
+ * @brief Swaps the running board's ring state out, and sets when it next
+ * checks for IR data.
+ *
+ */
+static void board_leave(void)
+{
+    current->ring = ring;
+    memcpy(current->forwarded, forwarded, sizeof(forwarded));
+    current->link = link;
+    current->mac = mac;
+    current->rematch_boards = rematch_boards;
+    current->sent_rematch = sent_rematch;
+    current->rematch_number = rematch_number;
+    current->rematch_relink = rematch_relink;
+    current->continue_game = continue_game;
+    current->clock = now;
+    while (current->next_poll <= now) {
+        current->next_poll += NETSIM_POLL_US;
+    }
+
+    // a board which is part of the way through a message is woken by its next
+    // byte, as the tasks which read IR are
+    if (ring.incoming_received != 0 && current->head != current->tail &&
+        current->arrival[current->head % NETSIM_QUEUE_SIZE] <
+            current->next_poll) {
+        current->next_poll =
+            current->arrival[current->head % NETSIM_QUEUE_SIZE];
+    }
+}
+
+/**
+ * @brief Sets up a new ring of boards, each of which checks for IR data at a
+ * random time within its period.
+ *
+ * @param num The number of boards
+ */
+static void netsim_init(uint8_t num)
+{
+    boards_num = num;
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i] = (Board){.next_poll = rand() % NETSIM_POLL_US,
+                            .push_time = rand() % NETSIM_PUSH_US,
+                            .timer_offset = rand()};
+        board_enter(boards + i);
+        ring_init();
+        link_init();
+        board_leave();
+    }
+}
+
+/**
+ * @brief What the boards do each time that they check for IR data.
+ *
+ */
+#define NETSIM_DISCOVER 0
+#define NETSIM_RECEIVE 1
+#define NETSIM_LINK 2
+#define NETSIM_REMATCH 3
+
+/**
+ * @brief Runs the board which checks for IR data next.
+ *
+ * @param mode What the boards are doing: discovering the ring, receiving
+ * messages, agreeing on the rate, or agreeing on a rematch
+ * @return uint64_t The time at which the board ran
+ */
+static uint64_t netsim_step(uint8_t mode)
+{
+    Board* board = boards;
+    uint64_t time;
+
+    for (uint8_t i = 1; i < boards_num; i++) {
+        if (boards[i].next_poll < board->next_poll) {
+            board = boards + i;
+        }
+    }
+    board_enter(board);
+    time = now;
+
+    if (mode == NETSIM_DISCOVER) {
+        ring_discover(now >= board->push_time);
+    } else if (mode == NETSIM_LINK) {
+        link_negotiate();
+    } else if (mode == NETSIM_REMATCH && continue_game) {
+        text_pushed = now >= board->push_time;
+        lost_game = board->lost;
+        rematch_task(NULL);
+        if (!continue_game) {
+            board->resume_time = now;
+        }
+    } else {
+        uint8_t payload[RING_PAYLOAD_MAX];
+        uint8_t source;
+
+        // a board which is playing again still passes the ring's messages on,
+        // as its ball_receive_task does
+        if (ring_receive(payload, &source)) {
+            if (board->delivered++ == 0) {
+                board->delivered_payload = payload[0];
+                board->delivered_time = now;
+            }
+            if (board->first_time[source] == 0) {
+                board->first_time[source] = now;
+            }
+        }
+        // the user's broadcast is sent as the rematch task sends it
+        if (board->request != 0 && now >= board->request_time) {
+            ring_broadcast(&board->request, 1);
+            board->request = 0;
+        }
+    }
+    board_leave();
+    return time;
+}
+
+/**
+ * @brief Runs a discovery, and checks that the board which started it has
+ * address 0, and that the rest of the boards have the following addresses.
+ *
+ * @param num The number of boards
+ * @param tie The nonce with which the first two boards start a discovery at
+ * the same time, before the other boards, or RING_NO_NONCE for none
+ * @return uint64_t The time from the last user pushing their navswitch to
+ * every board being ready
+ */
+static uint64_t netsim_discover(uint8_t num, uint8_t tie)
+{
+    uint64_t last_push = 0;
+    uint64_t time = 0;
+    uint8_t origin = 0;
+    bool ready = false;
+
+    netsim_init(num);
+    if (tie != RING_NO_NONCE) {
+        // the nonce is the timer, modulo RING_NO_NONCE, at the first check
+        // after the user pushes the navswitch, so the timers are set to give
+        // the tied nonce then, and are kept from wrapping before then
+        uint64_t poll;
+        timer_tick_t ticks;
+
+        for (uint8_t i = 2; i < num; i++) {
+            boards[i].push_time += NETSIM_PUSH_US / 4;
+        }
+        boards[0].push_time %= NETSIM_PUSH_US / 4;
+        boards[0].push_time += NETSIM_POLL_US;
+        poll = boards[0].next_poll;
+        while (poll < boards[0].push_time) {
+            poll += NETSIM_POLL_US;
+        }
+        ticks = poll * TIMER_RATE / 1000000UL;
+        boards[0].timer_offset =
+            (tie + RING_NO_NONCE - ticks % RING_NO_NONCE) % RING_NO_NONCE;
+        boards[1].next_poll = boards[0].next_poll;
+        boards[1].push_time = boards[0].push_time;
+        boards[1].timer_offset =
+            boards[0].timer_offset + RING_NO_NONCE * (1 + rand() % 8);
+    }
+    for (uint8_t i = 0; i < num; i++) {
+        if (boards[i].push_time > last_push) {
+            last_push = boards[i].push_time;
+        }
+    }
+
+    while (!ready) {
+        time = netsim_step(NETSIM_DISCOVER);
+        if (time > NETSIM_TIMEOUT_US) {
+            fprintf(stderr, "netsim: discovery of %u boards never finished\n",
+                    num);
+            exit(EXIT_FAILURE);
+        }
+        ready = true;
+        for (uint8_t i = 0; i < num; i++) {
+            ready = ready && boards[i].ring.ready;
+        }
+    }
+
+    while (!boards[origin].ring.origin) {
+        origin++;
+    }
+    for (uint8_t i = 0; i < num; i++) {
+        Ring* board_ring = &boards[(origin + i) % num].ring;
+        if (board_ring->address != i || board_ring->size != num ||
+            (board_ring->origin && i != 0)) {
+            fprintf(stderr, "netsim: board %u of %u has address %u of %u\n",
+                    i, num, board_ring->address, board_ring->size);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return time - last_push;
+}
+
+/**
+ * @brief Sends a message from one board, once every board has caught up, and
+ * checks that it is received once by each board which it is for.
+ *
+ * @param from The board which sends the message
+ * @param destination The address which the message is sent to
+ * @param payload The message
+ * @param length The number of bytes in the message
+ * @return uint64_t The time that the message took to be received by every
+ * board which it is for
+ */
+static uint64_t netsim_send(uint8_t from, uint8_t destination,
+                            const uint8_t* payload, uint8_t length)
+{
+    uint64_t start = 0;
+    uint64_t end = 0;
+
+    for (uint8_t i = 0; i < boards_num; i++) {
+        boards[i].head = boards[i].tail;
+        boards[i].delivered = 0;
+        if (boards[i].clock > start) {
+            start = boards[i].clock;
+        }
+    }
+
+    board_enter(boards + from);
+    now = start;
+    ring_send(destination, payload, length);
+    board_leave();
+
+    while (netsim_step(NETSIM_RECEIVE) < start + NETSIM_TIMEOUT_US / 10) {
+        continue;
+    }
+
+    for (uint8_t i = 0; i < boards_num; i++) {
+        uint8_t address = boards[i].ring.address;
+        bool expected = destination == boards[from].ring.address
+                            ? i != from
+                            : address == destination;
+
+        if (boards[i].delivered != expected ||
+            (expected && boards[i].delivered_payload != payload[0])) {
+            fprintf(stderr,
+                    "netsim: board %u received %u messages from board %u\n",
+                    address, boards[i].delivered, boards[from].ring.address);
+            exit(EXIT_FAILURE);
+        }
+        if (expected && boards[i].delivered_time - start > end) {
+            end = boards[i].delivered_time - start;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Runs the boards for a while after a discovery, as the real boards
+ * agree on the rate before the game starts, so that the IR is quiet by the
+ * first message.
+ *
+ */
+static void netsim_settle(void)
+{
+    uint64_t end = boards[0].clock + NETSIM_TIMEOUT_US / 10;
+
+    while (netsim_step(NETSIM_RECEIVE) < end) {
+        continue;
+    }
+}
+
+/**
+ * @brief Has one or two boards ask every other board for a rematch, once every
+ * board has caught up, and checks that each request is received by every
+ * other board.
+ *
+ * @param num The number of boards
+ * @param senders The number of boards which ask, 1 or 2
+ * @return uint64_t The longest time from a board asking to its request being
+ * received by every other board
+ */
+static uint64_t netsim_contend(uint8_t num, uint8_t senders)
+{
+    const uint8_t requests[] = {LOSER_WANTS_REMATCH, WINNER_WANTS_REMATCH};
+    uint8_t from[2];
+    uint64_t start = 0;
+    uint64_t end = 0;
+
+    from[0] = rand() % num;
+    from[1] = (from[0] + 1 + rand() % (num - 1)) % num;
+
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i].head = boards[i].tail;
+        memset(boards[i].first_time, 0, sizeof(boards[i].first_time));
+        if (boards[i].clock > start) {
+            start = boards[i].clock;
+        }
+    }
+    for (uint8_t j = 0; j < senders; j++) {
+        boards[from[j]].request = requests[j];
+        boards[from[j]].request_time = start + rand() % NETSIM_CONTEND_US;
+    }
+
+    while (netsim_step(NETSIM_RECEIVE) < start + NETSIM_CONTEND_RUN_US) {
+        continue;
+    }
+
+    for (uint8_t j = 0; j < senders; j++) {
+        Board* sender = boards + from[j];
+
+        for (uint8_t i = 0; i < num; i++) {
+            uint64_t time = boards[i].first_time[sender->ring.address];
+
+            if (i == from[j]) {
+                continue;
+            }
+            if (time == 0) {
+                fprintf(stderr,
+                        "netsim: board %u of %u never received the rematch "
+                        "request from board %u\n",
+                        boards[i].ring.address, num, sender->ring.address);
+                exit(EXIT_FAILURE);
+            }
+            if (time - sender->request_time > end) {
+                end = time - sender->request_time;
+            }
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Runs an agreement on the rate, once every board has caught up, and
+ * checks that every board has agreed on the same rate, and uses it.
+ *
+ * @param num The number of boards
+ * @return uint64_t The time that the agreement took
+ */
+static uint64_t netsim_agree(uint8_t num)
+{
+    uint64_t start = 0;
+    uint64_t time = 0;
+    bool agreed = false;
+
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i].head = boards[i].tail;
+        if (boards[i].clock > start) {
+            start = boards[i].clock;
+        }
+    }
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i].clock = start;
+    }
+
+    while (!agreed) {
+        time = netsim_step(NETSIM_LINK);
+        if (time > start + NETSIM_LINK_TIMEOUT_US) {
+            fprintf(stderr, "netsim: %u boards never agreed on the rate\n",
+                    num);
+            exit(EXIT_FAILURE);
+        }
+        agreed = true;
+        for (uint8_t i = 0; i < num; i++) {
+            agreed = agreed && boards[i].link.state == LINK_AGREED;
+        }
+    }
+
+    for (uint8_t i = 0; i < num; i++) {
+        if (boards[i].link.agreed != boards[0].link.agreed ||
+            boards[i].link.rate != boards[0].link.agreed) {
+            fprintf(stderr,
+                    "netsim: board %u of %u agreed on rate %u, and uses %u, "
+                    "but board 0 agreed on %u\n",
+                    boards[i].ring.address, num, boards[i].link.agreed,
+                    boards[i].link.rate, boards[0].link.agreed);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return time - start;
+}
+
+/**
+ * @brief Runs a rematch, once every board has caught up: each user pushes
+ * their navswitch at a random time, and each board runs the rematch task
+ * until it starts playing again. Checks that every board ends up on the same
+ * rate, and that the rate was kept unless a board's link was degraded.
+ *
+ * @param num The number of boards
+ * @param degraded Whether a board's link broke too many bytes during the game
+ * @return uint64_t The time from the last user pushing their navswitch to
+ * every board playing again
+ */
+static uint64_t netsim_rematch(uint8_t num, bool degraded)
+{
+    uint8_t rate = boards[0].link.agreed;
+    uint8_t loser = rand() % num;
+    uint64_t start = 0;
+    uint64_t last_push = 0;
+    uint64_t end = 0;
+    bool playing = false;
+
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i].head = boards[i].tail;
+        if (boards[i].clock > start) {
+            start = boards[i].clock;
+        }
+    }
+    for (uint8_t i = 0; i < num; i++) {
+        boards[i].clock = start;
+        boards[i].push_time = start + rand() % NETSIM_PUSH_US;
+        boards[i].lost = i == loser;
+        boards[i].resume_time = 0;
+        if (boards[i].push_time > last_push) {
+            last_push = boards[i].push_time;
+        }
+        // the game's bytes are counted from a clean start
+        boards[i].link.bytes = 0;
+        boards[i].link.errors = 0;
+        board_enter(boards + i);
+        rematch_init();
+        board_leave();
+    }
+    if (degraded) {
+        boards[loser].link.bytes = NETSIM_DEGRADED_BYTES;
+        boards[loser].link.errors = NETSIM_DEGRADED_ERRORS;
+    }
+
+    while (!playing) {
+        uint64_t time = netsim_step(NETSIM_REMATCH);
+
+        if (time > last_push + NETSIM_LINK_TIMEOUT_US) {
+            fprintf(stderr, "netsim: rematch of %u boards never finished\n",
+                    num);
+            exit(EXIT_FAILURE);
+        }
+        playing = true;
+        for (uint8_t i = 0; i < num; i++) {
+            playing = playing && !boards[i].continue_game;
+        }
+    }
+
+    for (uint8_t i = 0; i < num; i++) {
+        if (boards[i].link.rate != boards[0].link.rate ||
+            (!degraded && boards[i].link.rate != rate)) {
+            fprintf(stderr,
+                    "netsim: board %u of %u uses rate %u after a rematch, "
+                    "board 0 uses %u, and the game used %u\n",
+                    boards[i].ring.address, num, boards[i].link.rate,
+                    boards[0].link.rate, rate);
+            exit(EXIT_FAILURE);
+        }
+        if (boards[i].resume_time - last_push > end) {
+            end = boards[i].resume_time - last_push;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Gets the fastest rate at which no link breaks any byte.
+ *
+ * @param num The number of boards
+ * @return uint8_t The rate
+ */
+static uint8_t netsim_clean_rate(uint8_t num)
+{
+    uint8_t rate = LINK_RATES_NUM - 1;
+
+    for (uint8_t i = 0; i < num; i++) {
+        while (rate > 0 && netsim_error_p(boards[i].distance, rate) > 0) {
+            rate--;
+        }
+    }
+    return rate;
+}
+
+/**
+ * @brief Checks that a rate is at least as fast as a bound, and at most as
+ * fast as another.
+ *
+ * @param name What the rate is of
+ * @param num The number of boards
+ * @param rate The rate
+ * @param slowest The slowest rate which is allowed
+ * @param fastest The fastest rate which is allowed
+ * @return true The rate is within its bounds
+ */
+static bool netsim_check_rate(const char* name, uint8_t num, uint8_t rate,
+                              uint8_t slowest, uint8_t fastest)
+{
+    if (rate < slowest || rate > fastest) {
+        fprintf(stderr,
+                "netsim: %s with %u boards agreed on %u baud, not %u to %u "
+                "baud\n",
+                name, num, link_baud(rate), link_baud(slowest),
+                link_baud(fastest));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks that a time is within its bound.
+ *
+ * @param name What the time is of
+ * @param num The number of boards
+ * @param time The time
+ * @param bound The bound
+ * @return true The time is within its bound
+ */
+static bool netsim_check(const char* name, uint8_t num, uint64_t time,
+                         uint64_t bound)
+{
+    if (time > bound) {
+        fprintf(stderr, "netsim: %s with %u boards took %lu us, over %lu us\n",
+                name, num, (unsigned long) time, (unsigned long) bound);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the simulation for each number of boards, and prints the worst
+ * times as CSV.
+ *
+ * @return int EXIT_FAILURE if any time was over its bound
+ */
+int main(void)
+{
+    // the longest handoff carries the sending board's puck as well
+    const uint8_t ball_packet[RING_PAYLOAD_MAX] = {
+        GHOST_PACKET | GHOST_WITH_BALL, BALL_PACKET, 0};
+    const uint8_t lost = I_HAVE_LOST;
+    bool passed = true;
+
+    srand(1);
+    printf("boards,discovery_ms,tied_ms,handoff_ms,routed_ms,broadcast_ms\n");
+    for (uint8_t num = 2; num <= RING_BOARDS_MAX; num++) {
+        uint64_t discovery = 0;
+        uint64_t tied = 0;
+        uint64_t handoff = 0;
+        uint64_t routed = 0;
+        uint64_t broadcast = 0;
+
+        for (uint8_t trial = 0; trial < NETSIM_TRIALS; trial++) {
+            uint64_t time = netsim_discover(num, RING_NO_NONCE);
+            if (time > discovery) {
+                discovery = time;
+            }
+            netsim_settle();
+
+            for (uint8_t from = 0; from < num; from++) {
+                uint8_t address = boards[from].ring.address;
+
+                board_enter(boards + from);
+                uint8_t next = ring_next();
+                board_leave();
+
+                time = netsim_send(from, next, ball_packet, RING_PAYLOAD_MAX);
+                handoff = time > handoff ? time : handoff;
+
+                // the previous board is the furthest away
+                time = netsim_send(from, (address + num - 1) % num, &lost, 1);
+                routed = time > routed ? time : routed;
+
+                time = netsim_send(from, address, &lost, 1);
+                broadcast = time > broadcast ? time : broadcast;
+            }
+        }
+
+        // two boards which start with the same nonce each take the other's
+        // token for their own echo, until they draw different nonces. The
+        // lowest nonces are tied too, as no lower one can be drawn.
+        for (uint8_t trial = 0; trial < NETSIM_TRIALS; trial++) {
+            uint8_t tie = trial < 2 ? trial : rand() % RING_NO_NONCE;
+            uint64_t time = netsim_discover(num, tie);
+
+            tied = time > tied ? time : tied;
+        }
+
+        printf("%u,%lu,%lu,%lu,%lu,%lu\n", num,
+               (unsigned long) discovery / 1000, (unsigned long) tied / 1000,
+               (unsigned long) handoff / 1000, (unsigned long) routed / 1000,
+               (unsigned long) broadcast / 1000);
+
+        // the ball is always handed to the next board, so its handoff does not
+        // depend on the number of boards
+        passed &= netsim_check("handoff", num, handoff,
+                               NETSIM_HOP_US(RING_PAYLOAD_MAX));
+        passed &= netsim_check("routed message", num, routed,
+                               (num - 1) * NETSIM_HOP_US(1));
+        passed &= netsim_check("broadcast", num, broadcast,
+                               (num - 1) * NETSIM_HOP_US(1));
+    }
+
+    printf("\nboards,link_ms,rate_4800,rate_2400,rate_1200,lossy,"
+           "degraded_ms,rematch_ms,relinked_ms\n");
+    for (uint8_t num = 2; num <= RING_BOARDS_MAX; num++) {
+        uint64_t agreement = 0;
+        uint64_t degraded = 0;
+        uint64_t rematch = 0;
+        uint64_t relinked = 0;
+        uint8_t rates[LINK_RATES_NUM] = {0};
+        uint8_t lossy = 0;
+
+        for (uint8_t trial = 0; trial < NETSIM_TRIALS; trial++) {
+            uint8_t clean;
+            uint8_t rate;
+            uint8_t board;
+            uint64_t time;
+
+            netsim_discover(num, false);
+            for (uint8_t i = 0; i < num; i++) {
+                boards[i].distance = rand() % (NETSIM_DISTANCE_MAX_CM + 1);
+            }
+            clean = netsim_clean_rate(num);
+
+            time = netsim_agree(num);
+            agreement = time > agreement ? time : agreement;
+            rate = boards[0].link.agreed;
+            rates[rate]++;
+            lossy += rate > clean;
+            // a faster rate can get through by chance, but never one at which
+            // nothing gets through
+            passed &= netsim_check_rate("agreement", num, rate, clean,
+                                        LINK_RATES_NUM - 1);
+            for (uint8_t i = 0; i < num; i++) {
+                passed &= netsim_error_p(boards[i].distance, rate) < 1;
+            }
+
+            // a rematch after a clean game keeps the rate
+            time = netsim_rematch(num, false);
+            rematch = time > rematch ? time : rematch;
+
+            // a board which broke too many bytes in the game stops the rate
+            // from being agreed again
+            board = rand() % num;
+            boards[board].link.bytes = NETSIM_DEGRADED_BYTES;
+            boards[board].link.errors = NETSIM_DEGRADED_ERRORS;
+            for (uint8_t i = 0; i < num; i++) {
+                board_enter(boards + i);
+                link_restart();
+                board_leave();
+            }
+            time = netsim_agree(num);
+            degraded = time > degraded ? time : degraded;
+            passed &= netsim_check_rate(
+                "degraded agreement", num, boards[0].link.agreed, 0,
+                rate > 0 ? rate - 1 : 0);
+
+            // a rematch after a game which broke too many bytes agrees on the
+            // rate again first
+            rate = boards[0].link.agreed;
+            time = netsim_rematch(num, true);
+            relinked = time > relinked ? time : relinked;
+            passed &= netsim_check_rate("relinked rematch", num,
+                                        boards[0].link.agreed, 0, rate);
+        }
+
+        printf("%u,%lu,%u,%u,%u,%u,%lu,%lu,%lu\n", num,
+               (unsigned long) agreement / 1000, rates[2], rates[1], rates[0],
+               lossy, (unsigned long) degraded / 1000,
+               (unsigned long) rematch / 1000,
+               (unsigned long) relinked / 1000);
+        passed &= netsim_check("rate agreement", num, agreement,
+                               NETSIM_LINK_TIMEOUT_US);
+        passed &= netsim_check("rematch", num, rematch, NETSIM_REMATCH_US(num));
+        // a rematch which agrees on the rate again can also take as long as
+        // the agreement
+        passed &= netsim_check("relinked rematch", num, relinked,
+                               NETSIM_REMATCH_US(num) +
+                                   NETSIM_LINK_TIMEOUT_US);
+    }
+
+    // two boards ask for a rematch at about the same time, over an IR on
+    // which their bytes break each other if they overlap, and are compared
+    // with a board which asks on its own
+    printf("\nboards,trials,collided_bytes,deferred,retries,truncated,mean_ms,"
+           "worst_ms,lone_ms,added_ms\n");
+    for (uint8_t num = 2; num <= RING_BOARDS_MAX; num++) {
+        uint64_t total = 0;
+        uint64_t worst = 0;
+        uint64_t lone = 0;
+
+        // the discovery runs without collisions, as the origin's retry would
+        // only slow it down
+        collisions = false;
+        netsim_discover(num, false);
+        netsim_settle();
+        collisions = true;
+        collided = 0;
+        stats.ir_deferred = 0;
+        stats.ir_retries = 0;
+        stats.ir_truncated = 0;
+
+        for (uint16_t trial = 0; trial < NETSIM_CONTEND_TRIALS; trial++) {
+            uint64_t time = netsim_contend(num, 2);
+
+            total += time;
+            worst = time > worst ? time : worst;
+        }
+        printf("%u,%u,%lu,%u,%u,%u,%.1f,%.1f,", num, NETSIM_CONTEND_TRIALS,
+               collided, stats.ir_deferred, stats.ir_retries,
+               stats.ir_truncated,
+               total / 1000.0 / NETSIM_CONTEND_TRIALS, worst / 1000.0);
+
+        for (uint16_t trial = 0; trial < NETSIM_CONTEND_TRIALS; trial++) {
+            lone += netsim_contend(num, 1);
+        }
+        printf("%.1f,%.1f\n", lone / 1000.0 / NETSIM_CONTEND_TRIALS,
+               ((double) total - lone) / 1000.0 / NETSIM_CONTEND_TRIALS);
+    }
+    collisions = false;
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
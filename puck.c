@@ -19,9 +19,22 @@
 
 #include "board.h"
 #include "display.h"
+#include "navevent.h"
+#include "stats.h"
+#include "timer.h"
 
 Puck puck;
 
+/**
+ * @brief The direction which the navswitch is held in since its last press,
+ * the time at which the puck next moves by itself, and the number of ticks
+ * until the move after that.
+ *
+ */
+static NavMovement held = PUCK_MOVE_NONE;
+static timer_tick_t repeat_time;
+static timer_tick_t repeat_ticks;
+
 /**
  * @brief Updates the puck in the board/display.
  * CAN ONLY BE USED AFTER board_init().
@@ -50,7 +63,7 @@ static void puck_update_value(NavMovement change)
 {
     // ensures that the puck stays within the bounds of the display
     if (puck.new_bottom + change >= BOTTOM_ROW &&
-        puck.new_top + change < LEDMAT_ROWS_NUM) {
+        puck.new_top + change < FIELD_ROWS) {
         puck = (Puck){.old_bottom = puck.new_bottom,
                       .old_top = puck.new_top,
                       .new_bottom = puck.new_bottom + change,
@@ -59,6 +72,53 @@ static void puck_update_value(NavMovement change)
     }
 }
 
+/**
+ * @brief Starts the repeat for a press of the navswitch, unless it is turned
+ * off.
+ *
+ * @param change The change to the puck's position which the press made
+ * @param press_time The time at which the navswitch was pressed
+ */
+static void puck_repeat_start(NavMovement change, timer_tick_t press_time)
+{
+    if (PUCK_REPEAT_DELAY_MS == 0) {
+        return;
+    }
+    held = change;
+    repeat_time = press_time + PUCK_MS_TO_TICKS(PUCK_REPEAT_DELAY_MS);
+    repeat_ticks = PUCK_MS_TO_TICKS(PUCK_REPEAT_START_MS);
+}
+
+/**
+ * @brief Moves the puck by itself while the navswitch is still held, once
+ * each repeat is due, and shortens the time to the next repeat. Any repeat
+ * which fell due while the task was late is made straight away.
+ *
+ */
+static void puck_repeat(void)
+{
+    timer_tick_t now;
+
+    if (held == PUCK_MOVE_NONE) {
+        return;
+    }
+    if (!navevent_down_p(held == PUCK_MOVE_SOUTH ? NAVSWITCH_COMPASS_SOUTH
+                                                 : NAVSWITCH_COMPASS_NORTH)) {
+        held = PUCK_MOVE_NONE;
+        return;
+    }
+
+    now = timer_get();
+    while ((int16_t) (now - repeat_time) >= 0) {
+        puck_update_value(held);
+        repeat_time += repeat_ticks;
+        repeat_ticks -= repeat_ticks >> PUCK_REPEAT_ACCEL_SHIFT;
+        if (repeat_ticks < PUCK_MS_TO_TICKS(PUCK_REPEAT_FASTEST_MS)) {
+            repeat_ticks = PUCK_MS_TO_TICKS(PUCK_REPEAT_FASTEST_MS);
+        }
+    }
+}
+
 void puck_init(void)
 {
     puck = (Puck){.old_top = STARTING_OLD,
@@ -66,17 +126,42 @@ void puck_init(void)
                   .new_top = STARTING_TOP,
                   .new_bottom = STARTING_BOTTOM};
     puck_update_display();
+    navevent_flush();
+    held = PUCK_MOVE_NONE;
+}
+
+void puck_show(void)
+{
+    puck.old_bottom = puck.new_bottom;
+    puck.old_top = puck.new_top;
+    puck_update_display();
+    navevent_flush();
+    held = PUCK_MOVE_NONE;
 }
 
 void puck_task(__unused__ void* data)
 {
-    navswitch_update();
+    NavEvent event;
+    NavMovement change;
 
-    if (navswitch_push_event_p(NAVSWITCH_COMPASS_SOUTH)) {
-        puck_update_value(PUCK_MOVE_SOUTH);
-    }
+    // every press since the last run is applied, in the order it was made,
+    // and the last one is repeated while it is held
+    while (navevent_pop(&event)) {
+        int8_t bottom = puck.new_bottom;
 
-    if (navswitch_push_event_p(NAVSWITCH_COMPASS_NORTH)) {
-        puck_update_value(PUCK_MOVE_NORTH);
+        if (event.button == NAVSWITCH_COMPASS_SOUTH) {
+            change = PUCK_MOVE_SOUTH;
+        } else if (event.button == NAVSWITCH_COMPASS_NORTH) {
+            change = PUCK_MOVE_NORTH;
+        } else {
+            continue;
+        }
+        puck_update_value(change);
+        puck_repeat_start(change, event.time);
+        // a press against a wall leaves nothing for the display to show
+        if (puck.new_bottom != bottom) {
+            stats_input(event.time);
+        }
     }
+    puck_repeat();
 }
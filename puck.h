@@ -12,14 +12,16 @@
  */
 #ifndef PUCK_H
 #define PUCK_H
+#include "field.h"
 #include "ledmat.h"
 #include "navswitch.h"
 #include "system.h"
+#include "timer.h"
 
 /**
  * @brief The column which the puck resides in.
  */
-#define PUCK_COL LEDMAT_COLS_NUM - 1
+#define PUCK_COL FIELD_LAST_COLUMN
 
 /**
  * @brief Arbitrary numbers for the starting old_* attributes.
@@ -27,14 +29,14 @@
 #define STARTING_OLD 0
 
 /**
- * @brief The initial top column for the puck.
+ * @brief The initial bottom row for the puck, which centres it in the field.
  */
-#define STARTING_TOP 4
+#define STARTING_BOTTOM ((FIELD_ROWS - PUCK_LENGTH) / 2)
 
 /**
- * @brief The initial bottom column for the puck.
+ * @brief The initial top row for the puck.
  */
-#define STARTING_BOTTOM 2
+#define STARTING_TOP (STARTING_BOTTOM + PUCK_LENGTH - 1)
 
 /**
  * @brief Corrected the name, according to the compass scheme (see
@@ -50,6 +52,51 @@
  */
 #define NAVSWITCH_COMPASS_NORTH NAVSWITCH_SOUTH
 
+/**
+ * @brief The time for which the navswitch must be held after a press before
+ * the puck starts to move by itself, in milliseconds. Can be set at build
+ * time. 0 turns the repeat off, so that each press moves the puck once.
+ */
+#ifndef PUCK_REPEAT_DELAY_MS
+#define PUCK_REPEAT_DELAY_MS 160
+#endif
+
+/**
+ * @brief The time between the puck's first two moves by itself, and the
+ * shortest time that it speeds up to, in milliseconds. Can be set at build
+ * time.
+ */
+#ifndef PUCK_REPEAT_START_MS
+#define PUCK_REPEAT_START_MS 90
+#endif
+
+#ifndef PUCK_REPEAT_FASTEST_MS
+#define PUCK_REPEAT_FASTEST_MS 40
+#endif
+
+/**
+ * @brief The shift which gives how much of the time between the puck's moves
+ * is taken off after each move by itself. Can be set at build time. 2 takes a
+ * quarter off each time.
+ */
+#ifndef PUCK_REPEAT_ACCEL_SHIFT
+#define PUCK_REPEAT_ACCEL_SHIFT 2
+#endif
+
+#if PUCK_REPEAT_DELAY_MS > 1000 || PUCK_REPEAT_START_MS > 1000
+#error "The puck's repeat must be at most a second, as the timer wraps"
+#endif
+
+#if PUCK_REPEAT_FASTEST_MS < 1 || PUCK_REPEAT_FASTEST_MS > PUCK_REPEAT_START_MS
+#error "PUCK_REPEAT_FASTEST_MS must be at least 1, and at most the start"
+#endif
+
+/**
+ * @brief Converts a time in milliseconds to timer ticks.
+ */
+#define PUCK_MS_TO_TICKS(ms)                                                   \
+    ((timer_tick_t) ((uint32_t) TIMER_RATE * (ms) / 1000))
+
 /**
  * @brief Specifies the values for the movement of the navswitch.
  * It is assumed that the orientation of the device is such that the IR I/O is
@@ -57,6 +104,7 @@
  */
 typedef enum nav_movement_e {
     PUCK_MOVE_SOUTH = -1,
+    PUCK_MOVE_NONE = 0,
     PUCK_MOVE_NORTH = 1
 } NavMovement;
 
@@ -87,8 +135,18 @@ Puck puck;
 void puck_init(void);
 
 /**
- * @brief Updates the puck's position based on the user's interaction with the
- * navswitch.
+ * @brief Shows the puck at its current position, so that it can be kept for a
+ * rematch. CAN ONLY BE USED AFTER board_init().
+ *
+ */
+void puck_show(void);
+
+/**
+ * @brief Updates the puck's position based on the presses of the navswitch
+ * which have been queued by navevent since the last run. While the navswitch
+ * is held after a press, the puck also moves by itself, first after
+ * PUCK_REPEAT_DELAY_MS, and then faster each time, down to
+ * PUCK_REPEAT_FASTEST_MS. The repeat is checked each time that the task runs.
  *
  */
 void puck_task(__unused__ void* data);
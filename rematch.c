@@ -0,0 +1,111 @@
+/**
+ * @file rematch.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for agreeing on a rematch.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ */
+
+#include "rematch.h"
+
+#include "board.h"
+#include "game.h"
+#include "link.h"
+#include "ring.h"
+#include "text.h"
+
+/**
+ * @brief The boards which have asked for a rematch, with a bit for each
+ * address.
+ *
+ */
+static uint8_t rematch_boards = 0;
+
+/**
+ * @brief Indicates whether this board has asked the other boards for a
+ * rematch, and the ring's number for the message which asked.
+ *
+ */
+static bool sent_rematch = false;
+static uint8_t rematch_number;
+
+/**
+ * @brief Indicates whether any board has asked for the IR rate to be agreed
+ * again before the rematch.
+ *
+ */
+static bool rematch_relink = false;
+
+/**
+ * @brief Prepares to agree on the IR rate again before the rematch, the first
+ * time that a board asks for it. The agreement only starts once every board
+ * has asked for the rematch.
+ *
+ */
+static void rematch_relink_set(void)
+{
+    if (!rematch_relink) {
+        link_restart();
+        rematch_relink = true;
+    }
+}
+
+void rematch_init(void)
+{
+    rematch_boards = 0;
+    sent_rematch = false;
+    rematch_relink = false;
+    continue_game = true;
+}
+
+void rematch_task(__unused__ void* data)
+{
+    uint8_t payload[RING_PAYLOAD_MAX];
+    uint8_t source;
+
+    // this board's own request has to reach every board first, as they stop
+    // listening for it once the rate is being agreed
+    if (rematch_boards == (uint8_t) (BIT(ring.size) - 1) &&
+        ring.delivered_number == rematch_number) {
+        // every board has heard every request, so they all agree on the rate
+        // again, or none of them does
+        if (!rematch_relink || link_negotiate()) {
+            continue_game = false;
+        }
+        return;
+    }
+
+    if (ring_receive(payload, &source) &&
+        ((payload[0] & ~REMATCH_DEGRADED) == LOSER_WANTS_REMATCH ||
+         (payload[0] & ~REMATCH_DEGRADED) == WINNER_WANTS_REMATCH)) {
+        rematch_boards |= BIT(source);
+        if (payload[0] & REMATCH_DEGRADED) {
+            rematch_relink_set();
+        }
+    }
+
+    // the ring gives up on the request after MAC_RETRIES_MAX retries, so it is
+    // asked for again
+    if (sent_rematch && !ring_sending_p() &&
+        ring.delivered_number != rematch_number) {
+        sent_rematch = false;
+    }
+
+    if (text_pushed && !sent_rematch) {
+        payload[0] = lost_game ? LOSER_WANTS_REMATCH : WINNER_WANTS_REMATCH;
+        if (link_degraded_p()) {
+            payload[0] |= REMATCH_DEGRADED;
+            rematch_relink_set();
+        }
+        ring_broadcast(payload, 1);
+        rematch_number = ring.outgoing_number;
+        rematch_boards |= BIT(ring.address);
+        sent_rematch = true;
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * @file rematch.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the rematch's function declarations which are to be shared
+ * with other files. Once a game has finished, every board agrees on a rematch
+ * alongside the result text.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ */
+
+#ifndef REMATCH_H
+#define REMATCH_H
+
+#include "system.h"
+
+/**
+ * @brief Prepares for a rematch to be agreed on, and allows the custom task
+ * scheduler to run the agreement alongside the result text.
+ *
+ */
+void rematch_init(void);
+
+/**
+ * @brief Agrees on a rematch with every other board, once the user has pushed
+ * the navswitch. Each board keeps its address, so a single byte is sent to
+ * every board, and the rematch starts once every board has sent one. The boards
+ * keep the IR rate which they agreed on, unless a board's link broke too many
+ * bytes during the last game, in which case they agree on it again first. The
+ * byte is sent until it has come back around the ring, as the other boards
+ * wait for it.
+ *
+ */
+void rematch_task(__unused__ void* data);
+
+#endif
@@ -0,0 +1,509 @@
+/**
+ * @file ring.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the IR ring.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note A board can receive its own transmissions. Its own messages carry its
+ * address as their source, and its own tokens are told apart by what they
+ * hold, so neither is mistaken for another board's.
+ * @note Each message which a board sends or forwards is heard twice by it: its
+ * own echo, and, for a broadcast, the copy which comes back around the ring.
+ * So the second copy of a broadcast tells its sender that every board has
+ * received it, and a copy of a forwarded message after its echo is the
+ * sender trying again, which is forwarded again.
+ */
+
+#include "ring.h"
+
+#include "ball.h"
+#include "cpu.h"
+#include "ghost.h"
+#include "ir_uart.h"
+#include "link.h"
+#include "mac.h"
+#include "stats.h"
+#include "timer.h"
+
+Ring ring;
+
+/**
+ * @brief The last messages which this board forwarded, with their headers, so
+ * that hearing their echoes does not forward them a second time.
+ *
+ */
+static uint8_t forwarded[RING_ECHOES_MAX][1 + RING_PAYLOAD_MAX];
+
+uint8_t ring_payload_length(uint8_t first)
+{
+    if ((first & BALL_PACKET_MASK) == BALL_PACKET) {
+        return BALL_PACKET_LENGTH;
+    } else if ((first & GHOST_PACKET_MASK) == GHOST_PACKET &&
+               (first & GHOST_WITH_BALL)) {
+        return 1 + BALL_PACKET_LENGTH;
+    }
+    return 1;
+}
+
+/**
+ * @brief Whether any byte has been broken since this board last sent its
+ * outgoing message.
+ *
+ */
+static bool garbled;
+
+/**
+ * @brief Receives a byte, and counts it, and whether it was broken.
+ *
+ * @return uint8_t The byte
+ */
+static uint8_t ring_getc(void)
+{
+    stats.ir_bytes_in++;
+    if (link_byte()) {
+        ring.incoming_broken = true;
+        garbled = true;
+    }
+    mac_heard();
+    return ir_uart_getc();
+}
+
+/**
+ * @brief Checks whether a byte starts a message or a token of the ring.
+ *
+ * @param data The byte
+ * @return true The byte is a message's header, or a discovery or ready token
+ */
+static bool ring_first_p(uint8_t data)
+{
+    return (data & RING_PACKET_MASK) == RING_PACKET ||
+           (data & RING_TOKEN_MASK) == RING_DISCOVER ||
+           (data & RING_TOKEN_MASK) == RING_READY;
+}
+
+/**
+ * @brief Reads the bytes of a message or a token which have arrived, without
+ * waiting for the rest. Bytes before its first byte, such as telemetry or the
+ * link's tokens, are skipped, and a message or token whose next byte has not
+ * arrived within RING_GAP_BYTES bytes' worth of time is dropped.
+ *
+ * @return uint8_t The number of bytes in the message, with its header, or in
+ * the token, once every one of them has been received, otherwise 0
+ */
+static uint8_t ring_read(void)
+{
+    timer_tick_t byte_ticks;
+    uint8_t data;
+    uint8_t length = 2;
+
+    while (ir_uart_read_ready_p()) {
+        if (ring.incoming_received == 0) {
+            ring.incoming_broken = false;
+        }
+        data = ring_getc();
+        if (ring.incoming_received == 0 && !ring_first_p(data)) {
+            continue;
+        }
+        ring.incoming[ring.incoming_received++] = data;
+        ring.incoming_time = timer_get();
+
+        // a token is two bytes long, and the first byte after a message's
+        // header gives the message's length
+        if (ring.incoming_received >= 2 &&
+            (ring.incoming[0] & RING_PACKET_MASK) == RING_PACKET) {
+            length = 1 + ring_payload_length(ring.incoming[1]);
+        }
+        if (ring.incoming_received == length) {
+            ring.incoming_received = 0;
+            return length;
+        }
+    }
+
+    if (ring.incoming_received != 0) {
+        byte_ticks = 10UL * TIMER_RATE / link_baud(link.rate);
+        if ((timer_tick_t) (timer_get() - ring.incoming_time) >=
+            byte_ticks * RING_GAP_BYTES) {
+            ring.incoming_received = 0;
+            stats.ir_truncated++;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Transmits bytes, one after the other.
+ *
+ * @param bytes The bytes
+ * @param length The number of bytes
+ */
+static void ring_transmit(const uint8_t* bytes, uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++) {
+        ir_uart_putc(bytes[i]);
+    }
+    stats_ir(length);
+    mac_heard();
+}
+
+/**
+ * @brief Transmits a token, which is two bytes long.
+ *
+ * @param token The token, with its value
+ * @param data The byte which follows the token
+ */
+static void ring_token_transmit(uint8_t token, uint8_t data)
+{
+    uint8_t bytes[] = {token, data};
+
+    ring_transmit(bytes, 2);
+}
+
+/**
+ * @brief Handles a discovery token. The lowest nonce wins, so a board which
+ * started its own discovery gives up on it once a lower one reaches it.
+ *
+ * @param address The address which the token gives to this board
+ * @param nonce The nonce of the board which started the discovery
+ */
+static void ring_discover_receive(uint8_t address, uint8_t nonce)
+{
+    // a token which holds this board's own address again has been sent
+    // again by the board which started the discovery, as only that board is
+    // the same number of boards back, so its new nonce is taken even if it
+    // is higher. The echo of the token which this board forwarded holds the
+    // next address, and the echo of its own token holds the nonce it drew.
+    if (nonce < ring.nonce || (!ring.origin && address == ring.address &&
+                               nonce != ring.drawn)) {
+        ring.address = address;
+        ring.size = 0;
+        ring.nonce = nonce;
+        ring.origin = false;
+        ring.ready = false;
+        ring_token_transmit(RING_DISCOVER | ((address + 1) & RING_ADDRESS_MASK),
+                            nonce);
+    } else if (nonce > ring.nonce && ring.origin && ring.size != 0 &&
+               !ring.ready) {
+        // every board which this board's token passed has taken its nonce, so
+        // the token which seemed to come back was another board's, with the
+        // same nonce, and this board's token is sent again
+        ring.size = 0;
+    } else if (nonce == ring.nonce && ring.origin && ring.size == 0 &&
+               address != 1) {
+        // the token has come back around, rather than being heard straight
+        // after it was sent, and holds the number of boards
+        ring.size = address ? address : RING_BOARDS_MAX;
+        ring_token_transmit(RING_READY | (ring.size - 1), ring.address);
+    }
+}
+
+/**
+ * @brief Handles a ready token. The board which started the discovery is ready
+ * once the token comes back from the last board.
+ *
+ * @param size The number of boards
+ * @param sender The address of the board which sent the token
+ */
+static void ring_ready_receive(uint8_t size, uint8_t sender)
+{
+    if (ring.origin) {
+        if (ring.size == size && sender == ring.size - 1) {
+            ring.ready = true;
+        }
+    } else if (ring.nonce != RING_NO_NONCE && ring.size == 0) {
+        ring.size = size;
+    }
+}
+
+void ring_init(void)
+{
+    ring = (Ring){.nonce = RING_NO_NONCE, .drawn = RING_NO_NONCE};
+    mac_init();
+}
+
+void ring_solo(void)
+{
+    ring = (Ring){.address = 0,
+                  .size = 2,
+                  .nonce = 0,
+                  .origin = true,
+                  .ready = true,
+                  .solo = true};
+}
+
+bool ring_discover(bool user_ready)
+{
+    uint8_t token = 0;
+
+    if (ring.solo) {
+        return user_ready;
+    }
+
+    mac_update();
+
+    // a broken token could give this board the wrong address, so it is
+    // dropped, as is a message
+    if (ring_read() != 0 && !ring.incoming_broken) {
+        token = ring.incoming[0];
+    }
+    if ((token & RING_TOKEN_MASK) == RING_DISCOVER) {
+        ring_discover_receive(token & RING_ADDRESS_MASK, ring.incoming[1]);
+    } else if ((token & RING_TOKEN_MASK) == RING_READY) {
+        ring_ready_receive((token & RING_ADDRESS_MASK) + 1, ring.incoming[1]);
+    }
+
+    if (ring.origin && ring.size == 0 &&
+        (timer_tick_t) (timer_get() - ring.sent_time) >= MAC_RETRY_TICKS &&
+        mac_clear_p()) {
+        // the token has been lost, or another board started a discovery with
+        // the same nonce, and each board took the other's token for its own
+        // echo. A new nonce is drawn from the whole range each time, so two
+        // boards with the same nonce, even 0, draw different ones, and every
+        // board which has been reached takes it along with the same address.
+        ring.nonce = mac_random() % RING_NO_NONCE;
+        ring.drawn = ring.nonce;
+        ring_token_transmit(RING_DISCOVER | 1, ring.nonce);
+        mac_sent();
+        ring.sent_time = timer_get();
+        stats.ir_retries++;
+    }
+
+    if (user_ready && !ring.ready && mac_clear_p()) {
+        if (ring.nonce == RING_NO_NONCE) {
+            // no discovery has reached this board, so it starts one
+            ring.address = 0;
+            ring.nonce = timer_get() % RING_NO_NONCE;
+            ring.drawn = ring.nonce;
+            ring.origin = true;
+            ring_token_transmit(RING_DISCOVER | 1, ring.nonce);
+            mac_sent();
+            ring.sent_time = timer_get();
+        } else if (!ring.origin && ring.size != 0) {
+            ring_token_transmit(RING_READY | (ring.size - 1), ring.address);
+            mac_sent();
+            ring.ready = true;
+        }
+    }
+    return ring.ready;
+}
+
+uint8_t ring_next(void)
+{
+    return ring.address + 1 < ring.size ? ring.address + 1 : 0;
+}
+
+void ring_send(uint8_t destination, const uint8_t* payload, uint8_t length)
+{
+    ring.outgoing_number++;
+    if (ring.solo) {
+        cpu_receive(payload, length);
+        ring.delivered_number = ring.outgoing_number;
+        return;
+    }
+
+    ring.outgoing[0] = RING_PACKET | (destination << RING_DESTINATION_SHIFT) |
+                       ring.address;
+    for (uint8_t i = 0; i < length; i++) {
+        ring.outgoing[i + 1] = payload[i];
+    }
+    ring.outgoing_length = 1 + length;
+    ring.outgoing_sent = false;
+    ring.retries = 0;
+
+    ring_flush();
+    if (!ring.outgoing_sent) {
+        stats.ir_deferred++;
+        mac_backoff(0);
+    }
+}
+
+void ring_broadcast(const uint8_t* payload, uint8_t length)
+{
+    ring_send(ring.address, payload, length);
+}
+
+/**
+ * @brief Sends the outgoing broadcast again once the IR is clear, after a
+ * longer backoff, or gives up on it after MAC_RETRIES_MAX retries.
+ *
+ */
+static void ring_retry(void)
+{
+    if (ring.retries == MAC_RETRIES_MAX) {
+        ring.outgoing_length = 0;
+        return;
+    }
+    ring.retries++;
+    ring.outgoing_sent = false;
+    stats.ir_retries++;
+    mac_backoff(ring.retries);
+}
+
+void ring_flush(void)
+{
+    mac_update();
+    if (ring.outgoing_length == 0) {
+        return;
+    }
+
+    // the broadcast is sent again once it has not come back, as a board may
+    // have missed it, or once a byte is broken before it comes back, as
+    // another board has most likely started at the same time
+    if (ring.outgoing_sent) {
+        if ((timer_tick_t) (timer_get() - ring.sent_time) < MAC_RETRY_TICKS &&
+            !(garbled && ring.outgoing_heard < 2)) {
+            return;
+        }
+        ring_retry();
+        if (ring.outgoing_length == 0) {
+            return;
+        }
+    }
+
+    if (!mac_clear_p()) {
+        return;
+    }
+
+    ring_transmit(ring.outgoing, ring.outgoing_length);
+    mac_sent();
+    garbled = false;
+    ring.outgoing_sent = true;
+    ring.outgoing_heard = 0;
+    ring.sent_time = timer_get();
+
+    // only a broadcast comes back to this board
+    if (((ring.outgoing[0] >> RING_DESTINATION_SHIFT) & RING_ADDRESS_MASK) !=
+        ring.address) {
+        ring.outgoing_length = 0;
+        ring.delivered_number = ring.outgoing_number;
+    }
+}
+
+bool ring_sending_p(void)
+{
+    return ring.outgoing_length != 0;
+}
+
+/**
+ * @brief Checks whether a message which has been received is the one which
+ * this board is sending.
+ *
+ * @param header The message's header
+ * @param payload The message
+ * @param length The number of bytes in the message
+ * @return true The message is this board's outgoing message
+ */
+static bool ring_outgoing_p(uint8_t header, const uint8_t* payload,
+                            uint8_t length)
+{
+    bool same = ring.outgoing_sent && ring.outgoing_length == 1 + length &&
+                header == ring.outgoing[0];
+
+    for (uint8_t i = 0; i < length; i++) {
+        same = same && payload[i] == ring.outgoing[i + 1];
+    }
+    return same;
+}
+
+/**
+ * @brief Whether a message is the echo of one which this board forwarded, and
+ * has not yet heard. Echoes are heard in the order that their messages were
+ * forwarded, so the echoes of any messages forwarded before it have been lost,
+ * and are no longer waited for.
+ *
+ * @param header The message's header
+ * @param payload The message
+ * @param length The message's length, without its header
+ * @return true The message is an echo
+ * @return false The message is new, or has been sent again
+ */
+static bool ring_echo_p(uint8_t header, const uint8_t* payload,
+                        uint8_t length)
+{
+    uint8_t oldest = ring.forwarded_next + RING_ECHOES_MAX -
+                     ring.echoes_pending;
+
+    for (uint8_t i = 0; i < ring.echoes_pending; i++) {
+        const uint8_t* copy = forwarded[(oldest + i) % RING_ECHOES_MAX];
+        bool same = header == copy[0];
+
+        for (uint8_t j = 0; j < length; j++) {
+            same = same && payload[j] == copy[j + 1];
+        }
+        if (same) {
+            ring.echoes_pending -= i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint8_t ring_receive(uint8_t* payload, uint8_t* source)
+{
+    uint8_t header;
+    uint8_t destination;
+    uint8_t length;
+    uint8_t* copy;
+
+    if (ring.solo) {
+        *source = ring_next();
+        return cpu_transmit(payload);
+    }
+
+    ring_flush();
+    length = ring_read();
+
+    // a message with a broken byte is dropped, and is sent again if it was a
+    // broadcast
+    if (length == 0 || ring.incoming_broken) {
+        return 0;
+    }
+
+    // any other frame, such as a late token, is ignored
+    header = ring.incoming[0];
+    if ((header & RING_PACKET_MASK) != RING_PACKET) {
+        return 0;
+    }
+    length--;
+    for (uint8_t i = 0; i < length; i++) {
+        payload[i] = ring.incoming[i + 1];
+    }
+
+    *source = header & RING_ADDRESS_MASK;
+    if (*source == ring.address) {
+        // the first copy is this board's echo, and the second has come all
+        // the way around the ring
+        if (ring_outgoing_p(header, payload, length) &&
+            ++ring.outgoing_heard == 2) {
+            ring.outgoing_length = 0;
+            ring.delivered_number = ring.outgoing_number;
+        }
+        return 0;
+    }
+
+    destination = (header >> RING_DESTINATION_SHIFT) & RING_ADDRESS_MASK;
+    if (destination == ring.address) {
+        return length;
+    }
+
+    if (ring_echo_p(header, payload, length)) {
+        return 0;
+    }
+
+    copy = forwarded[ring.forwarded_next];
+    ring.forwarded_next = (ring.forwarded_next + 1) % RING_ECHOES_MAX;
+    if (ring.echoes_pending < RING_ECHOES_MAX) {
+        ring.echoes_pending++;
+    }
+    copy[0] = header;
+    for (uint8_t i = 0; i < length; i++) {
+        copy[i + 1] = payload[i];
+    }
+    ring_transmit(copy, 1 + length);
+    return destination == *source ? length : 0;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file ring.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the IR ring's function declarations and macro definitions
+ * which are to be shared with other files. The boards are placed in a ring,
+ * where each board transmits to the next board. Each board discovers its
+ * address in the ring, and every message is sent with the address of the board
+ * which it is for, so that each board only forwards what is not addressed to
+ * it.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note For information pertaining to the structure of the transmitted and
+ * received data, see README.md
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include "ball.h"
+#include "system.h"
+#include "timer.h"
+
+/**
+ * @brief The number of bits in a board's address.
+ *
+ */
+#define RING_ADDRESS_BITS 3
+
+/**
+ * @brief The most boards which can be in the ring.
+ *
+ */
+#define RING_BOARDS_MAX (1 << RING_ADDRESS_BITS)
+
+/**
+ * @brief Masks a board's address.
+ *
+ */
+#define RING_ADDRESS_MASK (RING_BOARDS_MAX - 1)
+
+/**
+ * @brief Marks the header which is sent before each message. Bits 6 and 7 of
+ * the header are 1 and 0, the destination's address is held in bits 3-5, and
+ * the source's address is held in bits 0-2. A message whose destination is
+ * its source is for every board.
+ *
+ */
+#define RING_PACKET 0x80
+
+/**
+ * @brief Masks the bits of a byte which mark it as a message's header.
+ *
+ */
+#define RING_PACKET_MASK 0xC0
+
+/**
+ * @brief The shift of the destination's address within a message's header.
+ *
+ */
+#define RING_DESTINATION_SHIFT 3
+
+/**
+ * @brief Marks a discovery token, which is passed around the ring to give each
+ * board its address. It is followed by the nonce of the board which started
+ * it, and holds the next address in bits 0-2.
+ *
+ */
+#define RING_DISCOVER 0xC0
+
+/**
+ * @brief Marks a ready token, which is passed around the ring once every board
+ * has an address, and which each board forwards once its user is ready. It is
+ * followed by the address of the board which sent it, and holds the number of
+ * boards, less one, in bits 0-2.
+ *
+ */
+#define RING_READY 0xC8
+
+/**
+ * @brief Masks the bits of a byte which mark it as a token.
+ *
+ */
+#define RING_TOKEN_MASK 0xF8
+
+/**
+ * @brief The nonce of a board which has not yet been reached by a discovery
+ * token. A token from any other board is lower than this.
+ *
+ */
+#define RING_NO_NONCE 0xFF
+
+/**
+ * @brief The longest message which can be sent around the ring: a ball, with
+ * the puck of the board which sent it.
+ *
+ */
+#define RING_PAYLOAD_MAX (1 + BALL_PACKET_LENGTH)
+
+/**
+ * @brief The number of bytes' worth of time after which a message whose next
+ * byte has not arrived is dropped. The rest of a message is always sent
+ * straight after its header, so the bytes which are missing have been lost.
+ *
+ */
+#define RING_GAP_BYTES 2
+
+/**
+ * @brief The number of forwarded messages whose echoes can be waited for at
+ * once. Messages from several boards can arrive back to back, and each is
+ * forwarded before the echo of the one before it is heard. Can be set at
+ * build time.
+ *
+ */
+#ifndef RING_ECHOES_MAX
+#define RING_ECHOES_MAX (RING_BOARDS_MAX - 1)
+#endif
+
+/**
+ * @brief Definition for the Ring type, which holds this board's place in the
+ * ring.
+ *
+ */
+typedef struct ring_s
+{
+    uint8_t address;
+    // the number of boards, or 0 while it is still unknown
+    uint8_t size;
+    // the nonce of the board which started the discovery that gave this board
+    // its address. The lowest nonce wins, if several boards start at once.
+    uint8_t nonce;
+    // the nonce which this board last drew for a discovery of its own, or
+    // RING_NO_NONCE, so that the echo of its own token is not taken for a
+    // token sent again by the board whose discovery it has since joined
+    uint8_t drawn;
+    // whether this board started the discovery that it belongs to
+    bool origin;
+    // whether this board has finished the discovery
+    bool ready;
+    // whether the other board is the CPU opponent, rather than a board over IR
+    bool solo;
+    // the message which this board is sending, with its header, and its
+    // length, or 0 once it has been sent. A broadcast is kept until it has
+    // come back around the ring.
+    uint8_t outgoing[1 + RING_PAYLOAD_MAX];
+    uint8_t outgoing_length;
+    // whether the message has been sent, the number of times that it has
+    // been heard since, the number of times that it has been sent again, and
+    // when it was last sent. The discovery token is also sent again from
+    // sent_time.
+    bool outgoing_sent;
+    uint8_t outgoing_heard;
+    uint8_t retries;
+    timer_tick_t sent_time;
+    // the number of the message which was last passed to ring_send, and of the
+    // last message which was delivered: sent, to a single board, or heard back
+    // from around the ring, for a broadcast. A message which is replaced, or
+    // given up on, is never delivered.
+    uint8_t outgoing_number;
+    uint8_t delivered_number;
+    // the number of the messages which this board last forwarded whose
+    // echoes are still to be heard, and where the next one forwarded is kept
+    uint8_t echoes_pending;
+    uint8_t forwarded_next;
+    // the message or token which is being received, with its header, the
+    // number of its bytes which have been received, or 0 before its header,
+    // whether any of them was broken, with a framing error or an overrun, and
+    // when the last of them was received. It is read as its bytes arrive, over
+    // as many calls as it takes.
+    uint8_t incoming[1 + RING_PAYLOAD_MAX];
+    uint8_t incoming_received;
+    bool incoming_broken;
+    timer_tick_t incoming_time;
+} Ring;
+
+/**
+ * @brief This board's place in the ring.
+ *
+ */
+Ring ring;
+
+/**
+ * @brief Forgets this board's place in the ring, so that it can be discovered.
+ *
+ */
+void ring_init(void);
+
+/**
+ * @brief Places this board in a ring of two with the CPU opponent, which is
+ * given address 1. Every message which would have been sent over IR is handed
+ * to the CPU opponent instead, and its messages are received in their place.
+ *
+ */
+void ring_solo(void);
+
+/**
+ * @brief Takes part in the discovery of the boards in the ring. Tokens from the
+ * other boards are answered straight away, and once the user is ready, this
+ * board either starts a discovery, or lets the discovery which reached it
+ * finish. Should be called periodically until it returns true. The board which
+ * started the discovery has address 0. A board only starts a discovery, or
+ * says that it is ready, once the IR is clear, and the discovery token is sent
+ * again every MAC_RETRY_TICKS, with a new nonce, until it comes back around
+ * the ring.
+ *
+ * @param user_ready Whether this board's user is ready to play
+ * @return true Every board in the ring has an address, and is ready
+ * @return false The discovery is still running
+ */
+bool ring_discover(bool user_ready);
+
+/**
+ * @brief Gets the address of the next board in the ring, which this board
+ * transmits to.
+ *
+ * @return uint8_t The next board's address
+ */
+uint8_t ring_next(void);
+
+/**
+ * @brief Gets the number of bytes in a message, from its first byte. Ball
+ * packets are BALL_PACKET_LENGTH bytes long, and may follow a puck byte, and
+ * every other message is a single byte.
+ *
+ * @param first The first byte of the message
+ * @return uint8_t The number of bytes in the message
+ */
+uint8_t ring_payload_length(uint8_t first);
+
+/**
+ * @brief Sends a message to a board, once the IR is clear. A message to every
+ * board is sent again, after a random backoff, if it has not come back around
+ * the ring, or a byte is broken before it does, up to MAC_RETRIES_MAX times. A
+ * single message is kept, so a message which is still waiting is replaced.
+ * The message is numbered in ring.outgoing_number, and that number is copied
+ * to ring.delivered_number once it has been delivered.
+ *
+ * @param destination The address of the board to send to. If it is this
+ * board's own address, the message is sent to every board.
+ * @param payload The message
+ * @param length The number of bytes in the message
+ */
+void ring_send(uint8_t destination, const uint8_t* payload, uint8_t length);
+
+/**
+ * @brief Sends the message which is waiting for the IR to be clear, or for its
+ * broadcast to be sent again. It is called by ring_receive, and should be
+ * called periodically by a board which sends messages without receiving
+ * them.
+ *
+ */
+void ring_flush(void);
+
+/**
+ * @brief Checks whether this board still has a message to send, or a broadcast
+ * which has not yet come back around the ring.
+ *
+ * @return true A message is still being sent
+ */
+bool ring_sending_p(void);
+
+/**
+ * @brief Sends a message to every other board in the ring.
+ *
+ * @param payload The message
+ * @param length The number of bytes in the message
+ */
+void ring_broadcast(const uint8_t* payload, uint8_t length);
+
+/**
+ * @brief Receives a message, if there is one. A message which is not
+ * addressed to this board is forwarded to the next board, straight away, and
+ * a message for every board is both forwarded and received. This board's own
+ * messages, when they have come all the way around the ring, are dropped, as
+ * is a message with a broken byte. Only the bytes which have already arrived
+ * are read, so a message can take several calls to be received, and a
+ * message which stops for RING_GAP_BYTES bytes' worth of time is dropped.
+ *
+ * @param payload Set to the message, which is at most RING_PAYLOAD_MAX bytes
+ * @param source Set to the address of the board which sent the message
+ * @return uint8_t The number of bytes in the message, or 0 if there is no
+ * message for this board
+ */
+uint8_t ring_receive(uint8_t* payload, uint8_t* source);
+
+#endif
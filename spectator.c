@@ -0,0 +1,372 @@
+/**
+ * @file spectator.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the spectator.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note Nothing in this module transmits. The ring's messages are read byte by
+ * byte, rather than with ring_receive, as ring_receive forwards them.
+ * @note The two boards which are shown are squeezed into the display, two
+ * columns to each of its columns. The board with the lower address is on the
+ * left, with its puck in the first column, and is mirrored, as it faces the
+ * board on the right.
+ */
+
+#include "spectator.h"
+
+#include "ball.h"
+#include "board.h"
+#include "display.h"
+#include "game.h"
+#include "ghost.h"
+#include "ir_uart.h"
+#include "link.h"
+#include "puck.h"
+#include "stats.h"
+#include "timer.h"
+
+Spectator spectator;
+
+/**
+ * @brief The message or token which is being read, and the number of bytes of
+ * it which have been read, or 0 while waiting for the start of one.
+ *
+ */
+static uint8_t message[1 + RING_PAYLOAD_MAX];
+static uint8_t received = 0;
+
+/**
+ * @brief The number of bytes in the message or token which is being read, or 0
+ * while it is still unknown.
+ *
+ */
+static uint8_t expected = 0;
+
+/**
+ * @brief The number of runs of spectator_task since the ball last moved.
+ *
+ */
+static uint8_t update_runs = 0;
+
+/**
+ * @brief Indicates whether the display has to be redrawn.
+ *
+ */
+static bool changed = false;
+
+/**
+ * @brief Indicates whether the boards are trying an IR rate, and when the
+ * spectator switched to it.
+ *
+ */
+static bool trying = false;
+static timer_tick_t switched = 0;
+
+/**
+ * @brief Gives the ball to a board, to serve from its starting position.
+ *
+ * @param server The board which serves
+ */
+static void spectator_serve(uint8_t server)
+{
+    spectator.holder = server;
+    spectator.ball = (Ball){.old_row = STARTING_OLD,
+                            .old_column = STARTING_OLD,
+                            .row = TO_FIXED(STARTING_ROW),
+                            .column = TO_FIXED(STARTING_COLUMN),
+                            .row_step = 0,
+                            .column_step = FIXED_ONE,
+                            .velocity = STARTING_VELOCITY,
+                            .stride = 1};
+    update_runs = 0;
+    changed = true;
+}
+
+/**
+ * @brief Gives a received ball to the board which it was sent to, in the same
+ * way as the board itself applies it.
+ *
+ * @param holder The board which the ball was sent to
+ * @param packet The BALL_PACKET_LENGTH bytes of the ball
+ */
+static void spectator_ball_receive(uint8_t holder, const uint8_t* packet)
+{
+    uint8_t corrected[BALL_PACKET_LENGTH];
+
+    // the ball is corrected as the holder corrects it, so that a broken bit
+    // does not split the spectator's game from the holder's
+    for (uint8_t i = 0; i < BALL_PACKET_LENGTH; i++) {
+        corrected[i] = packet[i];
+    }
+    ball_correct(corrected);
+    spectator.holder = holder;
+    ball_unpack(&spectator.ball, corrected);
+    update_runs = 0;
+    changed = true;
+}
+
+/**
+ * @brief Moves the ball across a single column. The holder's puck is only
+ * known when it has been sent, so the ball is always returned from the puck's
+ * column, with the same row step; the next ball which the holder sends puts it
+ * right. Once the ball is back at the TRANSMIT_COLUMN, it waits there for the
+ * holder to send it on.
+ *
+ */
+static void spectator_ball_step(void)
+{
+    Ball* ball = &spectator.ball;
+    fixed_t from_row = ball->row;
+    fixed_t from_column = ball->column;
+
+    if (ball->column_step < 0 && TO_CELL(ball->column) <= TRANSMIT_COLUMN) {
+        return;
+    }
+
+    ball->row += ball->row_step;
+    ball->column += ball->column_step;
+    ball_wall_collision(ball);
+
+    if (ball->column_step > 0 && TO_CELL(ball->column) >= PUCK_COL) {
+        ball->column_step = -ball->column_step;
+        ball->row = from_row + ball->row_step;
+        ball->column = from_column + ball->column_step;
+        ball_wall_collision(ball);
+    }
+}
+
+/**
+ * @brief Lights a cell of one of the boards which are shown.
+ *
+ * @param left Whether the board is shown on the left
+ * @param column The cell's column, on the board
+ * @param row The cell's row, on the board
+ */
+static void spectator_pixel_set(bool left, int8_t column, int8_t row)
+{
+    if (left) {
+        display_pixel_set((LAST_COLUMN - column) / 2, LAST_ROW - row, true);
+    } else {
+        display_pixel_set((FIELD_COLUMNS + column) / 2, row, true);
+    }
+}
+
+/**
+ * @brief Draws the two boards which the ball is passing between: the holder,
+ * and the board which it sends the ball to.
+ *
+ */
+static void spectator_show(void)
+{
+    uint8_t left = 0;
+    uint8_t right = 1;
+
+    if (spectator.holder != SPECTATOR_NO_HOLDER) {
+        left = spectator.holder;
+        right = left + 1 < spectator.size ? left + 1 : 0;
+        if (right < left) {
+            right = left;
+            left = 0;
+        }
+    }
+
+    display_clear();
+    for (int8_t row = 0; row < PUCK_LENGTH; row++) {
+        spectator_pixel_set(true, PUCK_COL, spectator.puck_bottoms[left] + row);
+        spectator_pixel_set(false, PUCK_COL,
+                            spectator.puck_bottoms[right] + row);
+    }
+    if (spectator.holder != SPECTATOR_NO_HOLDER) {
+        spectator_pixel_set(spectator.holder == left,
+                            TO_CELL(spectator.ball.column),
+                            TO_CELL(spectator.ball.row));
+    }
+}
+
+/**
+ * @brief Handles a token. A discovery token means that the boards are starting
+ * again, and the ready token from the last board means that the first board
+ * serves once the boards have agreed on the IR rate. The spectator switches to
+ * each rate which the boards try, and the commit token which has come all the
+ * way around the ring starts the game.
+ *
+ * @param token The token, with its value
+ * @param data The byte which follows the token
+ */
+static void spectator_token(uint8_t token, uint8_t data)
+{
+    uint8_t rate = token & LINK_RATE_MASK;
+
+    if ((token & RING_TOKEN_MASK) == RING_DISCOVER) {
+        spectator.holder = SPECTATOR_NO_HOLDER;
+        spectator.server = SPECTATOR_NO_HOLDER;
+        link_init();
+        trying = false;
+        changed = true;
+    } else if ((token & RING_TOKEN_MASK) == RING_READY) {
+        spectator.size = (token & RING_ADDRESS_MASK) + 1;
+        if (data == spectator.size - 1) {
+            spectator.server = 0;
+            link_rate_set(LINK_SLOWEST_RATE);
+        }
+    } else if ((token & RING_TOKEN_MASK) == LINK_SWITCH &&
+               rate < LINK_RATES_NUM) {
+        link_rate_set(rate);
+        trying = true;
+        switched = timer_get();
+    } else if ((token & RING_TOKEN_MASK) == LINK_COMMIT &&
+               rate < LINK_RATES_NUM) {
+        trying = false;
+        if (data == spectator.size - 1 &&
+            spectator.server != SPECTATOR_NO_HOLDER) {
+            spectator_serve(spectator.server);
+            spectator.server = SPECTATOR_NO_HOLDER;
+        }
+    }
+}
+
+/**
+ * @brief Handles a message, which may be heard more than once as it is
+ * forwarded around the ring.
+ *
+ * @param header The message's header
+ * @param payload The message
+ */
+static void spectator_message(uint8_t header, const uint8_t* payload)
+{
+    uint8_t source = header & RING_ADDRESS_MASK;
+    uint8_t destination =
+        (header >> RING_DESTINATION_SHIFT) & RING_ADDRESS_MASK;
+
+    if (source >= spectator.size) {
+        spectator.size = source + 1;
+    }
+    if (destination >= spectator.size) {
+        spectator.size = destination + 1;
+    }
+
+    if ((payload[0] & GHOST_PACKET_MASK) == GHOST_PACKET) {
+        spectator.puck_bottoms[source] = payload[0] & GHOST_BOTTOM_MASK;
+        changed = true;
+        if (!(payload[0] & GHOST_WITH_BALL)) {
+            return;
+        }
+        payload++;
+    }
+
+    if ((payload[0] & BALL_PACKET_MASK) == BALL_PACKET) {
+        spectator_ball_receive(destination, payload);
+    } else if (payload[0] == I_HAVE_LOST) {
+        spectator.holder = SPECTATOR_NO_HOLDER;
+        spectator.loser = source;
+        spectator.rematch_boards = 0;
+        spectator.relink = false;
+        changed = true;
+    } else if ((payload[0] & ~REMATCH_DEGRADED) == LOSER_WANTS_REMATCH ||
+               (payload[0] & ~REMATCH_DEGRADED) == WINNER_WANTS_REMATCH) {
+        spectator.rematch_boards |= BIT(source);
+        spectator.relink |= payload[0] & REMATCH_DEGRADED;
+        if (spectator.rematch_boards == (uint8_t) (BIT(spectator.size) - 1) &&
+            spectator.loser != SPECTATOR_NO_HOLDER &&
+            spectator.holder == SPECTATOR_NO_HOLDER) {
+            // the boards keep their rate, unless one of them asked for it to
+            // be agreed again
+            if (spectator.relink) {
+                spectator.server = spectator.loser;
+                link_rate_set(LINK_SLOWEST_RATE);
+            } else {
+                spectator_serve(spectator.loser);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds a byte to the message or token which is being read, and handles
+ * it once it is complete. A byte with bit 7 set always starts a new message or
+ * token, so that a message which was only partly heard is dropped, and any
+ * other byte before the start of one, such as telemetry, is skipped.
+ *
+ * @param data The byte
+ */
+static void spectator_read(uint8_t data)
+{
+    if (data & RING_PACKET) {
+        message[0] = data;
+        received = 1;
+        // a token is always two bytes, and a message's length comes from its
+        // first byte after the header
+        expected = (data & RING_PACKET_MASK) == RING_PACKET ? 0 : 2;
+        return;
+    }
+    if (received == 0) {
+        return;
+    }
+
+    message[received++] = data;
+    if (expected == 0) {
+        expected = 1 + ring_payload_length(data);
+    }
+    if (received == expected) {
+        if ((message[0] & RING_PACKET_MASK) == RING_PACKET) {
+            spectator_message(message[0], message + 1);
+        } else {
+            spectator_token(message[0], message[1]);
+        }
+        received = 0;
+    }
+}
+
+void spectator_init(void)
+{
+    spectator = (Spectator){.size = 2,
+                            .holder = SPECTATOR_NO_HOLDER,
+                            .loser = SPECTATOR_NO_HOLDER,
+                            .server = SPECTATOR_NO_HOLDER};
+    for (uint8_t i = 0; i < RING_BOARDS_MAX; i++) {
+        spectator.puck_bottoms[i] = STARTING_BOTTOM;
+    }
+    received = 0;
+    update_runs = 0;
+    changed = true;
+    link_init();
+    trying = false;
+}
+
+void spectator_task(__unused__ void* data)
+{
+    for (uint8_t i = 0; i < SPECTATOR_BYTES_MAX && ir_uart_read_ready_p();
+         i++) {
+        stats.ir_bytes_in++;
+        spectator_read(ir_uart_getc());
+    }
+
+    // the boards go back to the slowest rate if the rate which they tried
+    // did not work
+    if (trying && (timer_tick_t) (timer_get() - switched) >=
+                      LINK_TIMEOUT_TICKS(link.rate)) {
+        link_rate_set(LINK_SLOWEST_RATE);
+        trying = false;
+    }
+
+    // the ball moves as often as the holder's ball_task moves it
+    if (spectator.holder != SPECTATOR_NO_HOLDER &&
+        ++update_runs >= VARIABLE_PERIOD_NUMERATOR / spectator.ball.velocity) {
+        update_runs = 0;
+        for (uint8_t i = 0; i < spectator.ball.stride; i++) {
+            spectator_ball_step();
+        }
+        changed = true;
+    }
+
+    if (changed) {
+        spectator_show();
+        changed = false;
+    }
+}
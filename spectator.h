@@ -0,0 +1,95 @@
+/**
+ * @file spectator.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the spectator's function declarations and macro definitions
+ * which are to be shared with other files. A spectator is a board which only
+ * listens to the ring. It follows the ball from the messages which the players
+ * send, and shows the two boards which the ball is passing between on its own
+ * display, squeezed into a single field. It never transmits, so it can sit
+ * beside the players without disturbing them.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note For information pertaining to the structure of the received data, see
+ * README.md
+ */
+
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include "ball.h"
+#include "ring.h"
+#include "system.h"
+
+/**
+ * @brief Held in Spectator.holder while no board has the ball, such as between
+ * games.
+ *
+ */
+#define SPECTATOR_NO_HOLDER RING_BOARDS_MAX
+
+/**
+ * @brief The most bytes which are read each time that spectator_task runs. The
+ * IR delivers at most 3 bytes between runs, so this keeps up, while bounding
+ * the time that each run takes.
+ *
+ */
+#define SPECTATOR_BYTES_MAX 4
+
+/**
+ * @brief Definition for the Spectator type, which holds the game as the
+ * spectator has pieced it together.
+ *
+ */
+typedef struct spectator_s
+{
+    // the number of boards in the ring, which is at least 2, and grows if a
+    // board with a higher address is heard
+    uint8_t size;
+    // the board which has the ball, or SPECTATOR_NO_HOLDER
+    uint8_t holder;
+    // the ball, as the holder sees it. It is moved on from the last message in
+    // the same way as the holder moves it, so it is only exact when a ball is
+    // received.
+    Ball ball;
+    // the bottom of each board's puck, as that board sees it
+    int8_t puck_bottoms[RING_BOARDS_MAX];
+    // the board which lost the last game, which serves once every board has
+    // asked for a rematch
+    uint8_t loser;
+    uint8_t rematch_boards;
+    // whether a board asked for the IR rate to be agreed again before the
+    // rematch, rather than kept
+    bool relink;
+    // the board which serves once the boards have agreed on the IR rate, or
+    // SPECTATOR_NO_HOLDER
+    uint8_t server;
+} Spectator;
+
+/**
+ * @brief The game, as the spectator has pieced it together.
+ *
+ */
+Spectator spectator;
+
+/**
+ * @brief Forgets the game, and clears the display. The first game is served
+ * by the board with address 0, once every board is ready.
+ * CAN ONLY BE USED AFTER board_init().
+ *
+ */
+void spectator_init(void);
+
+/**
+ * @brief Reads the bytes which have been heard from the ring, moves the ball
+ * on, and redraws the display if anything has changed. Runs at
+ * SPECTATOR_TASK_RATE.
+ *
+ * @param void
+ */
+void spectator_task(__unused__ void* data);
+
+#endif
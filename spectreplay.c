@@ -0,0 +1,380 @@
+/**
+ * @file spectreplay.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Replays a trace of the IR traffic between the players to the real
+ * spectator module on the host, and checks the game which it pieces together
+ * against the expectations in the trace.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Each line of a trace starts with a time in milliseconds, and is one of:
+ * - `<ms> <hex bytes>`: bytes which were heard, one every byte's worth of time
+ *   from the given time.
+ * - `<ms> expect <holder> <column> <row>`: the ball is on the holder's board,
+ *   in the given cell, as the holder sees it. The holder is `-` when no board
+ *   has the ball, and the cell is then left out.
+ * - `<ms> show`: prints the spectator's display.
+ * Lines which start with `#` are comments.
+ * @note Given a second argument, the spectator's display is captured to that
+ * file after each run of spectator_task, for framerender.
+ * @note The spectator, ring and ball modules are included, rather than linked,
+ * so that their IR, display and timer calls can be redirected to the replay. A
+ * byte sent by either of them fails the replay, as the spectator must never
+ * transmit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display.h"
+#include "framecap.h"
+#include "ir_uart.h"
+#include "timer.h"
+
+// the spectator's IR, display and timer calls are made to the replay
+#define ir_uart_putc(data) spectreplay_putc(data)
+#define ir_uart_getc() spectreplay_getc()
+#define ir_uart_read_ready_p() spectreplay_read_ready_p()
+#define display_clear() spectreplay_display_clear()
+#define display_pixel_set(column, row, lit)                                    \
+    spectreplay_pixel_set(column, row, lit)
+#define timer_get() spectreplay_timer_get()
+
+static void spectreplay_putc(uint8_t data);
+static uint8_t spectreplay_getc(void);
+static bool spectreplay_read_ready_p(void);
+static void spectreplay_display_clear(void);
+static void spectreplay_pixel_set(uint8_t column, uint8_t row, bool lit);
+static timer_tick_t spectreplay_timer_get(void);
+
+#include "ball.c"
+#ifdef BALL_FEC
+#include "fec.c"
+#endif
+#include "ring.c"
+#include "spectator.c"
+
+// the ring is only included for its message lengths, and the ball for
+// ball_unpack
+void stats_ir(__unused__ uint8_t bytes)
+{
+}
+
+void cpu_receive(__unused__ const uint8_t* payload, __unused__ uint8_t length)
+{
+}
+
+uint8_t cpu_transmit(__unused__ uint8_t* payload)
+{
+    return 0;
+}
+
+uint8_t ghost_merge(__unused__ uint8_t* message)
+{
+    return 0;
+}
+
+bool ghost_receive(__unused__ uint8_t data)
+{
+    return false;
+}
+
+void warm_handoff(__unused__ const uint8_t* message, __unused__ uint8_t length)
+{
+}
+
+void warm_caught(void)
+{
+}
+
+bool warm_receive(__unused__ uint8_t data, __unused__ uint8_t source)
+{
+    return false;
+}
+
+void lifetime_hit(__unused__ uint8_t velocity)
+{
+}
+
+// the spectator never sends, so it never waits for the IR
+void mac_init(void)
+{
+}
+
+void mac_heard(void)
+{
+}
+
+void mac_update(void)
+{
+}
+
+bool mac_clear_p(void)
+{
+    return true;
+}
+
+void mac_backoff(__unused__ uint8_t attempt)
+{
+}
+
+uint16_t mac_random(void)
+{
+    return 0;
+}
+
+void mac_sent(void)
+{
+}
+
+// the replay's bytes are heard whatever the rate, so the spectator's rate is
+// only kept
+bool link_byte(void)
+{
+    return false;
+}
+
+uint16_t link_baud(__unused__ uint8_t rate)
+{
+    return IR_UART_BAUD_RATE;
+}
+
+void link_init(void)
+{
+    link = (Link){.rate = LINK_BASE_RATE, .agreed = LINK_BASE_RATE};
+}
+
+void link_rate_set(uint8_t rate)
+{
+    link.rate = rate;
+}
+
+/**
+ * @brief The number of microseconds that it takes to send a byte over IR, with
+ * its start and stop bits.
+ *
+ */
+#define SPECTREPLAY_BYTE_US (10 * 1000000UL / IR_UART_BAUD_RATE)
+
+/**
+ * @brief The number of microseconds between each run of spectator_task.
+ *
+ */
+#define SPECTREPLAY_TASK_US (1000000UL / SPECTATOR_TASK_RATE)
+
+/**
+ * @brief The most bytes which can be waiting to be read.
+ *
+ */
+#define SPECTREPLAY_QUEUE_SIZE 256
+
+/**
+ * @brief The bytes which are waiting to be read, and when they arrive.
+ *
+ */
+static uint8_t queue[SPECTREPLAY_QUEUE_SIZE];
+static uint64_t arrival[SPECTREPLAY_QUEUE_SIZE];
+static uint16_t head;
+static uint16_t tail;
+
+/**
+ * @brief The replay's time, and when spectator_task next runs.
+ *
+ */
+static uint64_t now;
+static uint64_t next_run;
+
+/**
+ * @brief The spectator's display.
+ *
+ */
+static bool pixels[LEDMAT_COLS_NUM][LEDMAT_ROWS_NUM];
+
+static void spectreplay_putc(uint8_t data)
+{
+    fprintf(stderr, "spectreplay: the spectator transmitted 0x%02x\n", data);
+    exit(EXIT_FAILURE);
+}
+
+static uint8_t spectreplay_getc(void)
+{
+    return queue[head++ % SPECTREPLAY_QUEUE_SIZE];
+}
+
+static bool spectreplay_read_ready_p(void)
+{
+    return head != tail && arrival[head % SPECTREPLAY_QUEUE_SIZE] <= now;
+}
+
+static void spectreplay_display_clear(void)
+{
+    memset(pixels, 0, sizeof(pixels));
+}
+
+static void spectreplay_pixel_set(uint8_t column, uint8_t row, bool lit)
+{
+    if (column >= LEDMAT_COLS_NUM || row >= LEDMAT_ROWS_NUM) {
+        fprintf(stderr, "spectreplay: pixel (%u, %u) is off the display\n",
+                column, row);
+        exit(EXIT_FAILURE);
+    }
+    pixels[column][row] = lit;
+}
+
+static timer_tick_t spectreplay_timer_get(void)
+{
+    return now * TIMER_RATE / 1000000UL;
+}
+
+/**
+ * @brief Captures the spectator's display, if a capture is open.
+ *
+ */
+static void spectreplay_capture(void)
+{
+    uint8_t columns[LEDMAT_COLS_NUM] = {0};
+
+    for (uint8_t column = 0; column < LEDMAT_COLS_NUM; column++) {
+        for (uint8_t row = 0; row < LEDMAT_ROWS_NUM; row++) {
+            columns[column] |= pixels[column][row] << row;
+        }
+    }
+    framecap_frame(columns);
+}
+
+/**
+ * @brief Runs spectator_task every SPECTREPLAY_TASK_US, up to a time.
+ *
+ * @param until The time to run up to
+ */
+static void spectreplay_run(uint64_t until)
+{
+    while (next_run <= until) {
+        now = next_run;
+        spectator_task(NULL);
+        spectreplay_capture();
+        next_run += SPECTREPLAY_TASK_US;
+    }
+    now = until;
+}
+
+/**
+ * @brief Prints the spectator's display, with the top row first.
+ *
+ */
+static void spectreplay_show(void)
+{
+    for (int8_t row = LEDMAT_ROWS_NUM - 1; row >= 0; row--) {
+        printf("    ");
+        for (uint8_t column = 0; column < LEDMAT_COLS_NUM; column++) {
+            putchar(pixels[column][row] ? '#' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * @brief Checks the spectator's game against an expectation.
+ *
+ * @param expectation The rest of the line, after "expect"
+ * @return true The game matches
+ */
+static bool spectreplay_expect(const char* expectation)
+{
+    char holder[4];
+    int column;
+    int row;
+
+    if (sscanf(expectation, "%3s", holder) != 1) {
+        return false;
+    }
+    if (strcmp(holder, "-") == 0) {
+        return spectator.holder == SPECTATOR_NO_HOLDER;
+    }
+    if (sscanf(expectation, "%*s %d %d", &column, &row) != 2) {
+        return false;
+    }
+    return spectator.holder == atoi(holder) &&
+           TO_CELL(spectator.ball.column) == column &&
+           TO_CELL(spectator.ball.row) == row;
+}
+
+int main(int argc, char** argv)
+{
+    FILE* trace;
+    char line[256];
+    unsigned line_num = 0;
+    unsigned expectations = 0;
+    unsigned failures = 0;
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s trace [capture]\n", argv[0]);
+        return 2;
+    }
+    if (!(trace = fopen(argv[1], "r"))) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (argc == 3 && !framecap_open(argv[2], SPECTATOR_TASK_RATE)) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    spectator_init();
+    while (fgets(line, sizeof(line), trace)) {
+        unsigned long milliseconds;
+        int consumed;
+        char* rest;
+
+        line_num++;
+        if (line[0] == '#' ||
+            sscanf(line, "%lu %n", &milliseconds, &consumed) != 1) {
+            continue;
+        }
+        rest = line + consumed;
+        spectreplay_run(milliseconds * 1000);
+
+        if (strncmp(rest, "expect", 6) == 0) {
+            expectations++;
+            if (!spectreplay_expect(rest + 6)) {
+                failures++;
+                printf("%s:%u: expected %s", argv[1], line_num, rest + 7);
+                printf("    got holder %u, ball (%d, %d)\n", spectator.holder,
+                       TO_CELL(spectator.ball.column),
+                       TO_CELL(spectator.ball.row));
+            }
+        } else if (strncmp(rest, "show", 4) == 0) {
+            printf("%lu ms:\n", milliseconds);
+            spectreplay_show();
+        } else {
+            uint64_t time = now;
+            unsigned data;
+            while (sscanf(rest, "%x %n", &data, &consumed) == 1) {
+                queue[tail % SPECTREPLAY_QUEUE_SIZE] = data;
+                arrival[tail % SPECTREPLAY_QUEUE_SIZE] = time;
+                tail++;
+                time += SPECTREPLAY_BYTE_US;
+                rest += consumed;
+            }
+        }
+    }
+    fclose(trace);
+
+    if (argc == 3) {
+        Framecap counts;
+
+        if (!framecap_close(&counts)) {
+            perror(argv[2]);
+            return 1;
+        }
+        printf("%s: %u frames in %u runs, %u bytes, %u stalls\n", argv[2],
+               counts.frames, counts.runs, counts.bytes, counts.stalls);
+    }
+    printf("%s: %u of %u expectations met\n", argv[1],
+           expectations - failures, expectations);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file stats.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the instrumentation counters.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ */
+
+#include "stats.h"
+
+#include <avr/io.h>
+#include <stddef.h>
+
+#include "timer.h"
+
+Stats stats;
+
+/**
+ * @brief The first byte after the static variables, which is where the stack
+ * may grow down to. Defined by the linker.
+ *
+ */
+extern uint8_t __heap_start;
+
+/**
+ * @brief Paints every byte from the end of the static variables to the end of
+ * SRAM before main() is called. It runs from .init3, once the stack pointer
+ * has been set up, but before anything has been put on the stack, and before
+ * the static variables are copied and cleared. The .noinit section comes
+ * before __heap_start, so the warm restart's mirror is left alone.
+ *
+ */
+static void stats_stack_paint(void)
+    __attribute__((naked, used, section(".init3")));
+
+static void stats_stack_paint(void)
+{
+    for (uint8_t* byte = &__heap_start; byte <= (uint8_t*) RAMEND; byte++) {
+        *byte = STATS_STACK_PAINT;
+    }
+}
+
+/**
+ * @brief Indicates whether the first frame since stats_start() is yet to be
+ * displayed.
+ *
+ */
+static bool first_frame_pending = false;
+
+/**
+ * @brief Indicates whether the first frame since the board was reset is yet to
+ * be displayed, and the time up to which startup_ticks and first_frame_ticks
+ * have been counted.
+ *
+ */
+static bool startup_pending = false;
+static timer_tick_t startup_counted;
+
+/**
+ * @brief Indicates whether a navswitch press has moved the puck since the last
+ * frame, and when the oldest such press was made.
+ *
+ */
+static bool input_pending = false;
+static timer_tick_t input_press_time;
+
+/**
+ * @brief The time at which the current second of IR bytes started, and the
+ * number of bytes which have been sent in it.
+ *
+ */
+static timer_tick_t ir_second_start = 0;
+static uint16_t ir_second_bytes = 0;
+
+/**
+ * @brief Counts the ticks since the board was reset, and since the user
+ * started the game, while their first frames are yet to be displayed. It is
+ * called after every task, so the timer never wraps between calls.
+ *
+ */
+static void stats_startup_count(void)
+{
+    timer_tick_t now = timer_get();
+    timer_tick_t elapsed = now - startup_counted;
+
+    startup_counted = now;
+    if (startup_pending) {
+        stats.startup_ticks += elapsed;
+    }
+    if (first_frame_pending) {
+        stats.first_frame_ticks += elapsed;
+    }
+}
+
+void stats_boot(void)
+{
+    startup_counted = timer_get();
+    startup_pending = true;
+    stats.stack_free_min = STATS_STACK_UNMEASURED;
+}
+
+void stats_start(void)
+{
+    stats_startup_count();
+    stats.start_time = timer_get();
+    stats.first_frame_ticks = 0;
+    first_frame_pending = true;
+}
+
+void stats_frame(void)
+{
+    stats_startup_count();
+    startup_pending = false;
+    first_frame_pending = false;
+    if (input_pending) {
+        input_pending = false;
+        stats.input_latency_ticks = timer_get() - input_press_time;
+        if (stats.input_latency_ticks > stats.input_latency_max_ticks) {
+            stats.input_latency_max_ticks = stats.input_latency_ticks;
+        }
+    }
+}
+
+void stats_input(timer_tick_t press_time)
+{
+    // the oldest press is kept, as it has waited longest for the frame
+    if (!input_pending) {
+        input_pending = true;
+        input_press_time = press_time;
+    }
+}
+
+void stats_ir(uint8_t bytes)
+{
+    timer_tick_t now = timer_get();
+
+    if ((timer_tick_t) (now - ir_second_start) >= TIMER_RATE) {
+        stats.ir_bytes_per_second = ir_second_bytes;
+        if (ir_second_bytes > stats.ir_bytes_per_second_max) {
+            stats.ir_bytes_per_second_max = ir_second_bytes;
+        }
+        ir_second_start = now;
+        ir_second_bytes = 0;
+    }
+    ir_second_bytes += bytes;
+    stats.ir_bytes_out += bytes;
+}
+
+/**
+ * @brief Finds a task's stats, and starts keeping them if this is the first
+ * time that the task has been recorded.
+ *
+ * @param func The task's function
+ * @return TaskStats* The task's stats, or NULL if there is no room for them
+ */
+static TaskStats* stats_task_find(task_func_t func)
+{
+    for (uint8_t i = 0; i < STATS_TASKS_NUM; i++) {
+        TaskStats* task = stats.tasks + i;
+        if (task->func == NULL) {
+            task->func = func;
+            task->stack_free_min = STATS_STACK_UNMEASURED;
+        }
+        if (task->func == func) {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+void stats_task(task_func_t func, timer_tick_t ticks)
+{
+    TaskStats* task = stats_task_find(func);
+
+    stats_startup_count();
+    if (task) {
+        task->calls++;
+        task->total_ticks += ticks;
+        if (ticks > task->worst_ticks) {
+            task->worst_ticks = ticks;
+        }
+    }
+}
+
+void stats_stack(task_func_t func)
+{
+    TaskStats* task = stats_task_find(func);
+    // the stack pointer is at the first free byte, just below this function's
+    // frame, which overlaps the top of the task's
+    uint8_t* top = (uint8_t*) SP;
+    uint8_t* byte = top + 1;
+    uint8_t* deepest = top + 1;
+    uint8_t painted = 0;
+    uint16_t free;
+
+    // the deepest byte which is not painted, above a run of STATS_STACK_GAP
+    // painted bytes
+    while (painted < STATS_STACK_GAP && byte > &__heap_start) {
+        byte--;
+        if (*byte == STATS_STACK_PAINT) {
+            painted++;
+        } else {
+            painted = 0;
+            deepest = byte;
+        }
+    }
+
+    free = deepest - &__heap_start;
+    if (free < stats.stack_free_min) {
+        stats.stack_free_min = free;
+    }
+    if (task && free < task->stack_free_min) {
+        task->stack_free_min = free;
+    }
+
+    // only the free bytes, below the stack pointer, are painted again
+    while (deepest <= top) {
+        *deepest++ = STATS_STACK_PAINT;
+    }
+}
+
+void stats_wakeup(task_func_t func, timer_tick_t ticks)
+{
+    TaskStats* task = stats_task_find(func);
+
+    if (task) {
+        task->wakeups++;
+        if (ticks > task->wakeup_worst_ticks) {
+            task->wakeup_worst_ticks = ticks;
+        }
+    }
+}
@@ -0,0 +1,213 @@
+/**
+ * @file stats.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the instrumentation counters which are kept by the game, so
+ * that they can be inspected with a debugger or dumped from the board.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note All times are in timer ticks, which run at TIMER_RATE.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "system.h"
+#include "task.h"
+#include "timer.h"
+
+/**
+ * @brief The number of different tasks which the stats are kept for. This
+ * covers the tasks for the text, the negotiation, the rematch and the
+ * lifetime statistics, and the game, including the ball's receiving, the
+ * ghost puck, the warm restart's mirror, the IR link, the telemetry and the
+ * CPU opponent.
+ *
+ */
+#define STATS_TASKS_NUM 13
+
+/**
+ * @brief The byte which the stack is painted with at startup, so that the
+ * deepest that it has reached can be found.
+ *
+ */
+#define STATS_STACK_PAINT 0xAA
+
+/**
+ * @brief The number of painted bytes in a row which end the search for the
+ * deepest that a task has used the stack. A task which leaves more of a local
+ * array than this unwritten is measured short.
+ *
+ */
+#define STATS_STACK_GAP 16
+
+/**
+ * @brief The free stack which is kept until the stack has been measured, so
+ * that a measurement of no free bytes at all is kept.
+ *
+ */
+#define STATS_STACK_UNMEASURED UINT16_MAX
+
+/**
+ * @brief Definition for the TaskStats type, which holds how long a task takes
+ * each time it is scheduled.
+ *
+ */
+typedef struct task_stats_s
+{
+    task_func_t func;
+    uint16_t calls;
+    uint32_t total_ticks;
+    timer_tick_t worst_ticks;
+    // the number of times that the task was woken by an event, and the most
+    // ticks from the event to the task running
+    uint16_t wakeups;
+    timer_tick_t wakeup_worst_ticks;
+    // the fewest bytes which were left between the stack and the static
+    // variables while the task ran, or STATS_STACK_UNMEASURED until it has
+    // been measured
+    uint16_t stack_free_min;
+} TaskStats;
+
+/**
+ * @brief Definition for the Stats type, which holds every instrumentation
+ * counter.
+ *
+ */
+typedef struct stats_s
+{
+    // the number of ticks from the board being reset to the first frame of its
+    // first game, and whether it picked up a game from before the reset. A
+    // cold start includes the welcome text and the discovery of the ring.
+    uint32_t startup_ticks;
+    bool warm_start;
+    // the time at which the user started the game from the welcome text, or
+    // asked for a rematch from the result text
+    timer_tick_t start_time;
+    // the number of ticks from the user starting the game, or asking for a
+    // rematch, to the first frame of the game being displayed. A cold start
+    // agrees on the IR rate, which takes longer than the timer takes to wrap.
+    uint32_t first_frame_ticks;
+    // the number of ticks from the last navswitch press which moved the puck
+    // to the next frame being displayed, and the most that this has been
+    timer_tick_t input_latency_ticks;
+    timer_tick_t input_latency_max_ticks;
+    // the number of navswitch presses which were lost because the queue was
+    // full
+    uint8_t nav_events_dropped;
+    // the number of bytes which were sent over IR in the last full second,
+    // and the most in any second. The IR runs at 240 bytes each second.
+    uint16_t ir_bytes_per_second;
+    uint16_t ir_bytes_per_second_max;
+    // the number of bytes which have been received and sent over IR in total,
+    // including any telemetry
+    uint16_t ir_bytes_in;
+    uint16_t ir_bytes_out;
+    // the number of messages which waited for the IR to be clear, and the
+    // number of broadcasts and discovery tokens which were sent again
+    uint16_t ir_deferred;
+    uint16_t ir_retries;
+    // the number of messages which were dropped as the rest of their bytes
+    // never arrived
+    uint16_t ir_truncated;
+    // the number of bytes which have been sent for the ghost puck
+    uint16_t ghost_bytes;
+    // the number of telemetry records which were dropped because the
+    // telemetry buffer was full
+    uint8_t telemetry_dropped;
+    // the number of received balls which had a broken bit corrected, and
+    // which were too broken to be corrected, when built with BALL_FEC
+    uint16_t fec_corrected;
+    uint16_t fec_detected;
+    // the number of times that the scheduler shed work, as a protected task
+    // kept starting late, and restored it
+    uint16_t tasks_shed;
+    uint16_t tasks_restored;
+    // the fewest bytes which were left between the stack and the static
+    // variables while any task ran, or STATS_STACK_UNMEASURED until a task
+    // has been measured
+    uint16_t stack_free_min;
+    // how long each task takes, in the order that the tasks were first
+    // scheduled
+    TaskStats tasks[STATS_TASKS_NUM];
+} Stats;
+
+/**
+ * @brief The instrumentation counters for this board.
+ *
+ */
+Stats stats;
+
+/**
+ * @brief Records that the board has just been reset, so that the time to the
+ * first frame of its first game can be measured, and marks the stack as not
+ * yet measured. CAN ONLY BE USED AFTER timer_init().
+ *
+ */
+void stats_boot(void);
+
+/**
+ * @brief Records that the user has just started the game, so that the time to
+ * the first frame can be measured.
+ *
+ */
+void stats_start(void);
+
+/**
+ * @brief Records the time to the first frame, if a frame has not already been
+ * displayed since stats_start() was called.
+ *
+ */
+void stats_frame(void);
+
+/**
+ * @brief Records a navswitch press which moved the puck. Its latency is
+ * measured by the next stats_frame(), once the frame which shows the puck has
+ * been displayed.
+ *
+ * @param press_time The time at which the navswitch was pressed
+ */
+void stats_input(timer_tick_t press_time);
+
+/**
+ * @brief Records bytes which have been sent over IR.
+ *
+ * @param bytes The number of bytes
+ */
+void stats_ir(uint8_t bytes);
+
+/**
+ * @brief Records how long a task took to run. Tasks past the first
+ * STATS_TASKS_NUM are not recorded. The time since the board was reset is
+ * also counted here until its first frame, as the timer wraps every two
+ * seconds.
+ *
+ * @param func The task's function
+ * @param ticks The number of ticks which the task took
+ */
+void stats_task(task_func_t func, timer_tick_t ticks);
+
+/**
+ * @brief Records the deepest that a task has used the stack, which is found
+ * below the caller's stack, and paints it again, so that the next task is
+ * measured on its own. Interrupts which ran in the meantime are counted
+ * against the task. Should be called straight after the task returns, from the
+ * same function which called it.
+ *
+ * @param func The task's function
+ */
+void stats_stack(task_func_t func);
+
+/**
+ * @brief Records how long a task took to run after it was woken by an event.
+ * Tasks past the first STATS_TASKS_NUM are not recorded.
+ *
+ * @param func The task's function
+ * @param ticks The number of ticks from the event to the task running
+ */
+void stats_wakeup(task_func_t func, timer_tick_t ticks);
+
+#endif
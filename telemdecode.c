@@ -0,0 +1,238 @@
+/**
+ * @file telemdecode.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Decodes a capture of the IR UART from a board which was built with
+ * TELEMETRY, and prints each record as CSV, or as a timeline with -t.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The capture holds the ring's messages and tokens as well as the
+ * telemetry, which may be sent in between the bytes of a frame. The ring's
+ * bytes are skipped using their lengths, in the same way as ring.c does. The
+ * first frame is usually counted as corrupt, as the capture starts part of the
+ * way through it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ball.h"
+#include "ghost.h"
+#include "ring.h"
+#include "telemetry.h"
+#include "timer.h"
+
+/**
+ * @brief Whether each record is printed as a line of a timeline, rather than
+ * as CSV.
+ *
+ */
+static bool timeline = false;
+
+/**
+ * @brief The time of the last record, in ticks since the first record.
+ *
+ */
+static uint32_t ticks = 0;
+static uint16_t last_time = 0;
+static uint32_t records_num = 0;
+
+/**
+ * @brief Gets the number of bytes in a ring message, from its first byte, as
+ * ring.c does.
+ *
+ * @param first The first byte of the message
+ * @return int The number of bytes in the message
+ */
+static int telemdecode_payload_length(int first)
+{
+    if ((first & BALL_PACKET_MASK) == BALL_PACKET) {
+        return BALL_PACKET_LENGTH;
+    } else if ((first & GHOST_PACKET_MASK) == GHOST_PACKET &&
+               (first & GHOST_WITH_BALL)) {
+        return 1 + BALL_PACKET_LENGTH;
+    }
+    return 1;
+}
+
+/**
+ * @brief Decodes a frame, without its delimiter, into a record.
+ *
+ * @param frame The frame
+ * @param length The number of bytes in the frame
+ * @param record Set to the record
+ * @return true The frame held a whole record, with a valid checksum
+ */
+static bool telemdecode_frame(const uint8_t* frame, size_t length,
+                              TelemetryRecord* record)
+{
+    uint8_t septets[TELEMETRY_SEPTETS];
+    uint8_t* bytes = (uint8_t*) record;
+    size_t i = 0;
+    size_t j = 0;
+    uint16_t bits = 0;
+    uint8_t bits_num = 0;
+    uint8_t checksum = 0;
+
+    if (length != TELEMETRY_SEPTETS + 1) {
+        return false;
+    }
+
+    // undo the byte stuffing
+    while (i < length) {
+        uint8_t code = frame[i++];
+        if (code == TELEMETRY_DELIMITER || i + code - 1 > length) {
+            return false;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            septets[j++] = frame[i++];
+        }
+        if (i < length) {
+            septets[j++] = TELEMETRY_DELIMITER;
+        }
+    }
+    if (j != TELEMETRY_SEPTETS) {
+        return false;
+    }
+
+    // unpack the septets, from the least significant bit of the first byte
+    j = 0;
+    for (i = 0; i < TELEMETRY_SEPTETS && j < sizeof(TelemetryRecord); i++) {
+        bits |= (uint16_t) septets[i] << bits_num;
+        bits_num += TELEMETRY_SEPTET_BITS;
+        if (bits_num >= 8) {
+            bytes[j++] = bits;
+            bits >>= 8;
+            bits_num -= 8;
+        }
+    }
+
+    for (i = 0; i < sizeof(TelemetryRecord); i++) {
+        checksum += bytes[i];
+    }
+    return checksum == 0;
+}
+
+/**
+ * @brief Prints a record, as CSV or as a line of the timeline.
+ *
+ * @param record The record
+ */
+static void telemdecode_print(const TelemetryRecord* record)
+{
+    uint16_t period_ticks;
+    double milliseconds;
+
+    period_ticks = record->time - last_time;
+    if (records_num > 0) {
+        ticks += period_ticks;
+    }
+    last_time = record->time;
+    milliseconds = ticks * 1000.0 / TIMER_RATE;
+
+    if (timeline) {
+        printf("%10.1f ms  ", milliseconds);
+        if (record->ball & TELEMETRY_HAVE_BALL) {
+            printf("ball (%5.2f, %5.2f) step %+5.2f v%u s%u",
+                   record->ball_column / (double) FIXED_ONE,
+                   record->ball_row / (double) FIXED_ONE,
+                   record->ball_row_step / (double) FIXED_ONE,
+                   record->ball & TELEMETRY_VELOCITY_MASK,
+                   (record->ball >> TELEMETRY_STRIDE_SHIFT) &
+                       TELEMETRY_STRIDE_MASK);
+        } else {
+            printf("%-38s", "ball away");
+        }
+        printf("  puck %d  ir %u/%u", record->puck_bottom, record->ir_bytes_in,
+               record->ir_bytes_out);
+        if (records_num > 0 && period_ticks > 0) {
+            printf("  busy %3.0f%%", 100.0 * record->busy_ticks / period_ticks);
+        }
+        printf("  slowest task %u (%u ticks)", record->slowest_task,
+               record->slowest_ticks);
+        if (record->dropped) {
+            printf("  dropped %u", record->dropped);
+        }
+        printf("\n");
+    } else {
+        if (records_num == 0) {
+            printf("milliseconds,have_ball,ball_row,ball_column,ball_row_step,"
+                   "velocity,stride,puck_bottom,ir_bytes_in,ir_bytes_out,"
+                   "busy_ticks,slowest_task,slowest_ticks,dropped\n");
+        }
+        printf("%.1f,%d,%d,%d,%d,%u,%u,%d,%u,%u,%u,%u,%u,%u\n", milliseconds,
+               (record->ball & TELEMETRY_HAVE_BALL) != 0, record->ball_row,
+               record->ball_column, record->ball_row_step,
+               record->ball & TELEMETRY_VELOCITY_MASK,
+               (record->ball >> TELEMETRY_STRIDE_SHIFT) & TELEMETRY_STRIDE_MASK,
+               record->puck_bottom, record->ir_bytes_in, record->ir_bytes_out,
+               record->busy_ticks, record->slowest_task, record->slowest_ticks,
+               record->dropped);
+    }
+    records_num++;
+}
+
+int main(int argc, char** argv)
+{
+    FILE* capture = stdin;
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    size_t length = 0;
+    bool overflowed = false;
+    uint32_t corrupt_num = 0;
+    uint32_t ring_bytes = 0;
+    int arg = 1;
+    int data;
+
+    if (arg < argc && strcmp(argv[arg], "-t") == 0) {
+        timeline = true;
+        arg++;
+    }
+    if (arg + 1 < argc) {
+        fprintf(stderr, "usage: %s [-t] [capture]\n", argv[0]);
+        return 2;
+    }
+    if (arg < argc && !(capture = fopen(argv[arg], "rb"))) {
+        perror(argv[arg]);
+        return 1;
+    }
+
+    while ((data = fgetc(capture)) != EOF) {
+        if (data & RING_PACKET) {
+            int skip;
+
+            if ((data & RING_PACKET_MASK) == RING_PACKET) {
+                // a message, whose length comes from its first byte
+                int first = fgetc(capture);
+                skip = first == EOF ? 0 : telemdecode_payload_length(first) - 1;
+                ring_bytes += 2 + skip;
+            } else {
+                // a token, which is followed by a single byte
+                skip = 1;
+                ring_bytes += 2;
+            }
+            while (skip-- > 0) {
+                fgetc(capture);
+            }
+        } else if (data == TELEMETRY_DELIMITER) {
+            TelemetryRecord record;
+            if (!overflowed && telemdecode_frame(frame, length, &record)) {
+                telemdecode_print(&record);
+            } else if (length > 0 || overflowed) {
+                corrupt_num++;
+            }
+            length = 0;
+            overflowed = false;
+        } else if (length < sizeof(frame)) {
+            frame[length++] = data;
+        } else {
+            overflowed = true;
+        }
+    }
+
+    fprintf(stderr, "%u records, %u corrupt frames, %u ring bytes skipped\n",
+            records_num, corrupt_num, ring_bytes);
+    return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file telemetry.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the telemetry.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ */
+
+#include "telemetry.h"
+
+#include "ball.h"
+#include "ir_uart.h"
+#include "mac.h"
+#include "puck.h"
+#include "stats.h"
+#include "timer.h"
+
+/**
+ * @brief The bytes which are waiting to be sent, from tail up to head.
+ *
+ */
+static uint8_t buffer[TELEMETRY_BUFFER_SIZE];
+static uint8_t head = 0;
+static uint8_t tail = 0;
+
+/**
+ * @brief The total number of ticks which the tasks had run for at the last
+ * record.
+ *
+ */
+static uint32_t busy_ticks_seen = 0;
+
+/**
+ * @brief Packs a record into septets, from the least significant bit of its
+ * first byte.
+ *
+ * @param record The record
+ * @param septets Set to the septets, which is TELEMETRY_SEPTETS bytes long
+ */
+static void telemetry_pack(const uint8_t* record, uint8_t* septets)
+{
+    uint16_t bits = 0;
+    uint8_t bits_num = 0;
+    uint8_t j = 0;
+
+    for (uint8_t i = 0; i < sizeof(TelemetryRecord); i++) {
+        bits |= (uint16_t) record[i] << bits_num;
+        bits_num += 8;
+        while (bits_num >= TELEMETRY_SEPTET_BITS) {
+            septets[j++] = bits & TELEMETRY_SEPTET_MASK;
+            bits >>= TELEMETRY_SEPTET_BITS;
+            bits_num -= TELEMETRY_SEPTET_BITS;
+        }
+    }
+    if (bits_num > 0) {
+        septets[j] = bits & TELEMETRY_SEPTET_MASK;
+    }
+}
+
+/**
+ * @brief Encodes the septets of a record with consistent overhead byte
+ * stuffing, so that the delimiter only appears at the end of the frame. Each
+ * code byte is at most TELEMETRY_SEPTETS + 1, so bit 7 is still 0.
+ *
+ * @param septets The septets, which is TELEMETRY_SEPTETS bytes long
+ * @param frame Set to the frame, which is TELEMETRY_FRAME_SIZE bytes long
+ */
+static void telemetry_encode(const uint8_t* septets, uint8_t* frame)
+{
+    uint8_t code_index = 0;
+    uint8_t code = 1;
+    uint8_t j = 1;
+
+    for (uint8_t i = 0; i < TELEMETRY_SEPTETS; i++) {
+        if (septets[i] == TELEMETRY_DELIMITER) {
+            frame[code_index] = code;
+            code_index = j++;
+            code = 1;
+        } else {
+            frame[j++] = septets[i];
+            code++;
+        }
+    }
+    frame[code_index] = code;
+    frame[j] = TELEMETRY_DELIMITER;
+}
+
+/**
+ * @brief Fills a record with the game's current state.
+ *
+ * @param record The record to fill
+ */
+static void telemetry_record(TelemetryRecord* record)
+{
+    const Ball* ball = ball_get();
+    uint32_t busy_ticks = 0;
+    uint8_t checksum = 0;
+
+    record->time = timer_get();
+    record->ball_row = ball->row;
+    record->ball_column = ball->column;
+    record->ball_row_step = ball->row_step;
+    record->ball = (have_ball ? TELEMETRY_HAVE_BALL : 0) |
+                   (ball->stride << TELEMETRY_STRIDE_SHIFT) |
+                   (ball->velocity & TELEMETRY_VELOCITY_MASK);
+    record->puck_bottom = puck.new_bottom;
+    record->ir_bytes_in = stats.ir_bytes_in;
+    record->ir_bytes_out = stats.ir_bytes_out;
+    record->slowest_task = 0;
+    record->slowest_ticks = 0;
+    for (uint8_t i = 0; i < STATS_TASKS_NUM; i++) {
+        busy_ticks += stats.tasks[i].total_ticks;
+        if (stats.tasks[i].worst_ticks > record->slowest_ticks) {
+            record->slowest_task = i;
+            record->slowest_ticks = stats.tasks[i].worst_ticks;
+        }
+    }
+    record->busy_ticks = busy_ticks - busy_ticks_seen;
+    busy_ticks_seen = busy_ticks;
+    record->dropped = stats.telemetry_dropped;
+    record->checksum = 0;
+
+    for (uint8_t i = 0; i < sizeof(TelemetryRecord); i++) {
+        checksum += ((const uint8_t*) record)[i];
+    }
+    record->checksum = -checksum;
+}
+
+void telemetry_init(void)
+{
+    head = 0;
+    tail = 0;
+}
+
+void telemetry_idle(void)
+{
+    // the telemetry waits for the IR like any other board's message, so it
+    // never starts on top of a byte which another board has started
+    if (head == tail || !mac_clear_p()) {
+        return;
+    }
+
+    ir_uart_putc(buffer[tail]);
+    tail = (tail + 1) % TELEMETRY_BUFFER_SIZE;
+    stats_ir(1);
+    mac_sent();
+}
+
+void telemetry_task(__unused__ void* data)
+{
+    TelemetryRecord record;
+    uint8_t septets[TELEMETRY_SEPTETS];
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    uint8_t used = (uint8_t) (head - tail) % TELEMETRY_BUFFER_SIZE;
+
+    // a whole frame is dropped, rather than part of one, so that the frames
+    // which are sent can all be decoded
+    if (TELEMETRY_BUFFER_SIZE - 1 - used < TELEMETRY_FRAME_SIZE) {
+        stats.telemetry_dropped++;
+        return;
+    }
+
+    telemetry_record(&record);
+    telemetry_pack((const uint8_t*) &record, septets);
+    telemetry_encode(septets, frame);
+    for (uint8_t i = 0; i < TELEMETRY_FRAME_SIZE; i++) {
+        buffer[head] = frame[i];
+        head = (head + 1) % TELEMETRY_BUFFER_SIZE;
+    }
+}
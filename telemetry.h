@@ -0,0 +1,145 @@
+/**
+ * @file telemetry.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the telemetry's function declarations and macro definitions
+ * which are to be shared with other files. When the game is built with
+ * TELEMETRY, a record of the game's state is sent over the IR UART a few times
+ * each second, so that it can be captured on the host and decoded with
+ * telemdecode.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The IR UART is also used by the ring, so each record is framed such
+ * that the ring ignores it. For information pertaining to the structure of the
+ * frames, see README.md
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "system.h"
+
+/**
+ * @brief Ends each frame. No other byte of a frame is 0.
+ *
+ */
+#define TELEMETRY_DELIMITER 0x00
+
+/**
+ * @brief The number of bits of a record which are held in each byte of a
+ * frame, so that bit 7 of every byte is 0, and the ring ignores the frame.
+ *
+ */
+#define TELEMETRY_SEPTET_BITS 7
+
+/**
+ * @brief Masks the bits of a byte which are held in a frame.
+ *
+ */
+#define TELEMETRY_SEPTET_MASK 0x7F
+
+/**
+ * @brief Masks the velocity within a record's ball byte.
+ *
+ */
+#define TELEMETRY_VELOCITY_MASK 0x0F
+
+/**
+ * @brief The shift of the stride within a record's ball byte.
+ *
+ */
+#define TELEMETRY_STRIDE_SHIFT 4
+
+/**
+ * @brief Masks the stride, once it has been shifted out of a record's ball
+ * byte.
+ *
+ */
+#define TELEMETRY_STRIDE_MASK 0x07
+
+/**
+ * @brief Set in a record's ball byte when the board has the ball.
+ *
+ */
+#define TELEMETRY_HAVE_BALL 0x80
+
+/**
+ * @brief Definition for the TelemetryRecord type, which holds the game's state
+ * at one moment. It is packed, so that it has the same layout on the host as
+ * on the board.
+ *
+ */
+typedef struct __attribute__((packed)) telemetry_record_s
+{
+    // the time at which the record was taken, in timer ticks
+    uint16_t time;
+    // the ball's position and row step, in fixed point
+    int16_t ball_row;
+    int16_t ball_column;
+    int16_t ball_row_step;
+    // whether this board has the ball, its stride, and its velocity
+    uint8_t ball;
+    int8_t puck_bottom;
+    // the totals from stats.h
+    uint16_t ir_bytes_in;
+    uint16_t ir_bytes_out;
+    // the number of ticks which the tasks have spent running since the last
+    // record
+    uint16_t busy_ticks;
+    // the task with the longest run so far, in the order of stats.h, and how
+    // long that run was
+    uint8_t slowest_task;
+    uint16_t slowest_ticks;
+    uint8_t dropped;
+    // chosen such that the sum of every byte of the record is 0
+    uint8_t checksum;
+} TelemetryRecord;
+
+/**
+ * @brief The number of bytes of a frame which hold a record.
+ *
+ */
+#define TELEMETRY_SEPTETS                                                      \
+    ((uint8_t) ((sizeof(TelemetryRecord) * 8 + TELEMETRY_SEPTET_BITS - 1) /    \
+                TELEMETRY_SEPTET_BITS))
+
+/**
+ * @brief The number of bytes in a frame: the record, the byte which the
+ * encoding adds, and the delimiter.
+ *
+ */
+#define TELEMETRY_FRAME_SIZE (TELEMETRY_SEPTETS + 2)
+
+/**
+ * @brief The number of bytes which can wait to be sent, which is enough for a
+ * few frames.
+ *
+ */
+#define TELEMETRY_BUFFER_SIZE 128
+
+/**
+ * @brief Empties the telemetry buffer.
+ *
+ */
+void telemetry_init(void);
+
+/**
+ * @brief Sends a single byte of telemetry, if there is one waiting and the IR
+ * is clear, as mac.h decides for the ring's messages. Never waits for the IR
+ * UART, so it can be called whenever the scheduler is idle.
+ *
+ */
+void telemetry_idle(void);
+
+/**
+ * @brief Adds a record of the game's state to the telemetry buffer. The record
+ * is dropped, and counted in stats.h, if the buffer is too full to hold it.
+ *
+ * @param void
+ */
+void telemetry_task(__unused__ void* data);
+
+#endif
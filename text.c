@@ -11,58 +11,151 @@
  *
  * @note Comments for non-static functions and variables are inside the
  * associated header file.
+ * @note The messages are kept in flash (PROGMEM), and are streamed onto the
+ * display one glyph column at a time, so that no copy of them is held in SRAM.
  *
  */
 
 #include "text.h"
 
+#include <avr/pgmspace.h>
+
 #include "../fonts/font5x7_1.h"
-#include "ball.h"
+#include "display.h"
+#include "game.h"
 #include "navswitch.h"
-#include "pacer.h"
-#include "tinygl.h"
+#include "stats.h"
 
-void text_init(void)
+/**
+ * @brief The message shown when the game is first started.
+ *
+ */
+static const char initial_text[] PROGMEM =
+    "PRESS THE NAVSWITCH ONCE THE BOARDS ARE ALIGNED TO PLAY.";
+
+/**
+ * @brief The message shown when this board has lost the game.
+ *
+ */
+static const char lost_text[] PROGMEM =
+    "LOST. PRESS NAVSWITCH DOWN TO PLAY AGAIN. PRESS RESET BUTTON TO END GAME.";
+
+/**
+ * @brief The message shown when this board has won the game.
+ *
+ */
+static const char won_text[] PROGMEM =
+    "WON. PRESS NAVSWITCH DOWN TO PLAY AGAIN. PRESS RESET BUTTON TO END GAME.";
+
+/**
+ * @brief The message which is currently scrolling across the display. It
+ * points into flash, so it must only be read with pgm_read_byte().
+ *
+ */
+static PGM_P message;
+
+/**
+ * @brief The index of the character inside the message whose column is next to
+ * be shifted onto the display.
+ *
+ */
+static uint8_t message_index;
+
+/**
+ * @brief The column of the current character which is next to be shifted onto
+ * the display. Columns past the font's width are the blank spacing between
+ * characters.
+ *
+ */
+static uint8_t glyph_column;
+
+/**
+ * @brief The number of times text_task has run since the last column was
+ * shifted onto the display.
+ *
+ */
+static uint8_t scroll_ticks;
+
+bool text_pushed = false;
+
+/**
+ * @brief Starts scrolling a new message from flash, on a blank display.
+ *
+ * @param text The message, which must reside in flash
+ */
+static void text_start(PGM_P text)
 {
-    pacer_init(PACER_RATE);
-    tinygl_init(LOOP_RATE);
-    tinygl_font_set(&font5x7_1);
-    tinygl_text_speed_set(MESSAGE_RATE);
-    tinygl_text_mode_set(TINYGL_TEXT_MODE_SCROLL);
+    message = text;
+    message_index = 0;
+    glyph_column = 0;
+    scroll_ticks = 0;
+    text_pushed = false;
+    display_clear();
 }
 
-void show_initial_text(void)
+/**
+ * @brief Shifts every column of the display one place towards the first
+ * column, and then draws the next glyph column of the message into the last
+ * column. The message wraps around once its end has scrolled on.
+ *
+ */
+static void text_shift_column(void)
 {
-    bool start_game = false;
-    tinygl_text("PRESS THE NAVSWITCH ONCE THE BOARDS ARE ALIGNED TO PLAY.");
-    while (!start_game) {
-        pacer_wait();
-        tinygl_update();
-
-        navswitch_update();
-        if (navswitch_push_event_p(NAVSWITCH_PUSH)) {
-            start_game = true;
+    char character = pgm_read_byte(message + message_index);
+
+    for (uint8_t column = 0; column < LEDMAT_COLS_NUM - 1; column++) {
+        for (uint8_t row = 0; row < LEDMAT_ROWS_NUM; row++) {
+            display_pixel_set(column, row, display_pixel_get(column + 1, row));
         }
     }
+
+    for (uint8_t row = 0; row < LEDMAT_ROWS_NUM; row++) {
+        bool pixel = glyph_column < font5x7_1.width &&
+                     font_pixel_get(&font5x7_1, character, glyph_column, row);
+        display_pixel_set(LEDMAT_COLS_NUM - 1, row, pixel);
+    }
+
+    glyph_column++;
+    if (glyph_column == CHARACTER_COLUMNS) {
+        glyph_column = 0;
+        message_index++;
+        if (pgm_read_byte(message + message_index) == '\0') {
+            message_index = 0;
+        }
+    }
+}
+
+void text_init(void)
+{
+    display_init();
+}
+
+void show_initial_text(void)
+{
+    text_start(initial_text);
 }
 
 void notify(void)
 {
     if (lost_game) {
-        tinygl_text("LOST. PRESS NAVSWITCH DOWN TO PLAY AGAIN. PRESS RESET "
-                    "BUTTON TO END GAME.");
+        text_start(lost_text);
     } else {
-        tinygl_text("WON. PRESS NAVSWITCH DOWN TO PLAY AGAIN. PRESS RESET "
-                    "BUTTON TO END GAME.");
+        text_start(won_text);
     }
-    while (1) {
-        pacer_wait();
-        tinygl_update();
+}
 
-        navswitch_update();
-        if (navswitch_push_event_p(NAVSWITCH_PUSH)) {
-            break;
-        }
+void text_task(__unused__ void* data)
+{
+    scroll_ticks++;
+    if (scroll_ticks >= SCROLL_PERIOD) {
+        scroll_ticks = 0;
+        text_shift_column();
     }
-    display_init();
-}
\ No newline at end of file
+    display_update();
+
+    navswitch_update();
+    if (navswitch_push_event_p(NAVSWITCH_PUSH) && !text_pushed) {
+        text_pushed = true;
+        stats_start();
+    }
+}
@@ -15,40 +15,66 @@
 #define TEXT_H
 
 /**
- * @brief The rate at which the message moves.
+ * @brief The rate at which the message moves, in characters per 10 seconds.
  *
  */
 #define MESSAGE_RATE 10
 
+#include "system.h"
+
 /**
- * @brief The rate at which the pacer refreshes.
+ * @brief The rate at which the text's task runs. The task also refreshes the
+ * display, so this matches BOARD_DISPLAY_TASK_RATE.
  *
  */
-#define PACER_RATE 500
+#define TEXT_TASK_RATE 250
 
 /**
- * @brief The rate at which tinygl loops.
+ * @brief The number of display columns each character occupies as it scrolls,
+ * including the blank column which separates it from the next character.
  *
  */
-#define LOOP_RATE PACER_RATE
+#define CHARACTER_COLUMNS 6
 
 /**
- * @brief Initialises tinygl and the pacer.
+ * @brief The number of times the text's task runs between each column of the
+ * message being shifted onto the display.
+ *
+ */
+#define SCROLL_PERIOD (TEXT_TASK_RATE * 10 / (MESSAGE_RATE * CHARACTER_COLUMNS))
+
+/**
+ * @brief Indicates whether the user has pushed the navswitch since the current
+ * message started scrolling.
+ *
+ */
+bool text_pushed;
+
+/**
+ * @brief Initialises the display.
  *
  */
 void text_init(void);
 
 /**
- * @brief Displays the initial text for the game. It exits when the user pushes
- * the navswitch.
+ * @brief Starts scrolling the initial text for the game. The text is scrolled
+ * by text_task, and text_pushed is set when the user pushes the navswitch.
  *
  */
 void show_initial_text(void);
 
 /**
- * @brief Notifies the user whether they won, and how to restart the game.
+ * @brief Starts scrolling the text which notifies the user whether they won,
+ * and how to restart the game. The text is scrolled by text_task.
  *
  */
 void notify(void);
 
+/**
+ * @brief Scrolls the current message, refreshes the display, and checks
+ * whether the user has pushed the navswitch.
+ *
+ */
+void text_task(__unused__ void* data);
+
 #endif
\ No newline at end of file
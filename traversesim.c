@@ -0,0 +1,225 @@
+/**
+ * @file traversesim.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Moves the puck across the field on the host, from scripted presses of
+ * the navswitch, and prints how long it takes when the navswitch is tapped as
+ * fast as a player can, and when it is held. It also checks that a short tap
+ * moves the puck once, and that the puck stops as soon as the navswitch is
+ * released.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note The puck module is included, rather than linked, so that the puck is
+ * moved by the real puck_task, which is run at PUCK_TASK_RATE against a
+ * simulated timer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "display.h"
+#include "timer.h"
+
+// the puck's timer is the simulation's, and the display is not needed
+#define timer_get() traversesim_timer_get()
+#define display_pixel_set(column, row, value)
+
+static timer_tick_t traversesim_timer_get(void);
+
+#include "game.h"
+#include "puck.c"
+
+/**
+ * @brief The number of ticks between runs of puck_task.
+ *
+ */
+#define TRAVERSESIM_PERIOD (TIMER_RATE / PUCK_TASK_RATE)
+
+/**
+ * @brief The time between taps when the navswitch is tapped as fast as a
+ * player can, and the time for which each tap is held, in milliseconds.
+ *
+ */
+#define TRAVERSESIM_TAP_MS 150
+#define TRAVERSESIM_TAP_HELD_MS 80
+
+/**
+ * @brief The longest that a traversal is run for, in milliseconds.
+ *
+ */
+#define TRAVERSESIM_LIMIT_MS 3000
+
+/**
+ * @brief The number of moves which it takes to cross the field.
+ *
+ */
+#define TRAVERSESIM_MOVES (FIELD_ROWS - PUCK_LENGTH)
+
+/**
+ * @brief Converts between milliseconds and ticks, past the timer's wrap.
+ *
+ */
+#define TRAVERSESIM_TICKS(ms) ((uint32_t) TIMER_RATE * (ms) / 1000)
+#define TRAVERSESIM_MS(ticks) ((uint32_t) (ticks) * 1000 / TIMER_RATE)
+
+/**
+ * @brief Definition for the Script type, which holds the scripted presses:
+ * the navswitch is pressed every period ticks, from tick 0, and held for held
+ * ticks each time. A press which is held for longer than the period is held
+ * until the script ends.
+ *
+ */
+typedef struct script_s
+{
+    uint32_t period;
+    uint32_t held;
+    // the number of presses, and the number which have been queued
+    uint8_t presses;
+    uint8_t popped;
+} Script;
+
+/**
+ * @brief The simulated time, in ticks, and the script which is being run.
+ *
+ */
+static uint32_t now;
+static Script script;
+
+static timer_tick_t traversesim_timer_get(void)
+{
+    return (timer_tick_t) now;
+}
+
+// the presses come from the script, rather than the interrupt
+bool navevent_pop(NavEvent* event)
+{
+    uint32_t time = script.popped * script.period;
+
+    if (script.popped == script.presses || time > now) {
+        return false;
+    }
+    *event = (NavEvent){.button = NAVSWITCH_COMPASS_NORTH,
+                        .time = (timer_tick_t) time};
+    script.popped++;
+    return true;
+}
+
+bool navevent_down_p(uint8_t button)
+{
+    uint32_t last = script.popped ? script.popped - 1 : 0;
+
+    return button == NAVSWITCH_COMPASS_NORTH && script.popped != 0 &&
+           now - last * script.period < script.held;
+}
+
+void navevent_flush(void)
+{
+}
+
+void stats_input(__unused__ timer_tick_t press_time)
+{
+}
+
+/**
+ * @brief Runs a script, with the puck starting at the bottom of the field, and
+ * runs puck_task every TRAVERSESIM_PERIOD ticks until the puck reaches the top
+ * of the field, or for TRAVERSESIM_LIMIT_MS.
+ *
+ * @param period The ticks between presses
+ * @param held The ticks for which each press is held
+ * @param presses The number of presses
+ * @param moves Set to the number of moves which the puck made
+ * @param ticks Set to the ticks from the first press to the puck reaching the
+ * top of the field
+ * @return true The puck reached the top of the field
+ */
+static bool traversesim_run(uint32_t period, uint32_t held, uint8_t presses,
+                            uint8_t* moves, uint32_t* ticks)
+{
+    puck_init();
+    puck = (Puck){.new_bottom = BOTTOM_ROW,
+                  .new_top = BOTTOM_ROW + PUCK_LENGTH - 1};
+    script = (Script){.period = period, .held = held, .presses = presses};
+    *moves = 0;
+
+    for (now = 0; now < TRAVERSESIM_TICKS(TRAVERSESIM_LIMIT_MS);
+         now += TRAVERSESIM_PERIOD) {
+        int8_t bottom = puck.new_bottom;
+
+        puck_task(NULL);
+        *moves += puck.new_bottom - bottom;
+        if (puck.new_top == FIELD_LAST_ROW) {
+            *ticks = now;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Prints a traversal's row of the CSV.
+ *
+ * @param name The traversal's name
+ * @param crossed Whether the puck crossed the field
+ * @param moves The number of moves which the puck made
+ * @param ticks The ticks which it took
+ */
+static void traversesim_print(const char* name, bool crossed, uint8_t moves,
+                              uint32_t ticks)
+{
+    if (crossed) {
+        printf("%s,%u,%lu\n", name, moves,
+               (unsigned long) TRAVERSESIM_MS(ticks));
+    } else {
+        printf("%s,%u,never\n", name, moves);
+    }
+}
+
+/**
+ * @brief Main function for the simulation.
+ *
+ * @return int EXIT_FAILURE if a tap moved the puck more than once, or the puck
+ * moved after the navswitch was released
+ */
+int main(void)
+{
+    const uint32_t tap = TRAVERSESIM_TICKS(TRAVERSESIM_TAP_MS);
+    const uint32_t tap_held = TRAVERSESIM_TICKS(TRAVERSESIM_TAP_HELD_MS);
+    const uint32_t forever = TRAVERSESIM_TICKS(TRAVERSESIM_LIMIT_MS);
+    uint32_t ticks;
+    uint8_t moves;
+    bool crossed;
+
+    // a single tap must move the puck once, and a hold which is released just
+    // after the first repeat must stop it straight away
+    traversesim_run(forever, tap_held, 1, &moves, &ticks);
+    if (moves != 1) {
+        fprintf(stderr, "traversesim: a single tap moved the puck %u times\n",
+                moves);
+        return EXIT_FAILURE;
+    }
+    if (TRAVERSESIM_MOVES > 1 && PUCK_REPEAT_DELAY_MS != 0) {
+        uint32_t released =
+            TRAVERSESIM_TICKS(PUCK_REPEAT_DELAY_MS) + TRAVERSESIM_PERIOD + 1;
+
+        traversesim_run(forever, released, 1, &moves, &ticks);
+        if (moves != 2) {
+            fprintf(stderr,
+                    "traversesim: a hold for one repeat moved the puck %u "
+                    "times\n",
+                    moves);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("traversal,moves,ms\n");
+    crossed =
+        traversesim_run(tap, tap_held, TRAVERSESIM_MOVES, &moves, &ticks);
+    traversesim_print("tapping", crossed, moves, ticks);
+    crossed = traversesim_run(forever, forever, 1, &moves, &ticks);
+    traversesim_print("holding", crossed, moves, ticks);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file warm.c
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains definitions for the warm restart.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note Comments for non-static functions and variables are inside the
+ * associated header file.
+ * @note The mirror is in the .noinit section, which the startup code leaves
+ * alone, so it holds whatever was last written to it before a reset, or
+ * garbage after the board is turned on. The CRC tells the two apart.
+ */
+
+#include "warm.h"
+
+#include <avr/wdt.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+#include "ball.h"
+#include "game.h"
+#include "ghost.h"
+#include "link.h"
+#include "puck.h"
+#include "ring.h"
+#include "stats.h"
+
+/**
+ * @brief The watchdog's timeout, after which a board whose scheduler has
+ * stopped running tasks is reset. The longest that a task waits is for a probe
+ * of the IR rate to be forwarded at 1200 baud, which takes 160 ms. Can be set
+ * at build time.
+ *
+ */
+#ifndef WARM_WATCHDOG_TIMEOUT
+#define WARM_WATCHDOG_TIMEOUT WDTO_500MS
+#endif
+
+/**
+ * @brief Definition for the Warm type, which holds everything that is needed
+ * to pick a game up again after a reset.
+ *
+ */
+typedef struct warm_s
+{
+    // whether a game against other boards is being played
+    bool playing;
+    // this board's place in the ring, and the IR rate which was agreed on
+    uint8_t address;
+    uint8_t size;
+    uint8_t nonce;
+    bool origin;
+    uint8_t rate;
+    // whether this board has the ball, the ball when it last moved, and the
+    // puck
+    bool have_ball;
+    Ball ball;
+    Puck puck;
+    // the number of balls which this board has received and handed on during
+    // the game, and the message which held the last ball that it handed on
+    uint8_t received;
+    uint8_t sent;
+    uint8_t handoff[RING_PAYLOAD_MAX];
+    uint8_t handoff_length;
+    // the CRC of everything above
+    uint16_t crc;
+} Warm;
+
+/**
+ * @brief The mirror of the game, which is kept across a reset.
+ *
+ */
+static Warm mirror __attribute__((section(".noinit")));
+
+/**
+ * @brief The cause of the last reset, from MCUSR.
+ *
+ */
+static uint8_t reset_cause;
+
+/**
+ * @brief Works out the CRC of the mirror.
+ *
+ * @return uint16_t The CRC
+ */
+static uint16_t warm_crc(void)
+{
+    const uint8_t* bytes = (const uint8_t*) &mirror;
+    uint16_t crc = 0xFFFF;
+
+    for (uint8_t i = 0; i < offsetof(Warm, crc); i++) {
+        crc = _crc_ccitt_update(crc, bytes[i]);
+    }
+    return crc;
+}
+
+/**
+ * @brief Stores the CRC of the mirror, once it has been changed.
+ *
+ */
+static void warm_save(void)
+{
+    mirror.crc = warm_crc();
+}
+
+/**
+ * @brief Sends the last ball which this board handed on again.
+ *
+ */
+static void warm_resend(void)
+{
+    if (mirror.handoff_length != 0 && !have_ball) {
+        ring_send(ring_next(), mirror.handoff, mirror.handoff_length);
+    }
+}
+
+void warm_init(void)
+{
+    reset_cause = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+void warm_watchdog(void)
+{
+    wdt_enable(WARM_WATCHDOG_TIMEOUT);
+}
+
+bool warm_restore(void)
+{
+    uint8_t payload;
+
+    // the board is turned on, or reset with the reset button, to start cold,
+    // and a reset while the mirror is written leaves a broken CRC
+    if (!(reset_cause & (BIT(BORF) | BIT(WDRF))) ||
+        (reset_cause & (BIT(PORF) | BIT(EXTRF))) || mirror.crc != warm_crc() ||
+        !mirror.playing) {
+        return false;
+    }
+
+    ring_init();
+    ring.address = mirror.address;
+    ring.size = mirror.size;
+    ring.nonce = mirror.nonce;
+    ring.origin = mirror.origin;
+    ring.ready = true;
+    link_init();
+    link.agreed = mirror.rate;
+    link_rate_set(mirror.rate);
+
+    puck = mirror.puck;
+    puck_show();
+    have_ball = mirror.have_ball;
+    if (have_ball) {
+        ball_resume(&mirror.ball);
+    } else {
+        ball_init();
+    }
+    ghost_init();
+    stats.warm_start = true;
+
+    // the board which has the ball carries on, and every other board asks for
+    // any ball which was lost in the reset
+    if (!have_ball) {
+        payload = WARM_PACKET | ((mirror.received & 1) ? WARM_RECEIVED : 0) |
+                  ((mirror.sent & 1) ? WARM_SENT : 0);
+        ring_broadcast(&payload, 1);
+    }
+    return true;
+}
+
+void warm_start(void)
+{
+    mirror.playing = !ring.solo;
+    mirror.address = ring.address;
+    mirror.size = ring.size;
+    mirror.nonce = ring.nonce;
+    mirror.origin = ring.origin;
+    mirror.rate = link.rate;
+    mirror.have_ball = have_ball;
+    mirror.ball = *ball_get();
+    mirror.puck = puck;
+    mirror.received = 0;
+    mirror.sent = 0;
+    mirror.handoff_length = 0;
+    warm_save();
+}
+
+void warm_end(void)
+{
+    mirror.playing = false;
+    warm_save();
+}
+
+void warm_handoff(const uint8_t* message, uint8_t length)
+{
+    if (!mirror.playing) {
+        return;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        mirror.handoff[i] = message[i];
+    }
+    mirror.handoff_length = length;
+    mirror.sent++;
+    mirror.have_ball = false;
+    mirror.puck = puck;
+    warm_save();
+}
+
+void warm_caught(void)
+{
+    if (!mirror.playing) {
+        return;
+    }
+    mirror.received++;
+    mirror.have_ball = true;
+    mirror.ball = *ball_get();
+    warm_save();
+}
+
+bool warm_receive(uint8_t data, uint8_t source)
+{
+    uint8_t payload;
+
+    if ((data & WARM_PACKET_MASK) != WARM_PACKET) {
+        return false;
+    }
+
+    if (data & WARM_ANSWER) {
+        // the next board never received the last ball which this board handed
+        // on
+        if (source == ring_next()) {
+            warm_resend();
+        }
+        return true;
+    }
+
+    // the board which restarted never received the last ball which this board
+    // handed on to it
+    if (source == ring_next() &&
+        !(data & WARM_RECEIVED) != !(mirror.sent & 1)) {
+        warm_resend();
+        return true;
+    }
+
+    // the last ball which the board that restarted handed on never reached
+    // this board, so it is asked to send it again
+    if ((source + 1) % ring.size == ring.address &&
+        !(data & WARM_SENT) != !(mirror.received & 1)) {
+        payload = WARM_PACKET | WARM_ANSWER;
+        ring_send(source, &payload, 1);
+    }
+    return true;
+}
+
+void warm_task(__unused__ void* data)
+{
+    if (!mirror.playing) {
+        return;
+    }
+    mirror.have_ball = have_ball;
+    mirror.ball = *ball_get();
+    mirror.puck = puck;
+    warm_save();
+}
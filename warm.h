@@ -0,0 +1,137 @@
+/**
+ * @file warm.h
+ * @author Isaac Daly (idd17@uclive.ac.nz)
+ * @author Divyean Sivarman (dsi3@uclive.ac.nz)
+ * @brief Contains the warm restart's function declarations and macro
+ * definitions which are to be shared with other files. While a game is played,
+ * the ring, the IR rate, the ball and this board's puck are mirrored into RAM
+ * which is not cleared at startup, along with a CRC. A board which is reset by
+ * a brownout or the watchdog picks the game up from the mirror, rather than
+ * showing the welcome text and discovering the ring again.
+ * @version 1.0
+ * @date 2018-10-18
+ *
+ * @copyright Copyright (c) 2018
+ *
+ * @note A board which is turned on, or reset with the reset button, always
+ * starts cold, as the reset button is how a user leaves the game.
+ * @note For information pertaining to the structure of the transmitted and
+ * received data, see README.md
+ */
+
+#ifndef WARM_H
+#define WARM_H
+
+#include "system.h"
+
+/**
+ * @brief Marks a rejoin byte, which a board sends once it has restarted warm,
+ * or the answer to one. Bits 4-7 are 0001, so it is told apart from the ball,
+ * the puck bytes and the other single bytes.
+ *
+ */
+#define WARM_PACKET 0x10
+
+/**
+ * @brief Masks the bits of a byte which mark it as a rejoin byte.
+ *
+ */
+#define WARM_PACKET_MASK 0xF0
+
+/**
+ * @brief The lowest bit of the number of balls which the sender of a rejoin
+ * byte has received, and of the number which it has handed on, during the
+ * game. A ball is only handed on once the one before it has come back around
+ * the ring, so two boards' counts of the balls passed between them never
+ * differ by more than one.
+ *
+ */
+#define WARM_RECEIVED 0x01
+#define WARM_SENT 0x02
+
+/**
+ * @brief Set in the answer to a rejoin byte, which the next board sends back
+ * to the board which restarted.
+ *
+ */
+#define WARM_ANSWER 0x04
+
+/**
+ * @brief Reads and clears the cause of the last reset, and stops the watchdog,
+ * which is left running after a watchdog reset. Must be called first thing in
+ * main.
+ *
+ */
+void warm_init(void);
+
+/**
+ * @brief Starts the watchdog, which the scheduler resets before each task, so
+ * that a board which hangs is reset, and picks its game up from the mirror.
+ * CAN ONLY BE USED AFTER warm_init().
+ *
+ */
+void warm_watchdog(void);
+
+/**
+ * @brief Picks the game up from the mirror, if this board was reset by a
+ * brownout or the watchdog part of the way through a game, and the mirror is
+ * whole. The ring, the IR rate, the puck and the ball are restored, and, if
+ * this board does not have the ball, a rejoin byte is sent to every board, so
+ * that a ball which was lost in the reset is sent again. CAN ONLY BE USED AFTER
+ * board_init().
+ *
+ * @return true The game has been restored
+ * @return false This board has to start cold
+ */
+bool warm_restore(void);
+
+/**
+ * @brief Starts mirroring a new game. Nothing is mirrored in a single-board
+ * game.
+ *
+ */
+void warm_start(void);
+
+/**
+ * @brief Stops mirroring the game, once it has finished, so that a reset
+ * during the result text starts cold.
+ *
+ */
+void warm_end(void);
+
+/**
+ * @brief Records that this board is about to hand the ball on, and mirrors the
+ * game before the message is sent, so that a reset while it is being sent
+ * never leaves two boards with the ball.
+ *
+ * @param message The message which holds the ball
+ * @param length The number of bytes in the message
+ */
+void warm_handoff(const uint8_t* message, uint8_t length);
+
+/**
+ * @brief Records that this board has received the ball, and mirrors the game.
+ *
+ */
+void warm_caught(void);
+
+/**
+ * @brief Handles a rejoin byte from another board. The board before one which
+ * has restarted sends its last ball again, if the restarted board never
+ * received it, and the board after it answers with the number of balls that
+ * it has received, so that the restarted board can do the same.
+ *
+ * @param data The first byte of the message
+ * @param source The board which sent it
+ * @return true The byte was a rejoin byte
+ * @return false The byte was something else
+ */
+bool warm_receive(uint8_t data, uint8_t source);
+
+/**
+ * @brief Mirrors the ball and the puck, as they move.
+ *
+ */
+void warm_task(__unused__ void* data);
+
+#endif